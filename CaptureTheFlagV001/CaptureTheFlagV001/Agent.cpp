@@ -1,7 +1,10 @@
 #include "Agent.h"
+#include "BinaryStream.h"
 #include "Brain.h"
 #include "Memory.h"
 #include "GameManager.h"
+#include "Logging.h"
+#include <algorithm>
 #include <cmath>
 #include <filesystem>
 #include <iostream>
@@ -9,23 +12,63 @@
 #include <QGraphicsView>
 #include <memory>
 
-Agent::Agent(int x, int y, std::string side, int gameFieldWidth, int gameFieldHeight, const std::shared_ptr<Pathfinder>& pathfinder, float taggingDistance, const std::shared_ptr<Brain>& brain, const std::shared_ptr<Memory>& memory, const std::shared_ptr<GameManager>& gameManager,
+Agent::Agent(int id, int x, int y, std::string side, int gameFieldWidth, int gameFieldHeight, const std::shared_ptr<Pathfinder>& pathfinder, float taggingDistance, const std::shared_ptr<Brain>& brain, const std::shared_ptr<TeamBlackboard>& blackboard, int blackboardSlot, const std::shared_ptr<GameManager>& gameManager,
     std::vector<std::shared_ptr<Agent>>& blueAgents, std::vector<std::shared_ptr<Agent>>& redAgents)
-    : x(x), y(y), side(side), gameFieldWidth(gameFieldWidth), gameFieldHeight(gameFieldHeight), pathfinder(pathfinder), taggingDistance(taggingDistance), brain(brain), memory(memory), gameManager(gameManager),
-    _isCarryingFlag(false), _isTagged(false), cooldownTimer(0), _isEnabled(true), previousX(x), previousY(y), stuckTimer(0) {}
-
-void Agent::update(const std::vector<std::pair<int, int>>& otherAgentsPositions, std::vector<Agent*>& otherAgents, const std::vector<std::shared_ptr<Agent>>& blueAgents, const std::vector<std::shared_ptr<Agent>>& redAgents, int elapsedTime) {
-    // Updates memory of agent with position of other agents
-    updateMemory(otherAgentsPositions);
+    : id(id), x(x), y(y), positionX(static_cast<float>(x)), positionY(static_cast<float>(y)), movementSpeed(defaultMovementSpeed), viewRange(0.0f), viewAngle(0.0f), viewHalfAngleCosine(0.0f), side(side), gameFieldWidth(gameFieldWidth), gameFieldHeight(gameFieldHeight), pathfinder(pathfinder), taggingDistance(taggingDistance), brain(brain), blackboard(blackboard), blackboardSlot(blackboardSlot), gameManager(gameManager),
+    _isCarryingFlag(false), _isTagged(false), cooldownTimer(0), pathGoal(-1, -1), currentDecision(BrainDecision::Explore), isActing(false), appliesRules(false), lastDecisionInputs(-1), _isEnabled(true), previousX(x), previousY(y), stuckTimer(0),
+    random(gameManager->getMatchSeed(), static_cast<uint32_t>(id)) {
+    setViewCone(gameManager->getParams().viewRange, gameManager->getParams().viewAngle);
+    brain->setProximityThreshold(gameManager->getParams().proximityThreshold);
+}
 
-    float movementSpeed = 100.0f; // Adjust the speed as needed
-    float movementDistance = movementSpeed * elapsedTime / 1000.0f;
+void Agent::reset(int newId, int newX, int newY, const std::string& newSide, const std::shared_ptr<TeamBlackboard>& newBlackboard, int newBlackboardSlot) {
+    id = newId;
+    x = newX;
+    y = newY;
+    positionX = static_cast<float>(newX);
+    positionY = static_cast<float>(newY);
+    movementSpeed = defaultMovementSpeed;
+    setViewCone(gameManager->getParams().viewRange, gameManager->getParams().viewAngle);
+    side = newSide;
+    _isCarryingFlag = false;
+    _isTagged = false;
+    cooldownTimer = 0;
+    path.clear();
+    pathGoal = std::make_pair(-1, -1);
+    currentDecision = BrainDecision::Explore;
+    isActing = false;
+    appliesRules = false;
+    lastDecisionInputs = -1;
+    _isEnabled = true;
+    previousX = newX;
+    previousY = newY;
+    stuckTimer = 0;
+    random = RandomStream(gameManager->getMatchSeed(), static_cast<uint32_t>(newId));
+    brain->reset();
+    brain->setProximityThreshold(gameManager->getParams().proximityThreshold);
+    blackboard = newBlackboard;
+    blackboardSlot = newBlackboardSlot;
+}
+
+void Agent::decide(const std::vector<std::pair<int, int>>& otherAgentsPositions) {
+    DecisionInputs inputs;
+    if (beginDecision(otherAgentsPositions, inputs)) {
+        finishDecision(brain->makeDecision(inputs));
+    }
+}
+
+bool Agent::beginDecision(const std::vector<std::pair<int, int>>& otherAgentsPositions, DecisionInputs& inputs) {
+    isActing = false;
+    appliesRules = false;
+    lastDecisionInputs = getDecisionInputs(otherAgentsPositions);
 
     // is ai agent activated
     if (!_isEnabled) {
-        return;
+        return false;
     }
 
+    isActing = true;
+
     // is ai agent tagged
     if (_isTagged) {
         if (checkInTeamZone()) {
@@ -33,97 +76,353 @@ void Agent::update(const std::vector<std::pair<int, int>>& otherAgentsPositions,
             _isTagged = false;
         }
         else {
-            // go to base to remove tag
-            moveTowardsHomeZone();
-            return;
+            // go to base to remove tag, flag and tag rules are skipped until then
+            currentDecision = BrainDecision::ReturnToHomeZone;
+            return false;
         }
     }
 
-    // if tagged while holding the flag the flag is reset
-    if (_isCarryingFlag && _isTagged) {
-        resetFlag();
-    }
+    appliesRules = true;
 
     // Ai makes decisions
-    qDebug() << "Agent at (" << x << ", " << y << ") making decision...";
-    BrainDecision decision = brain->makeDecision(_isCarryingFlag, isOpponentCarryingFlag(), _isTagged, checkInTeamZone(), distanceToEnemyFlag(), distanceToNearestEnemy(otherAgentsPositions));
+    qCDebug(agentLog) << "Agent at (" << x << ", " << y << ") making decision...";
+    inputs.hasFlag = _isCarryingFlag;
+    inputs.opponentHasFlag = isOpponentCarryingFlag();
+    inputs.isTagged = _isTagged;
+    inputs.inHomeZone = checkInTeamZone();
+    inputs.distanceToFlag = distanceToEnemyFlag();
+    inputs.distanceToNearestEnemy = distanceToNearestEnemy(otherAgentsPositions);
+    return true;
+}
 
-    switch (decision) {
+void Agent::finishDecision(BrainDecision decision) {
+    currentDecision = decision;
+}
+
+void Agent::planPath() {
+    if (!isActing) {
+        return;
+    }
+
+    switch (currentDecision) {
     case BrainDecision::Explore:
-        qDebug() << "Exploring field";
+        qCDebug(agentLog) << "Exploring field";
         exploreField();
         break;
     case BrainDecision::GrabFlag:
-        qDebug() << "Moving towards enemy flag";
+        qCDebug(agentLog) << "Moving towards enemy flag";
         //moveTowardsEnemyFlag();
         break;
     case BrainDecision::CaptureFlag:
-        qDebug() << "Moving towards home zone";
+        qCDebug(agentLog) << "Moving towards home zone";
         moveTowardsHomeZone();
         break;
     case BrainDecision::RecoverFlag:
-        qDebug() << "Chasing opponent with flag";
-        chaseOpponentWithFlag(otherAgentsPositions);
+        qCDebug(agentLog) << "Chasing opponent with flag";
+        chaseOpponentWithFlag();
         break;
     case BrainDecision::TagEnemy:
-        qDebug() << "Tagging enemy";
-        tagEnemy(otherAgents);
+        // Tagging touches other agents, so it waits for the rules phase
+        qCDebug(agentLog) << "Tagging enemy";
         break;
     case BrainDecision::ReturnToHomeZone:
-        qDebug() << "Returning to home zone";
+        qCDebug(agentLog) << "Returning to home zone";
         moveTowardsHomeZone();
         break;
     default:
-        qDebug() << "Exploring field";
+        qCDebug(agentLog) << "Exploring field";
         exploreField();
         break;
     }
+}
+
+void Agent::followPath() {
+    // Tagging and grabbing hold position
+    if (!isFollowingPath()) {
+        return;
+    }
 
-    handleFlagInteractions(blueAgents, redAgents);
-    handleCooldownTimer();
+    walkPath(getCellsPerTick());
 }
 
-void Agent::updateMemory(const std::vector<std::pair<int, int>>& otherAgentsPositions) {
-    // checks every ai agents position
-    for (const auto& position : otherAgentsPositions) {
-        // retrieve opponent info from the map
-        const auto& opponentInfoIt = memory->getOpponentInfo().find(position);
-        if (opponentInfoIt != memory->getOpponentInfo().end()) {
-            // retrieve the tuple value from the map
-            const auto& opponentInfo = opponentInfoIt->second;
-            // update memory with info
-            memory->updateOpponentInfo(position.first, position.second, std::get<0>(opponentInfo), std::get<1>(opponentInfo).first, std::get<1>(opponentInfo).second);
+float Agent::getCellsPerTick() const {
+    return movementSpeed * gameManager->getClock().getTickMillis() / 1000.0f;
+}
+
+void Agent::walkPath(float distance) {
+    // Sub-steps of at most one cell, along x to the next corner and then
+    // along y. Walking stops at the first cell where a flag, zone or midline
+    // rule changes, so long ticks cannot carry an agent past one.
+    int startRegion = getRuleRegion();
+    while (distance > 0.0f && !path.empty()) {
+        std::pair<int, int> waypoint = path.front();
+        float step = std::min(distance, 1.0f);
+        float nextX = positionX;
+        float nextY = positionY;
+        if (positionX != waypoint.first) {
+            float gap = waypoint.first - positionX;
+            nextX = std::abs(gap) <= step ? static_cast<float>(waypoint.first) : positionX + (gap > 0.0f ? step : -step);
+        }
+        else if (positionY != waypoint.second) {
+            float gap = waypoint.second - positionY;
+            nextY = std::abs(gap) <= step ? static_cast<float>(waypoint.second) : positionY + (gap > 0.0f ? step : -step);
+        }
+
+        // Leftover distance too small to move a float position ends the walk
+        bool atWaypoint = positionX == waypoint.first && positionY == waypoint.second;
+        if (!atWaypoint && nextX == positionX && nextY == positionY) {
+            return;
+        }
+
+        int nextCellX = static_cast<int>(std::lround(nextX));
+        int nextCellY = static_cast<int>(std::lround(nextY));
+        if (!isValidPosition(nextCellX, nextCellY)) {
+            // The new position is outside the game field boundaries
+            // Find an alternative path or direction to move
+            findAlternativePath();
+            return;
+        }
+
+        distance -= std::abs(nextX - positionX) + std::abs(nextY - positionY);
+        positionX = nextX;
+        positionY = nextY;
+        x = nextCellX;
+        y = nextCellY;
+
+        // Corners cost nothing to turn, and a zero-length one is simply dropped
+        if (positionX == waypoint.first && positionY == waypoint.second) {
+            path.erase(path.begin());
+        }
+        if (getRuleRegion() != startRegion) {
+            return;
         }
     }
 }
 
-void Agent::handleFlagInteractions(const std::vector<std::shared_ptr<Agent>>& blueAgents, const std::vector<std::shared_ptr<Agent>>& redAgents) {
-    // checks if not carrying flag, not tagged, and is within a 10 unit distance or in opponent team zone
-    if (!_isCarryingFlag && !_isTagged && distanceToEnemyFlag() <= 10) {
-        // checks to make sure no team ai agent is already holding a flag
-        if (!isTeamCarryingFlag(blueAgents, redAgents)) {
-            grabFlag();
-        }
+int Agent::getRuleRegion() const {
+    // Which side, team zone and flag reach the agent is in, one bit each
+    int region = 0;
+    region |= isOnEnemySide() ? 1 : 0;
+    region |= checkInTeamZone() ? 2 : 0;
+    region |= distanceToEnemyFlag() <= gameManager->getParams().flagReachDistance ? 4 : 0;
+    return region;
+}
+
+RuleIntent Agent::submitIntent() {
+    // Cooldowns only run down while the agent plays by the rules, and a
+    // tagger is ready again on the tick its cooldown reaches zero
+    if (appliesRules) {
+        handleCooldownTimer();
     }
 
-    // if agent has flag and in home team zone
-    if (_isCarryingFlag && checkInTeamZone()) {
-        captureFlag();
+    RuleIntent intent;
+    intent.x = x;
+    intent.y = y;
+    intent.blueTeam = side == "blue";
+    intent.enabled = _isEnabled;
+    intent.appliesRules = appliesRules;
+    intent.wantsTag = appliesRules && currentDecision == BrainDecision::TagEnemy && cooldownTimer == 0 && !_isTagged;
+    intent.tagged = _isTagged;
+    intent.carrying = _isCarryingFlag;
+    intent.inTeamZone = checkInTeamZone();
+    intent.onEnemySide = isOnEnemySide();
+    intent.enemyFlagDistance = distanceToEnemyFlag();
+    return intent;
+}
+
+int Agent::getDecisionInputs(const std::vector<std::pair<int, int>>& otherAgentsPositions) const {
+    // Everything decide() branches on, one bit each
+    return getStateInputs() | (distanceToNearestEnemy(otherAgentsPositions) <= brain->getProximityThreshold() ? 32 : 0);
+}
+
+int Agent::getStateInputs() const {
+    // The decision inputs that do not depend on where anyone else is
+    int inputs = 0;
+    inputs |= _isEnabled ? 1 : 0;
+    inputs |= _isTagged ? 2 : 0;
+    inputs |= _isCarryingFlag ? 4 : 0;
+    inputs |= isOpponentCarryingFlag() ? 8 : 0;
+    inputs |= checkInTeamZone() ? 16 : 0;
+    return inputs;
+}
+
+bool Agent::hasStateChangedSinceDecision() const {
+    return lastDecisionInputs < 0 || (lastDecisionInputs & ~32) != getStateInputs();
+}
+
+bool Agent::isFollowingPath() const {
+    return isActing && !path.empty() && currentDecision != BrainDecision::TagEnemy && currentDecision != BrainDecision::GrabFlag;
+}
+
+std::pair<int, int> Agent::getStepDirection() const {
+    // Direction of the next followPath step, held until the agent turns
+    if (!isFollowingPath()) {
+        return std::make_pair(0, 0);
+    }
+    const std::pair<int, int>& waypoint = path.front();
+    if (waypoint.first != positionX) {
+        return std::make_pair(waypoint.first > positionX ? 1 : -1, 0);
     }
+    return std::make_pair(0, waypoint.second > positionY ? 1 : (waypoint.second < positionY ? -1 : 0));
+}
+
+long long Agent::getRemainingPathLength() const {
+    long long length = 0;
+    std::pair<int, int> from(x, y);
+    for (const auto& waypoint : path) {
+        length += std::abs(waypoint.first - from.first) + std::abs(waypoint.second - from.second);
+        from = waypoint;
+    }
+    return length;
+}
+
+long long Agent::getQuietTicks(const std::vector<std::pair<int, int>>& otherAgentsPositions, bool teamCarryingFlag, long long limit) const {
+    // A disabled agent never does anything again
+    if (!_isEnabled) {
+        return limit;
+    }
+
+    // Memory entries age every tick, so a team that remembers anyone perceives every tick
+    if (blackboard->read().getTrackCount() > 0) {
+        return 0;
+    }
+
+    // The next decide() must see exactly what the last one saw
+    if (lastDecisionInputs != getDecisionInputs(otherAgentsPositions)) {
+        return 0;
+    }
+    bool inTeamZone = checkInTeamZone();
+    if (_isTagged && inTeamZone) {
+        return 0;
+    }
+
+    // Planning that would pick a new target, either by chance or towards home
+    std::pair<int, int> homePos = gameManager->getTeamZonePosition(side);
+    bool headsHome = currentDecision == BrainDecision::CaptureFlag || currentDecision == BrainDecision::ReturnToHomeZone;
+    if (isActing && currentDecision == BrainDecision::Explore && path.empty()) {
+        return 0;
+    }
+    if (isActing && headsHome && (path.empty() ? std::make_pair(x, y) != homePos : pathGoal != homePos)) {
+        return 0;
+    }
+
+    long long quietTicks = limit;
 
-    // checks if ai agent is tagged while carrying the flag
+    // A tagged carrier drops the flag whether or not it plays by the rules
     if (_isCarryingFlag && _isTagged) {
-        resetFlag();
+        return 0;
     }
+
+    if (appliesRules) {
+        // Flag rules that would fire right away. A grab waits on a teammate
+        // dropping the flag, which is an event of its own.
+        float flagDistance = distanceToEnemyFlag();
+        if ((!_isCarryingFlag && !_isTagged && flagDistance <= gameManager->getParams().flagReachDistance && !teamCarryingFlag) || (_isCarryingFlag && inTeamZone)) {
+            return 0;
+        }
+
+        // A tagger tries again on the tick its cooldown runs out
+        if (currentDecision == BrainDecision::TagEnemy) {
+            if (cooldownTimer <= 1) {
+                return 0;
+            }
+            quietTicks = std::min<long long>(quietTicks, cooldownTimer - 1);
+        }
+    }
+
+    if (!isFollowingPath()) {
+        return quietTicks;
+    }
+
+    // Count the ticks before the agent could reach the end of its path or
+    // cross a zone, flag or midline boundary. Rules see the position after
+    // each tick, so the last safe tick stays short of it. Off one cell a tick,
+    // or once avoidance pushed the agent off its cell, positions are
+    // fractional and rounding costs a cell of margin.
+    double cellsPerTick = getCellsPerTick();
+    bool onCell = positionX == x && positionY == y;
+    auto ticksToWalk = [cellsPerTick, onCell](double cells) {
+        if (cellsPerTick == 1.0 && onCell) {
+            return static_cast<long long>(std::floor(cells));
+        }
+        return std::max(0LL, static_cast<long long>(std::floor((cells - 1.0) / cellsPerTick)));
+    };
+    auto ticksBeforeCrossing = [&ticksToWalk](double distance, double threshold) {
+        return std::max(0LL, ticksToWalk(std::abs(distance - threshold)) - 1);
+    };
+    quietTicks = std::min(quietTicks, ticksToWalk(static_cast<double>(getRemainingPathLength())));
+
+    // Turning at the next corner changes the direction others have to account for
+    const std::pair<int, int>& waypoint = path.front();
+    quietTicks = std::min(quietTicks, ticksToWalk(waypoint.first != positionX ? std::abs(waypoint.first - positionX) : std::abs(waypoint.second - positionY)));
+
+    std::pair<int, int> flagPosition = gameManager->getFlagPosition(side);
+    double teamFlagDistance = std::hypot(x - flagPosition.first, y - flagPosition.second);
+    const GameParams& params = gameManager->getParams();
+    quietTicks = std::min(quietTicks, ticksBeforeCrossing(teamFlagDistance, params.teamZoneRadius + 1.0));
+    quietTicks = std::min(quietTicks, ticksBeforeCrossing(distanceToEnemyFlag(), params.flagReachDistance));
+
+    int midlineX = gameManager->getMidlineX();
+    quietTicks = std::min(quietTicks, ticksToWalk(x >= midlineX ? x - midlineX + 1 : midlineX - x) - 1);
+
+    return std::max(0LL, quietTicks);
 }
 
-bool Agent::isTeamCarryingFlag(const std::vector<std::shared_ptr<Agent>>& blueAgents, const std::vector<std::shared_ptr<Agent>>& redAgents) {
-    for (const auto& teammate : (getSide() == "blue" ? blueAgents : redAgents)) {
-        if (teammate.get() != this && teammate->isCarryingFlag()) {
-            return true;
+void Agent::fastForward(long long ticks) {
+    float cellsPerTick = getCellsPerTick();
+    if (isFollowingPath() && (cellsPerTick != 1.0f || positionX != x || positionY != y)) {
+        // Fractional walks repeat followPath tick by tick so rounding matches exactly
+        for (long long tick = 0; tick < ticks && !path.empty(); ++tick) {
+            walkPath(cellsPerTick);
         }
     }
-    return false;
+    else if (isFollowingPath()) {
+        // Same walk as followPath at one cell a tick: along x to the next corner, then along y
+        long long remaining = ticks;
+        while (remaining > 0 && !path.empty()) {
+            std::pair<int, int> waypoint = path.front();
+            long long stepX = std::min<long long>(remaining, std::abs(waypoint.first - x));
+            x += static_cast<int>(waypoint.first > x ? stepX : -stepX);
+            remaining -= stepX;
+
+            long long stepY = std::min<long long>(remaining, std::abs(waypoint.second - y));
+            y += static_cast<int>(waypoint.second > y ? stepY : -stepY);
+            remaining -= stepY;
+
+            if (std::make_pair(x, y) == waypoint) {
+                path.erase(path.begin());
+            }
+        }
+        positionX = static_cast<float>(x);
+        positionY = static_cast<float>(y);
+    }
+
+    if (appliesRules) {
+        cooldownTimer = static_cast<int>(std::max<long long>(0, cooldownTimer - ticks));
+    }
+
+    // Quiet ticks walk at full speed, or stand still off any path
+    if (ticks > 0) {
+        stuckTimer = 0;
+    }
+}
+
+void Agent::reportSighting(const Agent& opponent, int opponentX, int opponentY) {
+    blackboard->post(blackboardSlot, { opponent.getId(), opponentX, opponentY, opponent.isCarryingFlag() });
+}
+
+std::pair<int, int> Agent::getFacing() const {
+    std::pair<int, int> direction = getStepDirection();
+    if (direction.first != 0 || direction.second != 0) {
+        return direction;
+    }
+    return std::make_pair(side == "blue" ? 1 : -1, 0);
+}
+
+void Agent::setViewCone(float range, float angleDegrees) {
+    viewRange = std::max(0.0f, range);
+    viewAngle = std::max(0.0f, std::min(360.0f, angleDegrees));
+    viewHalfAngleCosine = static_cast<float>(std::cos(viewAngle * 3.14159265358979323846 / 360.0));
 }
 
 // prevent ai agents from spam tagging
@@ -134,8 +433,8 @@ void Agent::handleCooldownTimer() {
 }
 
 bool Agent::isInFavorablePosition() {
-    // Set a fixed proximity threshold value
-    const float proximityThreshold = 10.0f;
+    // Same reach as the brain's
+    const float proximityThreshold = gameManager->getParams().proximityThreshold;
 
     // Check if the agent is close enough to the enemy flag
     float distanceToFlag = distanceToEnemyFlag();
@@ -156,26 +455,17 @@ bool Agent::isInFavorablePosition() {
 std::vector<std::pair<int, int>> Agent::getEnemyAgentPositions() const {
     std::vector<std::pair<int, int>> enemyPositions;
 
-    const auto& opponentInfoMap = memory->getOpponentInfo();
-    for (const auto& entry : opponentInfoMap) {
-        const auto& position = entry.first;
-        double timeSinceLastSeen = memory->getTimeSinceLastSeen(position.first, position.second);
-
-        // Consider the opponent's position if it was seen recently
-        if (timeSinceLastSeen <= 5.0) {  // Adjust the time threshold as needed
-            enemyPositions.push_back(position);
-        }
+    // Memory forgets anyone not seen recently, so every track counts
+    const Memory& memory = blackboard->read();
+    for (int track = 0; track < memory.getTrackCount(); ++track) {
+        enemyPositions.push_back(memory.getTrackPosition(track));
     }
 
     return enemyPositions;
 }
 
 bool Agent::isOpponentCarryingFlag() const {
-    const auto& opponentInfoMap = memory->getOpponentInfo();
-    // iterate over opponenet info to find an opponent carrying the flag
-    return std::any_of(opponentInfoMap.begin(), opponentInfoMap.end(), [](const auto& entry) {
-        return std::get<0>(entry.second);
-        });
+    return blackboard->read().isAnyOpponentCarryingFlag();
 }
 
 std::pair<int, int> Agent::getEnemyFlagPosition() const {
@@ -201,30 +491,14 @@ float Agent::distanceToNearestEnemy(const std::vector<std::pair<int, int>>& othe
 }
 
 void Agent::exploreField() {
-    if (!path.empty()) {
-        std::pair<int, int> nextStep = path.front();
-        int newX = nextStep.first;
-        int newY = nextStep.second;
-
-        // Check if the new position is within the game field boundaries
-        if (isValidPosition(newX, newY)) {
-            x = newX;
-            y = newY;
-            path.erase(path.begin());
-        }
-        else {
-            // The new position is outside the game field boundaries
-            // Find an alternative path or direction to explore
-            findAlternativePath();
-        }
-    }
-    else {
+    if (path.empty()) {
         // Generate a new random target position within the game field boundaries
-        int targetX = std::rand() % gameFieldWidth;
-        int targetY = std::rand() % (gameFieldHeight - 1);  // Avoid the bottom row
+        int targetX = random.bounded(0, gameFieldWidth);
+        int targetY = random.bounded(0, gameFieldHeight - 1);  // Avoid the bottom row
 
         // Calculate a new path to the target position
-        path = pathfinder->findPath(x, y, targetX, targetY);
+        path = pathfinder->findWaypoints(x, y, targetX, targetY);
+        pathGoal = std::make_pair(targetX, targetY);
     }
 }
 
@@ -233,14 +507,14 @@ void Agent::moveTowardsEnemyFlag() {
     path = pathfinder->findPath(x, y, flagPos.first, flagPos.second);
 
     if (path.empty()) {
-        qDebug() << "No path to enemy flag found.";
+        qCDebug(agentLog) << "No path to enemy flag found.";
         return;
     }
 
     // Log the entire path for debugging
-    qDebug() << "Path to the enemy flag:";
+    qCDebug(agentLog) << "Path to the enemy flag:";
     for (const auto& step : path) {
-        qDebug() << "Step: (" << step.first << ", " << step.second << ")";
+        qCDebug(agentLog) << "Step: (" << step.first << ", " << step.second << ")";
     }
 
     // Attempt to follow the path
@@ -249,161 +523,75 @@ void Agent::moveTowardsEnemyFlag() {
         path.erase(path.begin());
 
         if (!isValidPosition(nextStep.first, nextStep.second)) {
-            qDebug() << "Invalid position reached, stopping movement.";
+            qCDebug(agentLog) << "Invalid position reached, stopping movement.";
             break;
         }
 
         // Move agent to the next step
-        x = nextStep.first;
-        y = nextStep.second;
-        qDebug() << "Moved to (" << x << ", " << y << ")";
-
-        if (distanceToEnemyFlag() <= 10) {
-            qDebug() << "Flag within reach, attempting to grab.";
-            if (grabFlag()) {
-                qDebug() << "Flag captured!";
-                break;
-            }
+        placeAt(nextStep.first, nextStep.second);
+        qCDebug(agentLog) << "Moved to (" << x << ", " << y << ")";
+
+        // The rules phase grabs the flag once it is within reach
+        if (distanceToEnemyFlag() <= gameManager->getParams().flagReachDistance) {
+            qCDebug(agentLog) << "Flag within reach.";
+            break;
         }
     }
 }
 
 void Agent::moveTowardsHomeZone() {
     std::pair<int, int> homePos = gameManager->getTeamZonePosition(side);
-    path = pathfinder->findPath(x, y, homePos.first, homePos.second);
-
-    if (!path.empty()) {
-        std::pair<int, int> nextStep = path.front();
-        int newX = nextStep.first;
-        int newY = nextStep.second;
-
-        // Validate the new position before updating
-        if (isValidPosition(newX, newY)) {
-            qDebug() << "Agent at (" << x << ", " << y << ") moving to (" << newX << ", " << newY << ") towards the home zone.";
-            x = newX;
-            y = newY;
-            path.erase(path.begin());
-        }
-        else {
-            // The new position is outside the game field boundaries
-            // Adjust the position to the nearest valid position or prevent the movement
-            // Example: Respawn the agent in the team area
-            findAlternativePath();
-        }
-    }
+    planPathTo(homePos.first, homePos.second);
 }
 
-void Agent::chaseOpponentWithFlag(const std::vector<std::pair<int, int>>& otherAgentsPositions) {
-    std::pair<int, int> opponentWithFlag = std::make_pair(-1, -1);
-    double minTimeSinceLastSeen = std::numeric_limits<double>::max();
-
-    for (const auto& position : otherAgentsPositions) {
-        bool hasFlag = memory->hasOpponentFlag(position.first, position.second);
-        if (hasFlag) {
-            double timeSinceLastSeen = memory->getTimeSinceLastSeen(position.first, position.second);
-            if (timeSinceLastSeen < minTimeSinceLastSeen) {
-                minTimeSinceLastSeen = timeSinceLastSeen;
-                opponentWithFlag = position;
-            }
-        }
-    }
-
-    if (opponentWithFlag.first != -1 && opponentWithFlag.second != -1) {
-        int opponentX = std::max(0, std::min(opponentWithFlag.first, gameFieldWidth - 1));
-        int opponentY = std::max(0, std::min(opponentWithFlag.second, gameFieldHeight - 1));
-
-        path = pathfinder->findPath(x, y, opponentX, opponentY);
-        if (!path.empty()) {
-            std::pair<int, int> nextStep = path.front();
-            int newX = std::max(0, std::min(nextStep.first, gameFieldWidth - 1));
-            int newY = std::max(0, std::min(nextStep.second, gameFieldHeight - 1));
-
-            // Check if the new position is within the game field boundaries
-            if (newX >= 0 && newX < gameFieldWidth && newY >= 0 && newY < gameFieldHeight) {
-                qDebug() << "Agent at (" << x << ", " << y << ") moving to (" << newX << ", " << newY << ") to chase the opponent with the flag.";
-                x = newX;
-                y = newY;
-                path.erase(path.begin());
-            }
-            else {
-                qDebug() << "Next position (" << newX << ", " << newY << ") is outside the game field boundaries.";
-                findAlternativePath();
-            }
-        }
-    }
-}
-
-void Agent::tagEnemy(std::vector<Agent*>& otherAgents) {
-    if (_isTagged || cooldownTimer > 0) {
+void Agent::planPathTo(int goalX, int goalY) {
+    // Only search again when the goal moved or the old path ran out
+    if (!path.empty() && pathGoal == std::make_pair(goalX, goalY)) {
         return;
     }
 
-    Agent* nearestEnemy = nullptr;
-    float minDistance = std::numeric_limits<float>::max();
-
-    // checks over each agent
-    for (Agent* agent : otherAgents) {
-        if (agent->side != side && !agent->isTagged() && agent->isOnEnemySide()) {
-            float distance = std::hypot(agent->x - x, agent->y - y);
-            if (distance < minDistance && distance <= taggingDistance) {
-                nearestEnemy = agent;
-                minDistance = distance;
-            }
-        }
-    }
-
-    if (nearestEnemy != nullptr) {
-        nearestEnemy->setIsTagged(true);
-        setCooldownTimer(getCooldownDuration());
-    }
+    path = pathfinder->findWaypoints(x, y, goalX, goalY);
+    pathGoal = std::make_pair(goalX, goalY);
 }
 
-bool Agent::isOnEnemySide() const {
-    return (side == "blue" && x >= 410) || (side == "red" && x < 410);
-}
+void Agent::chaseOpponentWithFlag() {
+    // Head for the carrier memory is surest of
+    int carrierTrack = -1;
+    float bestConfidence = 0.0f;
+    long long currentTick = gameManager->getClock().getTick();
 
-bool Agent::grabFlag() {
-    if (!_isCarryingFlag && !_isTagged && distanceToEnemyFlag() <= 10) {
-        _isCarryingFlag = true;
-        return true;
-    }
-    return false;
-}
-bool Agent::captureFlag() {
-    if (_isCarryingFlag && checkInTeamZone() && !_isTagged) {
-        _isCarryingFlag = false;
-
-        if (side == "blue") {
-            std::cout << "Blue flag captured!" << std::endl;
-        }
-        else {
-            std::cout << "Red flag captured!" << std::endl;
+    const Memory& memory = blackboard->read();
+    for (int track = 0; track < memory.getTrackCount(); ++track) {
+        float confidence = memory.getTrackConfidence(track, currentTick);
+        if (memory.isTrackCarryingFlag(track) && confidence > bestConfidence) {
+            bestConfidence = confidence;
+            carrierTrack = track;
         }
+    }
 
-        resetFlag();
+    if (carrierTrack >= 0) {
+        // Aim where the carrier will be by the time we get there, not where it was seen
+        std::pair<float, float> intercept = memory.getTrackIntercept(carrierTrack, positionX, positionY, getCellsPerTick());
+        int opponentX = std::max(0, std::min(static_cast<int>(std::lround(intercept.first)), gameFieldWidth - 1));
+        int opponentY = std::max(0, std::min(static_cast<int>(std::lround(intercept.second)), gameFieldHeight - 1));
 
-        return true;
+        qCDebug(agentLog) << "Agent at (" << x << ", " << y << ") cutting off the opponent with the flag at (" << opponentX << ", " << opponentY << ").";
+        planPathTo(opponentX, opponentY);
     }
-    return false;
 }
-void Agent::resetFlag() {
-    _isCarryingFlag = false;
 
-    if (side == "blue") {
-        std::cout << "Red flag reset!" << std::endl;
-    }
-    else {
-        std::cout << "Blue flag reset!" << std::endl;
-    }
+bool Agent::isOnEnemySide() const {
+    int midlineX = gameManager->getMidlineX();
+    return (side == "blue" && x >= midlineX) || (side == "red" && x < midlineX);
 }
 
 bool Agent::checkInTeamZone() const {
     if (gameManager == nullptr) {
         // Handle the case when the GameManager object is not initialized
-        qDebug() << "Error: GameManager is not initialized";
+        qCDebug(agentLog) << "Error: GameManager is not initialized";
         return false;
     }
-    int teamZoneRadius = 40;
+    int teamZoneRadius = gameManager->getParams().teamZoneRadius;
 
     // Get the current flag position based on the agent's side
     std::pair<int, int> flagPosition = gameManager->getFlagPosition(side);
@@ -421,20 +609,20 @@ void Agent::findAlternativePath() {
         // Move horizontally towards the enemy flag
         int flagX = gameManager->getEnemyFlagPosition(side).first;
         if (x < flagX) {
-            x++;
+            placeAt(x + 1, y);
         }
         else if (x > flagX) {
-            x--;
+            placeAt(x - 1, y);
         }
     }
     else {
         // Move vertically towards the enemy flag
         int flagY = gameManager->getEnemyFlagPosition(side).second;
         if (y < flagY) {
-            y++;
+            placeAt(x, y + 1);
         }
         else if (y > flagY) {
-            y--;
+            placeAt(x, y - 1);
         }
     }
 }
@@ -444,11 +632,47 @@ bool Agent::isValidPosition(int newX, int newY) const {
 }
 
 void Agent::setX(int newX) {
-    x = newX;
+    placeAt(newX, y);
 }
 
 void Agent::setY(int newY) {
+    placeAt(x, newY);
+}
+
+void Agent::placeAt(int newX, int newY) {
+    x = newX;
     y = newY;
+    positionX = static_cast<float>(newX);
+    positionY = static_cast<float>(newY);
+}
+
+void Agent::setPosition(float newX, float newY) {
+    positionX = std::max(0.0f, std::min(static_cast<float>(gameFieldWidth - 1), newX));
+    positionY = std::max(0.0f, std::min(static_cast<float>(gameFieldHeight - 1), newY));
+    x = static_cast<int>(std::lround(positionX));
+    y = static_cast<int>(std::lround(positionY));
+}
+
+void Agent::updateStuckTimer(float distanceMoved) {
+    // Walking at half speed or better counts as progress
+    if (!isFollowingPath() || distanceMoved >= 0.5f * getCellsPerTick()) {
+        stuckTimer = 0;
+        return;
+    }
+    if (++stuckTimer < stuckThreshold) {
+        return;
+    }
+    stuckTimer = 0;
+
+    // Leave along the other axis when the next corner allows it, otherwise
+    // drop the path so the next decision plans a new one
+    const std::pair<int, int>& waypoint = path.front();
+    if (waypoint.first != x && waypoint.second != y) {
+        path.insert(path.begin(), std::make_pair(x, waypoint.second));
+    }
+    else {
+        path.clear();
+    }
 }
 
 void Agent::decrementCooldownTimer() {
@@ -485,4 +709,83 @@ void Agent::setEnabled(bool enabled) {
 
 float Agent::distanceTo(const Agent* otherAgent) const {
     return std::hypot(otherAgent->x - x, otherAgent->y - y);
-}
\ No newline at end of file
+}
+
+void Agent::saveState(BinaryWriter& writer) const {
+    writer.writeInt32(id);
+    writer.writeInt32(x);
+    writer.writeInt32(y);
+    writer.writeFloat(positionX);
+    writer.writeFloat(positionY);
+    writer.writeFloat(movementSpeed);
+    writer.writeFloat(viewRange);
+    writer.writeFloat(viewAngle);
+    writer.writeBool(_isCarryingFlag);
+    writer.writeBool(_isTagged);
+    writer.writeInt32(cooldownTimer);
+    writer.writeFloat(taggingDistance);
+
+    writer.writeUInt32(static_cast<uint32_t>(path.size()));
+    for (const auto& waypoint : path) {
+        writer.writeInt32(waypoint.first);
+        writer.writeInt32(waypoint.second);
+    }
+    writer.writeInt32(pathGoal.first);
+    writer.writeInt32(pathGoal.second);
+
+    writer.writeUInt8(static_cast<uint8_t>(currentDecision));
+    writer.writeBool(isActing);
+    writer.writeBool(appliesRules);
+    writer.writeInt32(lastDecisionInputs);
+    writer.writeBool(_isEnabled);
+    writer.writeInt32(previousX);
+    writer.writeInt32(previousY);
+    writer.writeInt32(stuckTimer);
+    writer.writeUInt64(random.getPosition());
+
+    brain->saveState(writer);
+}
+
+void Agent::loadState(BinaryReader& reader) {
+    id = reader.readInt32();
+    x = reader.readInt32();
+    y = reader.readInt32();
+    positionX = reader.readFloat();
+    positionY = reader.readFloat();
+    movementSpeed = reader.readFloat();
+    float savedViewRange = reader.readFloat();
+    float savedViewAngle = reader.readFloat();
+    setViewCone(savedViewRange, savedViewAngle);
+    _isCarryingFlag = reader.readBool();
+    _isTagged = reader.readBool();
+    cooldownTimer = reader.readInt32();
+    taggingDistance = reader.readFloat();
+
+    uint32_t waypointCount = reader.readUInt32();
+    path.clear();
+    for (uint32_t i = 0; i < waypointCount && !reader.hasFailed(); ++i) {
+        int waypointX = reader.readInt32();
+        int waypointY = reader.readInt32();
+        path.emplace_back(waypointX, waypointY);
+    }
+    pathGoal.first = reader.readInt32();
+    pathGoal.second = reader.readInt32();
+
+    currentDecision = static_cast<BrainDecision>(reader.readUInt8());
+    isActing = reader.readBool();
+    appliesRules = reader.readBool();
+    lastDecisionInputs = reader.readInt32();
+    _isEnabled = reader.readBool();
+    previousX = reader.readInt32();
+    previousY = reader.readInt32();
+    stuckTimer = reader.readInt32();
+
+    // The stream is keyed by match seed and id, so rebuild it before seeking
+    uint64_t randomPosition = reader.readUInt64();
+    if (random.getSeed() != gameManager->getMatchSeed() || random.getStream() != static_cast<uint32_t>(id)) {
+        random = RandomStream(gameManager->getMatchSeed(), static_cast<uint32_t>(id));
+    }
+    random.setPosition(randomPosition);
+
+    brain->loadState(reader);
+}
@@ -1,47 +1,119 @@
 #ifndef AGENT_H
 #define AGENT_H
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <utility>
 #include "Pathfinder.h"
 #include "Brain.h"
 #include "Memory.h"
+#include "TeamBlackboard.h"
 #include "GameManager.h"
-#include <QObject>
+#include "RandomStream.h"
+#include "RuleIntent.h"
 
-class Agent : public QObject {
-    Q_OBJECT
+class BinaryWriter;
+class BinaryReader;
 
+class Agent {
 private:
+    int id;
+    // Cell the agent occupies; rules, perception and paths all work on cells
     int x, y;
+    // Continuous position along the path, x and y are this rounded
+    float positionX, positionY;
+    // Cells per second of game time
+    float movementSpeed;
+    // Field of view: how far in cells, and how wide in degrees, centred on the facing
+    float viewRange;
+    float viewAngle;
+    float viewHalfAngleCosine;
     int gameFieldWidth, gameFieldHeight;
     std::shared_ptr<Pathfinder> pathfinder;
     std::shared_ptr<Brain> brain;
-    std::shared_ptr<Memory> memory;
+    // Opponent memory is the team's, this agent posts into its own slot
+    std::shared_ptr<TeamBlackboard> blackboard;
+    int blackboardSlot;
     std::shared_ptr<GameManager> gameManager;
     bool _isCarryingFlag;
     bool _isTagged;
     int cooldownTimer;
-    static const int cooldownDuration = 30;
     float taggingDistance;
+    // Corners still ahead on the current path, see Pathfinder::findWaypoints
     std::vector<std::pair<int, int>> path;
+    std::pair<int, int> pathGoal;
+    BrainDecision currentDecision;
+    bool isActing;
+    bool appliesRules;
+    int lastDecisionInputs;
     bool _isEnabled;
     int previousX, previousY;
     int stuckTimer;
     static const int stuckThreshold = 5;
     std::string side;
+    RandomStream random;
 
 public:
-    Agent(int x, int y, std::string side, int gameFieldWidth, int gameFieldHeight,
+    // One cell a second walks one cell per tick at the default tick length
+    static constexpr float defaultMovementSpeed = 1.0f;
+
+    Agent(int id, int x, int y, std::string side, int gameFieldWidth, int gameFieldHeight,
           const std::shared_ptr<Pathfinder>& pathfinder, float taggingDistance,
-          const std::shared_ptr<Brain>& brain, const std::shared_ptr<Memory>& memory,
+          const std::shared_ptr<Brain>& brain, const std::shared_ptr<TeamBlackboard>& blackboard, int blackboardSlot,
           const std::shared_ptr<GameManager>& gameManager,
           std::vector<std::shared_ptr<Agent>>& blueAgents, std::vector<std::shared_ptr<Agent>>& redAgents);
 
-    void update(const std::vector<std::pair<int, int>>& otherAgentsPositions, std::vector<Agent*>& otherAgents, const std::vector<std::shared_ptr<Agent>>& blueAgents, const std::vector<std::shared_ptr<Agent>>& redAgents, int elapsedTime);
-    void updateMemory(const std::vector<std::pair<int, int>>& otherAgentsPositions);
-    void handleFlagInteractions(const std::vector<std::shared_ptr<Agent>>& blueAgents, const std::vector<std::shared_ptr<Agent>>& redAgents);
+    // Puts a pooled agent back in the state the constructor leaves it in,
+    // keeping its brain and path storage, see Simulation::setupAgents
+    void reset(int newId, int newX, int newY, const std::string& newSide, const std::shared_ptr<TeamBlackboard>& newBlackboard, int newBlackboardSlot);
+
+    // Posts an opponent in view to the team blackboard, which takes it in after perception
+    void reportSighting(const Agent& opponent, int opponentX, int opponentY);
+
+    // Agents look the way they are walking, and towards the enemy side while standing
+    std::pair<int, int> getFacing() const;
+    float getViewRange() const { return viewRange; }
+    float getViewAngle() const { return viewAngle; }
+    float getViewHalfAngleCosine() const { return viewHalfAngleCosine; }
+    void setViewCone(float range, float angleDegrees);
+
+    // Tick phases, run in this order by GameField's tick graph. The
+    // positions are the opponents in view, nearest first.
+    void decide(const std::vector<std::pair<int, int>>& otherAgentsPositions);
+    // decide() in two halves, for brains that decide for many agents at once:
+    // beginDecision returns false when the agent settled it without a brain
+    bool beginDecision(const std::vector<std::pair<int, int>>& otherAgentsPositions, DecisionInputs& inputs);
+    void finishDecision(BrainDecision decision);
+    void planPath();
+    void followPath();
+    // Flag and tag rules are resolved for everyone at once, see TagManager and FlagManager
+    RuleIntent submitIntent();
+
+    // Event-driven skipping. getQuietTicks is how many upcoming ticks, at most
+    // limit, would only walk the current path and count down the cooldown;
+    // 0 means the next tick needs the full pipeline. Proximity to other agents
+    // is the caller's job. fastForward applies that many quiet ticks at once.
+    int getDecisionInputs(const std::vector<std::pair<int, int>>& otherAgentsPositions) const;
+    int getStateInputs() const;
+    bool hasStateChangedSinceDecision() const;
+    long long getQuietTicks(const std::vector<std::pair<int, int>>& otherAgentsPositions, bool teamCarryingFlag, long long limit) const;
+    void fastForward(long long ticks);
+    bool isFollowingPath() const;
+    float getCellsPerTick() const;
+    long long getRemainingPathLength() const;
+    std::pair<int, int> getStepDirection() const;
+
+    // Everything the agent and its brain carry between ticks; the team's memory is saved with the team
+    void saveState(BinaryWriter& writer) const;
+    void loadState(BinaryReader& reader);
+
+    void walkPath(float distance);
+    int getRuleRegion() const;
+    void placeAt(int newX, int newY);
+    // Collision avoidance moves agents off their cells and sometimes holds them back
+    void setPosition(float newX, float newY);
+    void updateStuckTimer(float distanceMoved);
     void handleCooldownTimer();
     bool isOpponentCarryingFlag() const;
     std::pair<int, int> getEnemyFlagPosition() const;
@@ -53,40 +125,38 @@ public:
     void exploreField();
     void moveTowardsEnemyFlag();
     void moveTowardsHomeZone();
-    void chaseOpponentWithFlag(const std::vector<std::pair<int, int>>& otherAgentsPositions);
-    void tagEnemy(std::vector<Agent*>& otherAgents);
+    void planPathTo(int goalX, int goalY);
+    void chaseOpponentWithFlag();
     bool isOnEnemySide() const;
-    bool grabFlag();
-    bool captureFlag();
-    void resetFlag();
     bool checkInTeamZone() const;
     std::pair<int, int> getDirectionToOpponent(int opponentX, int opponentY) const;
     void setIsTagged(bool val);
     bool isTagged() const;
     bool isCarryingFlag() const;
     void setCarryingFlag(bool carrying);
+    int getId() const { return id; }
     int getX() const { return x; }
     int getY() const { return y; }
     void setX(int newX);
     void setY(int newY);
+    float getPositionX() const { return positionX; }
+    float getPositionY() const { return positionY; }
+    float getMovementSpeed() const { return movementSpeed; }
+    void setMovementSpeed(float cellsPerSecond) { movementSpeed = cellsPerSecond; }
     void setEnabled(bool enabled);
+    bool isEnabled() const { return _isEnabled; }
     void decrementCooldownTimer();
     const std::shared_ptr<Brain>& getBrain() const { return brain; }
-    const std::shared_ptr<Memory>& getMemory() const { return memory; }
-    bool isTeamCarryingFlag(const std::vector<std::shared_ptr<Agent>>& blueAgents, const std::vector<std::shared_ptr<Agent>>& redAgents);
-    std::string getSide() const { return side; }
+    const Memory& getMemory() const { return blackboard->read(); }
+    const std::string& getSide() const { return side; }
     float getTaggingDistance() const { return taggingDistance; }
     int getCooldownTimer() const { return cooldownTimer; }
-    int getCooldownDuration() const { return cooldownDuration; }
+    // Game seconds, from the game's parameters
+    int getCooldownDuration() const { return gameManager->getParams().tagCooldownSeconds; }
     void setCooldownTimer(int value) { cooldownTimer = value; }
+    BrainDecision getCurrentDecision() const { return currentDecision; }
     bool isInFavorablePosition();
     std::vector<std::pair<int, int>> getEnemyAgentPositions() const;
-
-signals:
-    void blueFlagCaptured();
-    void redFlagCaptured();
-    void blueFlagReset();
-    void redFlagReset();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "AgentLayerItem.h"
+#include <QPainter>
+#include <QPen>
+
+AgentLayerItem::AgentLayerItem(const std::vector<std::shared_ptr<Agent>>& blueAgents, const std::vector<std::shared_ptr<Agent>>& redAgents, const QRectF& bounds)
+    : blueAgents(blueAgents), redAgents(redAgents), bounds(bounds), replayFrame(nullptr), replayBlueCount(0) {
+    setCacheMode(QGraphicsItem::NoCache);
+}
+
+void AgentLayerItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) {
+    Q_UNUSED(option);
+    Q_UNUSED(widget);
+
+    bluePoints.clear();
+    redPoints.clear();
+    carrierPoints.clear();
+    taggedPoints.clear();
+    if (replayFrame) {
+        collectReplayPoints();
+    }
+    else {
+        collectPoints(blueAgents, bluePoints, carrierPoints);
+        collectPoints(redAgents, redPoints, carrierPoints);
+    }
+
+    // Cosmetic pens stay a few pixels wide however far the view is zoomed out
+    painter->setRenderHint(QPainter::Antialiasing, false);
+    QPen pen(Qt::blue, 2);
+    pen.setCosmetic(true);
+    painter->setPen(pen);
+    painter->drawPoints(bluePoints.constData(), bluePoints.size());
+
+    pen.setColor(Qt::red);
+    painter->setPen(pen);
+    painter->drawPoints(redPoints.constData(), redPoints.size());
+
+    pen.setColor(Qt::yellow);
+    pen.setWidth(4);
+    painter->setPen(pen);
+    painter->drawPoints(taggedPoints.constData(), taggedPoints.size());
+
+    // Flag carriers last so they are never hidden under a crowd
+    pen.setColor(Qt::green);
+    pen.setWidth(6);
+    painter->setPen(pen);
+    painter->drawPoints(carrierPoints.constData(), carrierPoints.size());
+}
+
+void AgentLayerItem::collectPoints(const std::vector<std::shared_ptr<Agent>>& agents, QVector<QPointF>& points, QVector<QPointF>& carriers) {
+    for (const auto& agent : agents) {
+        QPointF point(agent->getX(), agent->getY());
+        if (agent->isCarryingFlag()) {
+            carriers.append(point);
+        }
+        else if (agent->isTagged()) {
+            taggedPoints.append(point);
+        }
+        else {
+            points.append(point);
+        }
+    }
+}
+
+void AgentLayerItem::setReplayFrame(const ReplayFrame* frame, int blueCount) {
+    replayFrame = frame;
+    replayBlueCount = blueCount;
+    update();
+}
+
+void AgentLayerItem::collectReplayPoints() {
+    for (size_t i = 0; i < replayFrame->agents.size(); ++i) {
+        const ReplayAgentState& state = replayFrame->agents[i];
+        QPointF point(state.x, state.y);
+        if (state.flags & ReplayFormat::carryingFlag) {
+            carrierPoints.append(point);
+        }
+        else if (state.flags & ReplayFormat::taggedFlag) {
+            taggedPoints.append(point);
+        }
+        else {
+            (static_cast<int>(i) < replayBlueCount ? bluePoints : redPoints).append(point);
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef AGENTLAYERITEM_H
+#define AGENTLAYERITEM_H
+
+#include <QGraphicsItem>
+#include <QPointF>
+#include <QVector>
+#include <memory>
+#include <vector>
+#include "Agent.h"
+#include "ReplayFormat.h"
+
+// Draws a whole match's agents as one scene item. Past a few thousand
+// agents one ellipse item each costs more in scene bookkeeping than the
+// simulation does per tick, so the large-scale view paints points instead.
+class AgentLayerItem : public QGraphicsItem {
+public:
+    AgentLayerItem(const std::vector<std::shared_ptr<Agent>>& blueAgents, const std::vector<std::shared_ptr<Agent>>& redAgents, const QRectF& bounds);
+
+    QRectF boundingRect() const override { return bounds; }
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) override;
+
+    // Draws this replay frame instead of the agents; blue agents come first
+    void setReplayFrame(const ReplayFrame* frame, int blueCount);
+
+private:
+    void collectPoints(const std::vector<std::shared_ptr<Agent>>& agents, QVector<QPointF>& points, QVector<QPointF>& carriers);
+    void collectReplayPoints();
+
+    const std::vector<std::shared_ptr<Agent>>& blueAgents;
+    const std::vector<std::shared_ptr<Agent>>& redAgents;
+    QRectF bounds;
+    const ReplayFrame* replayFrame;
+    int replayBlueCount;
+
+    // Reused from frame to frame
+    QVector<QPointF> bluePoints;
+    QVector<QPointF> redPoints;
+    QVector<QPointF> carrierPoints;
+    QVector<QPointF> taggedPoints;
+};
+
+#endif
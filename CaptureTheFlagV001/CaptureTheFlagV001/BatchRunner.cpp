@@ -0,0 +1,247 @@
+#include "BatchRunner.h"
+#include "Simulation.h"
+#include "ReplayWriter.h"
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+
+BatchRunner::BatchRunner(const MatchConfig& config)
+    : config(config), writeJsonLines(false) {
+    const std::string jsonExtension = ".jsonl";
+    writeJsonLines = config.outputPath.size() >= jsonExtension.size() &&
+        config.outputPath.compare(config.outputPath.size() - jsonExtension.size(), jsonExtension.size(), jsonExtension) == 0;
+}
+
+int BatchRunner::run() {
+    output.open(config.outputPath, std::ios::out | std::ios::trunc);
+    if (!output) {
+        std::cerr << "Could not open " << config.outputPath << " for writing" << std::endl;
+        return 1;
+    }
+    writeHeader();
+
+    int threadCount = config.threadCount > 0 ? config.threadCount : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    threadCount = std::min(threadCount, std::max(1, config.matchCount));
+
+    std::cerr << "Running " << config.matchCount << " matches on " << threadCount << " threads" << std::endl;
+
+    // Workers pull match indices until the batch runs dry, so slow matches never leave cores idle
+    std::atomic<int> nextMatch(0);
+    std::atomic<int> finishedMatches(0);
+    auto batchStart = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threadCount; ++i) {
+        workers.emplace_back([this, &nextMatch, &finishedMatches]() {
+            // Each worker plays all its matches on one simulation, reusing its agents
+            std::unique_ptr<Simulation> simulation;
+            for (int index = nextMatch++; index < config.matchCount; index = nextMatch++) {
+                writeResult(runMatch(index, simulation));
+
+                int finished = ++finishedMatches;
+                if (finished % 100 == 0) {
+                    std::cerr << finished << " / " << config.matchCount << " matches done" << std::endl;
+                }
+            }
+        });
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - batchStart).count();
+    std::cerr << "Batch finished in " << seconds << " s (" << config.matchCount / std::max(seconds, 1e-9) << " matches/s)" << std::endl;
+    return 0;
+}
+
+MatchResult BatchRunner::runMatch(int matchIndex, std::unique_ptr<Simulation>& workerSimulation) const {
+    uint64_t seed = config.firstSeed + static_cast<uint64_t>(matchIndex);
+
+    // One worker inside the engine: parallelism comes from running matches side by side
+    if (!workerSimulation) {
+        workerSimulation = std::make_unique<Simulation>(config.gameFieldWidth, config.gameFieldHeight, seed, 1);
+        workerSimulation->setGameDuration(config.gameDuration);
+        workerSimulation->setEventSkipping(config.eventSkipping);
+        workerSimulation->setDecisionInterval(config.decisionInterval);
+        workerSimulation->setTickMillis(config.tickMillis);
+        workerSimulation->setMovementSpeed(config.movementSpeed);
+        workerSimulation->setCollisionAvoidance(config.collisionAvoidance);
+        workerSimulation->setParams(config.params);
+    }
+    else {
+        workerSimulation->resetMatch(seed);
+    }
+    Simulation& simulation = *workerSimulation;
+    simulation.setupAgents(config.blueCount, config.redCount);
+
+    // A replay wants every tick, so recording matches step instead of skipping
+    ReplayWriter replay;
+    if (!config.replayDirectory.empty()) {
+        std::string error;
+        std::string path = config.replayDirectory + "/match_" + std::to_string(matchIndex) + ".ctfr";
+        if (!replay.open(path, simulation, error)) {
+            std::cerr << error << std::endl;
+        }
+    }
+    long long ticksPerAdvance = replay.isOpen() ? 1 : std::numeric_limits<long long>::max();
+
+    auto matchStart = std::chrono::steady_clock::now();
+    while (!simulation.isFinished()) {
+        simulation.advance(ticksPerAdvance);
+        replay.recordFrame(simulation);
+    }
+    double wallMillis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - matchStart).count();
+
+    const MatchStats& stats = simulation.getStats();
+    MatchResult result;
+    result.matchIndex = matchIndex;
+    result.seed = seed;
+    result.blueScore = simulation.getBlueScore();
+    result.redScore = simulation.getRedScore();
+    result.blueCaptures = stats.blueCaptures;
+    result.redCaptures = stats.redCaptures;
+    result.blueGrabs = stats.blueGrabs;
+    result.redGrabs = stats.redGrabs;
+    result.blueTags = stats.blueTags;
+    result.redTags = stats.redTags;
+    result.ticks = simulation.getTick();
+    result.skippedTicks = simulation.getSkippedTicks();
+    result.meanDecisionsPerTick = simulation.getDecisionLoad().getMean();
+    result.peakDecisionsPerTick = simulation.getDecisionLoad().peak;
+    result.meanTickMicros = result.ticks > 0 ? wallMillis * 1000.0 / result.ticks : 0.0;
+    result.wallMillis = wallMillis;
+
+    std::string error;
+    if (!replay.close(error)) {
+        std::cerr << error << std::endl;
+    }
+    return result;
+}
+
+void BatchRunner::writeHeader() {
+    if (!writeJsonLines) {
+        output << "match,seed,blue_score,red_score,blue_captures,red_captures,blue_grabs,red_grabs,blue_tags,red_tags,ticks,skipped_ticks,mean_decisions,peak_decisions,mean_tick_us,wall_ms\n";
+        output.flush();
+    }
+}
+
+void BatchRunner::writeResult(const MatchResult& result) {
+    std::lock_guard<std::mutex> lock(outputMutex);
+
+    if (writeJsonLines) {
+        output << "{\"match\":" << result.matchIndex
+            << ",\"seed\":" << result.seed
+            << ",\"blue_score\":" << result.blueScore
+            << ",\"red_score\":" << result.redScore
+            << ",\"blue_captures\":" << result.blueCaptures
+            << ",\"red_captures\":" << result.redCaptures
+            << ",\"blue_grabs\":" << result.blueGrabs
+            << ",\"red_grabs\":" << result.redGrabs
+            << ",\"blue_tags\":" << result.blueTags
+            << ",\"red_tags\":" << result.redTags
+            << ",\"ticks\":" << result.ticks
+            << ",\"skipped_ticks\":" << result.skippedTicks
+            << ",\"mean_decisions\":" << result.meanDecisionsPerTick
+            << ",\"peak_decisions\":" << result.peakDecisionsPerTick
+            << ",\"mean_tick_us\":" << result.meanTickMicros
+            << ",\"wall_ms\":" << result.wallMillis << "}\n";
+    }
+    else {
+        output << result.matchIndex << ',' << result.seed << ','
+            << result.blueScore << ',' << result.redScore << ','
+            << result.blueCaptures << ',' << result.redCaptures << ','
+            << result.blueGrabs << ',' << result.redGrabs << ','
+            << result.blueTags << ',' << result.redTags << ','
+            << result.ticks << ',' << result.skippedTicks << ','
+            << result.meanDecisionsPerTick << ',' << result.peakDecisionsPerTick << ',' << result.meanTickMicros << ',' << result.wallMillis << '\n';
+    }
+
+    // Flush per match so partial batches are still usable
+    output.flush();
+}
+
+bool BatchRunner::parseArguments(const QStringList& arguments, MatchConfig& config, std::string& error) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Runs capture the flag matches without a window");
+    QCommandLineOption batchOption("batch", "Run headless matches and exit.");
+    QCommandLineOption matchesOption("matches", "Number of matches.", "count", "100");
+    QCommandLineOption blueOption("blue", "Blue agents per match.", "count", "4");
+    QCommandLineOption redOption("red", "Red agents per match.", "count", "4");
+    QCommandLineOption widthOption("width", "Game field width.", "pixels", "800");
+    QCommandLineOption heightOption("height", "Game field height.", "pixels", "600");
+    QCommandLineOption seedOption("seed", "Seed of the first match, match i uses seed + i.", "seed", QString::number(GameManager::defaultMatchSeed));
+    QCommandLineOption durationOption("duration", "Game time per match in seconds.", "seconds", "600");
+    QCommandLineOption threadsOption("threads", "Worker threads, 0 uses every core.", "count", "0");
+    QCommandLineOption outputOption("output", "Result file, .jsonl for JSON lines, CSV otherwise.", "path", "batch_results.csv");
+    QCommandLineOption noSkipOption("no-event-skipping", "Step every tick instead of jumping over quiet ones.");
+    QCommandLineOption decisionIntervalOption("decision-interval", "Ticks between decisions for agents far from contact.", "ticks", "1");
+    QCommandLineOption tickOption("tick-ms", "Game milliseconds per tick; longer ticks walk agents further each.", "ms", "1000");
+    QCommandLineOption speedOption("speed", "Agent speed in cells per game second.", "cells", "1");
+    QCommandLineOption noAvoidanceOption("no-avoidance", "Let agents walk through each other.");
+    QCommandLineOption replayDirectoryOption("replay-dir", "Record a replay of every match into this directory.", "directory");
+    QCommandLineOption paramsOption("params", "Game parameter file, see GameParams.", "path");
+    parser.addOptions({ batchOption, matchesOption, blueOption, redOption, widthOption, heightOption,
+        seedOption, durationOption, threadsOption, outputOption, noSkipOption, decisionIntervalOption, tickOption, speedOption, noAvoidanceOption, replayDirectoryOption, paramsOption });
+
+    if (!parser.parse(arguments)) {
+        error = parser.errorText().toStdString();
+        return false;
+    }
+
+    bool ok = true;
+    bool allOk = true;
+    config.matchCount = parser.value(matchesOption).toInt(&ok); allOk &= ok;
+    config.blueCount = parser.value(blueOption).toInt(&ok); allOk &= ok;
+    config.redCount = parser.value(redOption).toInt(&ok); allOk &= ok;
+    config.gameFieldWidth = parser.value(widthOption).toInt(&ok); allOk &= ok;
+    config.gameFieldHeight = parser.value(heightOption).toInt(&ok); allOk &= ok;
+    config.firstSeed = parser.value(seedOption).toULongLong(&ok); allOk &= ok;
+    config.gameDuration = parser.value(durationOption).toInt(&ok); allOk &= ok;
+    config.threadCount = parser.value(threadsOption).toInt(&ok); allOk &= ok;
+    config.decisionInterval = parser.value(decisionIntervalOption).toInt(&ok); allOk &= ok;
+    config.tickMillis = parser.value(tickOption).toInt(&ok); allOk &= ok;
+    config.movementSpeed = parser.value(speedOption).toFloat(&ok); allOk &= ok;
+    config.outputPath = parser.value(outputOption).toStdString();
+    config.replayDirectory = parser.value(replayDirectoryOption).toStdString();
+    config.eventSkipping = !parser.isSet(noSkipOption);
+    config.collisionAvoidance = !parser.isSet(noAvoidanceOption);
+
+    if (!allOk) {
+        error = "Every numeric option needs a number";
+        return false;
+    }
+    if (config.matchCount < 0 || config.blueCount < 0 || config.redCount < 0 || config.gameFieldWidth < 200 || config.gameFieldHeight < 100 || config.decisionInterval < 1 ||
+        config.tickMillis < 1 || config.movementSpeed <= 0.0f) {
+        error = "Counts must not be negative, the decision interval and tick length must be at least 1, the speed positive and the field at least 200 x 100";
+        return false;
+    }
+    config.params = GameParams();
+    if (parser.isSet(paramsOption) && !GameParams::loadFile(parser.value(paramsOption).toStdString(), config.params, error)) {
+        return false;
+    }
+    return true;
+}
+
+int BatchRunner::runFromArguments(const QStringList& arguments) {
+    MatchConfig config;
+    std::string error;
+    if (!parseArguments(arguments, config, error)) {
+        std::cerr << error << std::endl;
+        return 2;
+    }
+
+    // Per-agent and per-match debug logging would serialise every worker
+    // on one stream
+    QLoggingCategory::setFilterRules("*.debug=false");
+
+    BatchRunner runner(config);
+    return runner.run();
+}
@@ -0,0 +1,80 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <QStringList>
+#include "GameParams.h"
+
+class Simulation;
+
+// Match setup shared by every match in a batch; match i uses firstSeed + i
+struct MatchConfig {
+    int matchCount;
+    int blueCount;
+    int redCount;
+    int gameFieldWidth;
+    int gameFieldHeight;
+    uint64_t firstSeed;
+    int gameDuration;
+    int threadCount;
+    bool eventSkipping;
+    int decisionInterval;
+    // Game time per tick and agent speed in cells per game second
+    int tickMillis;
+    float movementSpeed;
+    bool collisionAvoidance;
+    // Parsed once from --params, defaults otherwise
+    GameParams params;
+    std::string outputPath;
+    // Writes match_<index>.ctfr replays here when not empty
+    std::string replayDirectory;
+};
+
+struct MatchResult {
+    int matchIndex;
+    uint64_t seed;
+    int blueScore;
+    int redScore;
+    int blueCaptures;
+    int redCaptures;
+    int blueGrabs;
+    int redGrabs;
+    int blueTags;
+    int redTags;
+    long long ticks;
+    long long skippedTicks;
+    double meanDecisionsPerTick;
+    int peakDecisionsPerTick;
+    double meanTickMicros;
+    double wallMillis;
+};
+
+// Runs many headless matches at once, one Simulation per worker thread.
+// Matches share nothing mutable; only the result file is locked, once per
+// finished match. Results go out as CSV, or JSON lines for a .jsonl path.
+class BatchRunner {
+public:
+    explicit BatchRunner(const MatchConfig& config);
+
+    // Returns a process exit code
+    int run();
+
+    static bool parseArguments(const QStringList& arguments, MatchConfig& config, std::string& error);
+    static int runFromArguments(const QStringList& arguments);
+
+private:
+    MatchResult runMatch(int matchIndex, std::unique_ptr<Simulation>& workerSimulation) const;
+    void writeHeader();
+    void writeResult(const MatchResult& result);
+
+    MatchConfig config;
+    bool writeJsonLines;
+    std::ofstream output;
+    std::mutex outputMutex;
+};
+
+#endif
@@ -0,0 +1,326 @@
+#include "BehaviourTree.h"
+#include "BinaryStream.h"
+#include <algorithm>
+
+BehaviourTree::BehaviourTree() : finished(false) {}
+
+void BehaviourTree::add(BehaviourNodeType type, uint8_t value, uint16_t ticks) {
+    if (finished) {
+        buildError = "Nodes cannot be added to a finished tree";
+        return;
+    }
+    if (nodes.size() >= static_cast<size_t>(maxNodes)) {
+        buildError = "A tree holds at most " + std::to_string(maxNodes) + " nodes";
+        return;
+    }
+    if (openNodes.empty() && !nodes.empty()) {
+        buildError = "A tree has a single root";
+        return;
+    }
+
+    BehaviourNode node;
+    node.type = type;
+    node.value = value;
+    node.ticks = ticks;
+    node.end = static_cast<uint16_t>(nodes.size() + 1);
+    node.parent = static_cast<int16_t>(openNodes.empty() ? -1 : openNodes.back());
+    nodes.push_back(node);
+}
+
+void BehaviourTree::beginSelector() {
+    add(BehaviourNodeType::Selector, 0, 0);
+    openNodes.push_back(static_cast<int>(nodes.size()) - 1);
+}
+
+void BehaviourTree::beginSequence() {
+    add(BehaviourNodeType::Sequence, 0, 0);
+    openNodes.push_back(static_cast<int>(nodes.size()) - 1);
+}
+
+void BehaviourTree::condition(BehaviourFact fact, bool expected) {
+    add(expected ? BehaviourNodeType::Condition : BehaviourNodeType::ConditionNot, static_cast<uint8_t>(fact), 0);
+}
+
+void BehaviourTree::action(BrainDecision decision, int ticks) {
+    add(BehaviourNodeType::Action, static_cast<uint8_t>(decision), static_cast<uint16_t>(std::max(1, std::min(ticks, 65535))));
+}
+
+void BehaviourTree::end() {
+    if (openNodes.empty()) {
+        buildError = "end() without a matching begin";
+        return;
+    }
+    nodes[openNodes.back()].end = static_cast<uint16_t>(nodes.size());
+    openNodes.pop_back();
+}
+
+bool BehaviourTree::finish(std::string& error) {
+    if (!buildError.empty()) {
+        error = buildError;
+        return false;
+    }
+    if (nodes.empty()) {
+        error = "A tree needs at least one node";
+        return false;
+    }
+    if (!openNodes.empty()) {
+        error = std::to_string(openNodes.size()) + " composites were never ended";
+        return false;
+    }
+    finished = true;
+    compile();
+    return true;
+}
+
+void BehaviourTree::compile() {
+    rootActions.assign(size_t(1) << factCount, -1);
+    for (size_t facts = 0; facts < rootActions.size(); ++facts) {
+        BehaviourBlackboard blackboard;
+        blackboard.facts = static_cast<uint16_t>(facts);
+        if (evaluate(0, blackboard) == Status::Running) {
+            rootActions[facts] = blackboard.runningNode;
+        }
+    }
+
+    // Done with the last child of every sequence above it, selectors
+    // finishing as soon as any child succeeds
+    finishesTree.assign(nodes.size(), 0);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i].type != BehaviourNodeType::Action) {
+            continue;
+        }
+        int index = static_cast<int>(i);
+        bool finishes = true;
+        while (finishes && nodes[index].parent >= 0) {
+            int parent = nodes[index].parent;
+            finishes = nodes[parent].type == BehaviourNodeType::Selector || nodes[index].end == nodes[parent].end;
+            index = parent;
+        }
+        finishesTree[i] = finishes ? 1 : 0;
+    }
+}
+
+void BehaviourTree::startAction(int index, BehaviourBlackboard& blackboard) const {
+    const BehaviourNode& node = nodes[index];
+    blackboard.decision = node.value;
+    blackboard.runningNode = static_cast<int16_t>(index);
+    blackboard.ticksLeft = static_cast<uint16_t>(node.ticks - 1);
+    blackboard.startFacts = blackboard.facts;
+}
+
+BehaviourTree BehaviourTree::makeRulesTree() {
+    BehaviourTree tree;
+    tree.beginSelector();
+    {
+        tree.beginSequence();
+        tree.condition(BehaviourFact::IsTagged);
+        tree.action(BrainDecision::ReturnToHomeZone);
+        tree.end();
+
+        tree.beginSequence();
+        tree.condition(BehaviourFact::HasFlag);
+        tree.beginSelector();
+        tree.beginSequence();
+        tree.condition(BehaviourFact::InHomeZone);
+        tree.action(BrainDecision::CaptureFlag);
+        tree.end();
+        tree.action(BrainDecision::ReturnToHomeZone);
+        tree.end();
+        tree.end();
+
+        tree.beginSequence();
+        tree.condition(BehaviourFact::OpponentHasFlag, false);
+        tree.action(BrainDecision::GrabFlag);
+        tree.end();
+
+        tree.beginSequence();
+        tree.condition(BehaviourFact::EnemyInReach);
+        tree.action(BrainDecision::TagEnemy);
+        tree.end();
+
+        tree.action(BrainDecision::RecoverFlag);
+    }
+    tree.end();
+
+    std::string error;
+    tree.finish(error);
+    return tree;
+}
+
+uint16_t BehaviourTree::getFacts(const DecisionInputs& inputs, float proximityThreshold) {
+    uint16_t facts = 0;
+    facts |= inputs.hasFlag ? 1 << static_cast<int>(BehaviourFact::HasFlag) : 0;
+    facts |= inputs.opponentHasFlag ? 1 << static_cast<int>(BehaviourFact::OpponentHasFlag) : 0;
+    facts |= inputs.isTagged ? 1 << static_cast<int>(BehaviourFact::IsTagged) : 0;
+    facts |= inputs.inHomeZone ? 1 << static_cast<int>(BehaviourFact::InHomeZone) : 0;
+    facts |= inputs.distanceToNearestEnemy <= proximityThreshold ? 1 << static_cast<int>(BehaviourFact::EnemyInReach) : 0;
+    facts |= inputs.distanceToFlag <= nearFlagDistance ? 1 << static_cast<int>(BehaviourFact::NearEnemyFlag) : 0;
+    return facts;
+}
+
+void BehaviourTree::tick(BehaviourBlackboard& blackboard) const {
+    if (!finished) {
+        blackboard.decision = static_cast<uint8_t>(BrainDecision::Explore);
+        return;
+    }
+
+    // Resume a running action while nothing it started under has changed
+    if (blackboard.runningNode >= 0) {
+        int running = blackboard.runningNode;
+        blackboard.runningNode = -1;
+        bool resumable = running < static_cast<int>(nodes.size()) && nodes[running].type == BehaviourNodeType::Action;
+        if (resumable && blackboard.facts == blackboard.startFacts) {
+            if (blackboard.ticksLeft > 0) {
+                blackboard.ticksLeft--;
+                blackboard.runningNode = static_cast<int16_t>(running);
+                blackboard.decision = nodes[running].value;
+                return;
+            }
+            if (!finishesTree[running] && resumeAfter(running, Status::Success, blackboard) == Status::Running) {
+                return;
+            }
+        }
+    }
+
+    int action = rootActions[blackboard.facts & ((1 << factCount) - 1)];
+    if (action >= 0) {
+        startAction(action, blackboard);
+    }
+    else {
+        blackboard.decision = static_cast<uint8_t>(BrainDecision::Explore);
+    }
+}
+
+void BehaviourTree::tick(BehaviourBlackboard* blackboards, size_t count) const {
+    for (size_t i = 0; i < count; ++i) {
+        if (blackboards[i].pending) {
+            tick(blackboards[i]);
+        }
+    }
+}
+
+BehaviourTree::Status BehaviourTree::evaluate(int index, BehaviourBlackboard& blackboard) const {
+    const BehaviourNode& node = nodes[index];
+    switch (node.type) {
+    case BehaviourNodeType::Selector:
+    case BehaviourNodeType::Sequence:
+        return evaluateChildren(index, index + 1, blackboard);
+    case BehaviourNodeType::Condition:
+        return (blackboard.facts >> node.value) & 1 ? Status::Success : Status::Failure;
+    case BehaviourNodeType::ConditionNot:
+        return (blackboard.facts >> node.value) & 1 ? Status::Failure : Status::Success;
+    case BehaviourNodeType::Action:
+        startAction(index, blackboard);
+        return Status::Running;
+    }
+    return Status::Failure;
+}
+
+BehaviourTree::Status BehaviourTree::evaluateChildren(int parent, int firstChild, BehaviourBlackboard& blackboard) const {
+    bool sequence = nodes[parent].type == BehaviourNodeType::Sequence;
+    for (int child = firstChild; child < nodes[parent].end; child = nodes[child].end) {
+        Status status = evaluate(child, blackboard);
+        if (status == Status::Running || status == (sequence ? Status::Failure : Status::Success)) {
+            return status;
+        }
+    }
+    return sequence ? Status::Success : Status::Failure;
+}
+
+BehaviourTree::Status BehaviourTree::resumeAfter(int index, Status status, BehaviourBlackboard& blackboard) const {
+    // Up through the ancestors until one decides or the root is done
+    while (nodes[index].parent >= 0) {
+        int parent = nodes[index].parent;
+        bool carryOn = nodes[parent].type == BehaviourNodeType::Sequence ? status == Status::Success : status == Status::Failure;
+        if (carryOn) {
+            status = evaluateChildren(parent, nodes[index].end, blackboard);
+            if (status == Status::Running) {
+                return status;
+            }
+        }
+        index = parent;
+    }
+    return status;
+}
+
+bool BehaviourTree::isWellFormed(const std::vector<BehaviourNode>& nodes) {
+    // Every subtree must sit inside its parent's, children tiling it exactly
+    std::vector<int> childrenEnd(nodes.size(), 0);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const BehaviourNode& node = nodes[i];
+        int parent = node.parent;
+        if (i == 0 ? parent != -1 : (parent < 0 || parent >= static_cast<int>(i))) {
+            return false;
+        }
+        bool composite = node.type == BehaviourNodeType::Selector || node.type == BehaviourNodeType::Sequence;
+        if (composite ? node.end <= i : node.end != i + 1) {
+            return false;
+        }
+        if ((node.type == BehaviourNodeType::Condition || node.type == BehaviourNodeType::ConditionNot) && node.value > static_cast<int>(BehaviourFact::NearEnemyFlag)) {
+            return false;
+        }
+        if (node.type == BehaviourNodeType::Action && (node.value > static_cast<int>(BrainDecision::Explore) || node.ticks == 0)) {
+            return false;
+        }
+        if (node.type > BehaviourNodeType::Action || node.end > nodes.size()) {
+            return false;
+        }
+        if (i > 0) {
+            // Each child starts where its previous sibling ended
+            int expectedStart = childrenEnd[parent] == 0 ? parent + 1 : childrenEnd[parent];
+            if (static_cast<int>(i) != expectedStart || node.end > nodes[parent].end) {
+                return false;
+            }
+            childrenEnd[parent] = node.end;
+        }
+    }
+    // Every composite is filled to its end, and the root spans the tree
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        bool composite = nodes[i].type == BehaviourNodeType::Selector || nodes[i].type == BehaviourNodeType::Sequence;
+        int filledTo = childrenEnd[i] == 0 ? static_cast<int>(i) + 1 : childrenEnd[i];
+        if (composite && filledTo != nodes[i].end) {
+            return false;
+        }
+    }
+    return nodes.empty() || nodes[0].end == nodes.size();
+}
+
+void BehaviourTree::saveState(BinaryWriter& writer) const {
+    writer.writeBool(finished);
+    writer.writeUInt32(static_cast<uint32_t>(nodes.size()));
+    for (const BehaviourNode& node : nodes) {
+        writer.writeUInt8(static_cast<uint8_t>(node.type));
+        writer.writeUInt8(node.value);
+        writer.writeVarUInt(node.ticks);
+        writer.writeVarUInt(node.end);
+        writer.writeVarInt(node.parent);
+    }
+}
+
+bool BehaviourTree::loadState(BinaryReader& reader) {
+    bool loadedFinished = reader.readBool();
+    uint32_t count = reader.readUInt32();
+    if (reader.hasFailed() || count > static_cast<uint32_t>(maxNodes)) {
+        return false;
+    }
+    std::vector<BehaviourNode> loaded(count);
+    for (BehaviourNode& node : loaded) {
+        node.type = static_cast<BehaviourNodeType>(reader.readUInt8());
+        node.value = reader.readUInt8();
+        node.ticks = static_cast<uint16_t>(reader.readVarUInt());
+        node.end = static_cast<uint16_t>(reader.readVarUInt());
+        node.parent = static_cast<int16_t>(reader.readVarInt());
+    }
+    if (reader.hasFailed() || !isWellFormed(loaded) || (loadedFinished && loaded.empty())) {
+        return false;
+    }
+
+    nodes = loaded;
+    openNodes.clear();
+    buildError.clear();
+    finished = loadedFinished;
+    if (finished) {
+        compile();
+    }
+    return true;
+}
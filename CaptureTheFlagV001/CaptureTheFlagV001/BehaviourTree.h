@@ -0,0 +1,133 @@
+#ifndef BEHAVIOURTREE_H
+#define BEHAVIOURTREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Brain.h"
+
+class BinaryWriter;
+class BinaryReader;
+
+// What a condition node can test, one bit each in a blackboard's facts
+enum class BehaviourFact {
+    HasFlag,
+    OpponentHasFlag,
+    IsTagged,
+    InHomeZone,
+    // Nearest enemy in view within the brain's proximity threshold
+    EnemyInReach,
+    // Within nearFlagDistance of the enemy flag
+    NearEnemyFlag
+};
+
+enum class BehaviourNodeType : uint8_t {
+    Selector,
+    Sequence,
+    Condition,
+    ConditionNot,
+    Action
+};
+
+// Nodes are stored depth first, so a composite's first child follows it and
+// end is the index just past its subtree, which is also its next sibling
+struct BehaviourNode {
+    BehaviourNodeType type;
+    // Fact for conditions, BrainDecision for actions
+    uint8_t value;
+    // Decisions an action keeps acting for
+    uint16_t ticks;
+    uint16_t end;
+    int16_t parent;
+};
+
+// Everything one agent carries between ticks of a tree
+struct BehaviourBlackboard {
+    uint16_t facts;
+    // Facts when the running action started; any change aborts it
+    uint16_t startFacts;
+    int16_t runningNode;
+    uint16_t ticksLeft;
+    uint8_t decision;
+    // Set by the caller for agents that decide this tick
+    uint8_t pending;
+
+    BehaviourBlackboard() : facts(0), startFacts(0), runningNode(-1), ticksLeft(0), decision(static_cast<uint8_t>(BrainDecision::Explore)), pending(0) {}
+};
+
+// A behaviour tree compiled into one flat node array. Selectors try their
+// children in order until one does not fail, sequences until one does not
+// succeed, and an action ends the tick with its decision. An action held
+// for several ticks is running: while the agent's facts stay as they were
+// the next ticks resume at it without walking the tree, and once it is done
+// its parent carries on with the next child. A tick that reaches no action
+// decides Explore.
+//
+// A walk from the root depends only on the facts, so finishing a tree also
+// records which action the root reaches for every combination of them, and
+// ticks only walk nodes to carry on after a held action.
+//
+// The same tree ticks any number of agents, each with its own blackboard;
+// the whole tree is a few cache lines, shared by all of them.
+class BehaviourTree {
+public:
+    BehaviourTree();
+
+    // Building, depth first. Every begin needs an end, and finish checks
+    // the tree is whole before it is ticked.
+    void beginSelector();
+    void beginSequence();
+    void condition(BehaviourFact fact, bool expected = true);
+    void action(BrainDecision decision, int ticks = 1);
+    void end();
+    bool finish(std::string& error);
+    bool isFinished() const { return finished; }
+
+    // The same choices as Brain::makeDecision
+    static BehaviourTree makeRulesTree();
+
+    static const int maxNodes = 32767;
+    static const int factCount = 6;
+    static constexpr float nearFlagDistance = 100.0f;
+    static uint16_t getFacts(const DecisionInputs& inputs, float proximityThreshold);
+
+    void tick(BehaviourBlackboard& blackboard) const;
+    // Ticks the pending blackboards among count in a row
+    void tick(BehaviourBlackboard* blackboards, size_t count) const;
+
+    const std::vector<BehaviourNode>& getNodes() const { return nodes; }
+
+    void saveState(BinaryWriter& writer) const;
+    // False, leaving the tree as it was, when the nodes do not form a tree
+    bool loadState(BinaryReader& reader);
+
+private:
+    // Status of a subtree; Running means an action decided this tick
+    enum class Status {
+        Success,
+        Failure,
+        Running
+    };
+
+    void add(BehaviourNodeType type, uint8_t value, uint16_t ticks);
+    void compile();
+    void startAction(int index, BehaviourBlackboard& blackboard) const;
+    Status evaluate(int index, BehaviourBlackboard& blackboard) const;
+    // Carries on in index's parent after index finished with status
+    Status resumeAfter(int index, Status status, BehaviourBlackboard& blackboard) const;
+    Status evaluateChildren(int parent, int firstChild, BehaviourBlackboard& blackboard) const;
+    static bool isWellFormed(const std::vector<BehaviourNode>& nodes);
+
+    std::vector<BehaviourNode> nodes;
+    // Action the root reaches for each set of facts, or -1
+    std::vector<int16_t> rootActions;
+    // Per node, 1 for actions after which the whole tree is done
+    std::vector<uint8_t> finishesTree;
+    // Composites begun and not yet ended, and the first building mistake
+    std::vector<int> openNodes;
+    std::string buildError;
+    bool finished;
+};
+
+#endif
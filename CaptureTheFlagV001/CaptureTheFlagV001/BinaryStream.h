@@ -0,0 +1,163 @@
+#ifndef BINARYSTREAM_H
+#define BINARYSTREAM_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Little-endian binary encoding for snapshots and replays. Values are
+// written byte by byte so files move between platforms unchanged. Var
+// values use 7 bits per byte (LEB128); signed ones are zig-zag mapped
+// first so small negative numbers stay small.
+class BinaryWriter {
+public:
+    explicit BinaryWriter(std::vector<uint8_t>& buffer) : buffer(buffer) {}
+
+    void writeUInt8(uint8_t value) { buffer.push_back(value); }
+    void writeBool(bool value) { buffer.push_back(value ? 1 : 0); }
+    void writeUInt32(uint32_t value) { writeLittleEndian(value, 4); }
+    void writeUInt64(uint64_t value) { writeLittleEndian(value, 8); }
+    void writeInt32(int32_t value) { writeLittleEndian(static_cast<uint32_t>(value), 4); }
+    void writeInt64(int64_t value) { writeLittleEndian(static_cast<uint64_t>(value), 8); }
+
+    void writeFloat(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        writeUInt32(bits);
+    }
+
+    void writeDouble(double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        writeUInt64(bits);
+    }
+
+    void writeVarUInt(uint64_t value) {
+        while (value >= 0x80) {
+            buffer.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        buffer.push_back(static_cast<uint8_t>(value));
+    }
+
+    void writeVarInt(int64_t value) {
+        writeVarUInt((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void writeString(const std::string& value) {
+        writeUInt32(static_cast<uint32_t>(value.size()));
+        buffer.insert(buffer.end(), value.begin(), value.end());
+    }
+
+    size_t getSize() const { return buffer.size(); }
+
+    // Overwrites four bytes already written, for lengths known only at the end
+    void patchUInt32(size_t offset, uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            buffer[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+private:
+    void writeLittleEndian(uint64_t value, int byteCount) {
+        for (int i = 0; i < byteCount; ++i) {
+            buffer.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    std::vector<uint8_t>& buffer;
+};
+
+// Reads what BinaryWriter wrote. Reading past the end returns zeros and
+// marks the reader failed, so callers check hasFailed() once at the end.
+class BinaryReader {
+public:
+    BinaryReader(const uint8_t* data, size_t size) : data(data), size(size), offset(0), failed(false) {}
+
+    uint8_t readUInt8() { return static_cast<uint8_t>(readLittleEndian(1)); }
+    bool readBool() { return readLittleEndian(1) != 0; }
+    uint32_t readUInt32() { return static_cast<uint32_t>(readLittleEndian(4)); }
+    uint64_t readUInt64() { return readLittleEndian(8); }
+    int32_t readInt32() { return static_cast<int32_t>(static_cast<uint32_t>(readLittleEndian(4))); }
+    int64_t readInt64() { return static_cast<int64_t>(readLittleEndian(8)); }
+
+    float readFloat() {
+        uint32_t bits = readUInt32();
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    double readDouble() {
+        uint64_t bits = readUInt64();
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    uint64_t readVarUInt() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (failed || offset >= size) {
+                failed = true;
+                return 0;
+            }
+            uint8_t byte = data[offset++];
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        failed = true;
+        return 0;
+    }
+
+    int64_t readVarInt() {
+        uint64_t value = readVarUInt();
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    std::string readString() {
+        uint32_t length = readUInt32();
+        if (failed || length > size - offset) {
+            failed = true;
+            return std::string();
+        }
+        std::string value(reinterpret_cast<const char*>(data + offset), length);
+        offset += length;
+        return value;
+    }
+
+    size_t getOffset() const { return offset; }
+    void setOffset(size_t newOffset) {
+        if (newOffset > size) {
+            failed = true;
+            return;
+        }
+        offset = newOffset;
+    }
+    size_t getRemaining() const { return size - offset; }
+    bool hasFailed() const { return failed; }
+
+private:
+    uint64_t readLittleEndian(int byteCount) {
+        if (failed || static_cast<size_t>(byteCount) > size - offset) {
+            failed = true;
+            return 0;
+        }
+        uint64_t value = 0;
+        for (int i = 0; i < byteCount; ++i) {
+            value |= static_cast<uint64_t>(data[offset + i]) << (8 * i);
+        }
+        offset += byteCount;
+        return value;
+    }
+
+    const uint8_t* data;
+    size_t size;
+    size_t offset;
+    bool failed;
+};
+
+#endif
@@ -1,6 +1,14 @@
 #include "Brain.h"
+#include "GameParams.h"
+#include "BinaryStream.h"
 
-Brain::Brain() : flagCaptured(false), score(0), proximityThreshold(10.0f) {}
+Brain::Brain() : flagCaptured(false), score(0), proximityThreshold(GameParams().proximityThreshold) {}
+
+void Brain::reset() {
+    flagCaptured = false;
+    score = 0;
+    proximityThreshold = GameParams().proximityThreshold;
+}
 
 BrainDecision Brain::makeDecision(bool hasFlag, bool opponentHasFlag, bool isTagged, bool inHomeZone, float distanceToFlag, float distanceToNearestEnemy) {
     if (isTagged) {
@@ -62,4 +70,16 @@ float Brain::evaluateExplore(bool hasFlag, bool opponentHasFlag, bool inHomeZone
     else {
         return 0.5f;
     }
-}
\ No newline at end of file
+}
+
+void Brain::saveState(BinaryWriter& writer) const {
+    writer.writeBool(flagCaptured);
+    writer.writeInt32(score);
+    writer.writeFloat(proximityThreshold);
+}
+
+void Brain::loadState(BinaryReader& reader) {
+    flagCaptured = reader.readBool();
+    score = reader.readInt32();
+    proximityThreshold = reader.readFloat();
+}
@@ -1,6 +1,9 @@
 #ifndef BRAIN_H
 #define BRAIN_H
 
+class BinaryWriter;
+class BinaryReader;
+
 enum class BrainDecision {
     CaptureFlag,
     TagEnemy,
@@ -10,19 +13,51 @@ enum class BrainDecision {
     Explore
 };
 
+// What the agent tells its brain each decision
+struct DecisionInputs {
+    bool hasFlag;
+    bool opponentHasFlag;
+    bool isTagged;
+    bool inHomeZone;
+    float distanceToFlag;
+    float distanceToNearestEnemy;
+};
+
+// How a team turns decision inputs into decisions. Rules is makeDecision's
+// fixed chain; Utility scores every action for a whole batch at once, see
+// UtilityBrain; BehaviourTree ticks the team's tree, see BehaviourTree;
+// Policy evaluates the team's network for a whole batch, see PolicyNetwork.
+enum class BrainBackend {
+    Rules,
+    Utility,
+    BehaviourTree,
+    Policy
+};
+
 class Brain {
 public:
     Brain();
     BrainDecision makeDecision(bool hasFlag, bool opponentHasFlag, bool isTagged, bool inHomeZone, float distanceToFlag, float distanceToNearestEnemy);
+    BrainDecision makeDecision(const DecisionInputs& inputs) {
+        return makeDecision(inputs.hasFlag, inputs.opponentHasFlag, inputs.isTagged, inputs.inHomeZone, inputs.distanceToFlag, inputs.distanceToNearestEnemy);
+    }
+    float getProximityThreshold() const { return proximityThreshold; }
+    void setProximityThreshold(float threshold) { proximityThreshold = threshold; }
+    // Back to a freshly constructed brain, for agents reused by the next match
+    void reset();
+
+    void saveState(BinaryWriter& writer) const;
+    void loadState(BinaryReader& reader);
+
+    // Utilities of at most 1, falling with distance; UtilityBrain scores them for every agent
+    static float evaluateFlagCapture(bool hasFlag, float distanceToFlag);
+    static float evaluateFlagRecovery(bool opponentHasFlag, float distanceToNearestEnemy);
+    static float evaluateExplore(bool hasFlag, bool opponentHasFlag, bool inHomeZone);
 
 private:
     bool flagCaptured;
     int score;
     float proximityThreshold;
-
-    float evaluateFlagCapture(bool hasFlag, float distanceToFlag);
-    float evaluateFlagRecovery(bool opponentHasFlag, float distanceToNearestEnemy);
-    float evaluateExplore(bool hasFlag, bool opponentHasFlag, bool inHomeZone);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,244 @@
+#include "BrainBenchmark.h"
+#include "BehaviourTree.h"
+#include "Brain.h"
+#include "GameManager.h"
+#include "RandomStream.h"
+#include "UtilityBrain.h"
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+namespace {
+    // Weights drawn uniformly, scaled down by each layer's fan in so the
+    // activations neither vanish nor blow up
+    bool makeRandomPolicy(const std::vector<int>& sizes, uint64_t seed, PolicyNetwork& network, std::string& error) {
+        RandomStream random(seed, 1);
+        std::vector<std::vector<float>> weights;
+        std::vector<std::vector<float>> biases;
+        for (size_t index = 0; index + 1 < sizes.size(); ++index) {
+            float range = 1.0f / std::sqrt(static_cast<float>(sizes[index]));
+            weights.emplace_back(static_cast<size_t>(sizes[index]) * sizes[index + 1]);
+            for (float& weight : weights.back()) {
+                weight = (random.nextFloat() * 2.0f - 1.0f) * range;
+            }
+            biases.emplace_back(sizes[index + 1], 0.0f);
+        }
+        return network.setLayers(sizes, weights, biases, error);
+    }
+}
+
+BrainBenchmark::BrainBenchmark(const BrainBenchmarkConfig& config)
+    : config(config) {}
+
+int BrainBenchmark::run() {
+    std::ofstream output(config.outputPath, std::ios::out | std::ios::trunc);
+    if (!output) {
+        std::cerr << "Could not open " << config.outputPath << " for writing" << std::endl;
+        return 1;
+    }
+    output << "agents,rounds,rules_decisions_per_s,utility_decisions_per_s,tree_decisions_per_s,policy_decisions_per_s,policy_int8_decisions_per_s,"
+        << "policy_tick_us,policy_int8_tick_us,utility_agreement,tree_agreement,policy_agreement,policy_int8_agreement\n";
+
+    std::cerr << std::setw(8) << "agents" << std::setw(16) << "rules/s" << std::setw(16) << "utility/s"
+        << std::setw(16) << "tree/s" << std::setw(16) << "policy/s" << std::setw(16) << "int8/s" << std::setw(14) << "policy us"
+        << std::setw(14) << "int8 us" << std::setw(12) << "agreement" << std::setw(16) << "tree agreement"
+        << std::setw(18) << "policy agreement" << std::setw(16) << "int8 agreement" << std::endl;
+
+    for (int agentCount : config.agentCounts) {
+        BrainResult result = measure(agentCount);
+
+        output << result.agentCount << ',' << result.rounds << ',' << result.rulesDecisionsPerSecond << ','
+            << result.utilityDecisionsPerSecond << ',' << result.treeDecisionsPerSecond << ','
+            << result.policyDecisionsPerSecond << ',' << result.quantizedDecisionsPerSecond << ','
+            << result.policyTickMicros << ',' << result.quantizedTickMicros << ','
+            << result.agreement << ',' << result.treeAgreement << ',' << result.policyAgreement << ',' << result.quantizedAgreement << '\n';
+        output.flush();
+
+        std::cerr << std::setw(8) << result.agentCount << std::setw(16) << result.rulesDecisionsPerSecond
+            << std::setw(16) << result.utilityDecisionsPerSecond << std::setw(16) << result.treeDecisionsPerSecond
+            << std::setw(16) << result.policyDecisionsPerSecond << std::setw(16) << result.quantizedDecisionsPerSecond
+            << std::setw(14) << result.policyTickMicros << std::setw(14) << result.quantizedTickMicros
+            << std::setw(12) << result.agreement << std::setw(16) << result.treeAgreement
+            << std::setw(18) << result.policyAgreement << std::setw(16) << result.quantizedAgreement << std::endl;
+    }
+    return 0;
+}
+
+BrainResult BrainBenchmark::measure(int agentCount) const {
+    // A quarter carry, a third see the other team carrying, and most have
+    // nobody in view, like the middle of a crowded match
+    RandomStream random(config.seed, 0);
+    std::vector<DecisionInputs> inputs(agentCount);
+    std::vector<int> teams(agentCount);
+    for (int i = 0; i < agentCount; ++i) {
+        DecisionInputs& agentInputs = inputs[i];
+        agentInputs.hasFlag = random.bounded(0, 4) == 0;
+        agentInputs.opponentHasFlag = random.bounded(0, 3) == 0;
+        agentInputs.isTagged = false;
+        agentInputs.inHomeZone = random.bounded(0, 3) == 0;
+        agentInputs.distanceToFlag = random.nextFloat() * 800.0f;
+        agentInputs.distanceToNearestEnemy = random.bounded(0, 4) == 0 ? random.nextFloat() * 64.0f : std::numeric_limits<float>::max();
+        teams[i] = i % 2;
+    }
+
+    // One brain per agent, as in a match
+    std::vector<Brain> brains(agentCount);
+    std::vector<BrainDecision> rulesDecisions(agentCount);
+    auto rulesStart = std::chrono::steady_clock::now();
+    for (int round = 0; round < config.rounds; ++round) {
+        for (int i = 0; i < agentCount; ++i) {
+            rulesDecisions[i] = brains[i].makeDecision(inputs[i]);
+        }
+    }
+    double rulesSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - rulesStart).count();
+
+    UtilityBrain utilityBrain;
+    utilityBrain.resize(agentCount);
+    float proximityThreshold = Brain().getProximityThreshold();
+    auto utilityStart = std::chrono::steady_clock::now();
+    for (int round = 0; round < config.rounds; ++round) {
+        for (int i = 0; i < agentCount; ++i) {
+            utilityBrain.setInputs(i, teams[i], inputs[i], proximityThreshold);
+        }
+        utilityBrain.score(0, agentCount);
+    }
+    double utilitySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - utilityStart).count();
+
+    BehaviourTree tree = BehaviourTree::makeRulesTree();
+    std::vector<BehaviourBlackboard> blackboards(agentCount);
+    auto treeStart = std::chrono::steady_clock::now();
+    for (int round = 0; round < config.rounds; ++round) {
+        for (int i = 0; i < agentCount; ++i) {
+            blackboards[i].facts = BehaviourTree::getFacts(inputs[i], proximityThreshold);
+            blackboards[i].pending = 1;
+        }
+        tree.tick(blackboards.data(), blackboards.size());
+    }
+    double treeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - treeStart).count();
+
+    // The feature matrix is filled in every round, as the decision phase does
+    PolicyNetwork policy = config.policy;
+    std::vector<float> features(static_cast<size_t>(agentCount) * PolicyNetwork::featureCount);
+    std::vector<uint8_t> masks(agentCount);
+    std::vector<uint8_t> policyDecisions[2] = { std::vector<uint8_t>(agentCount), std::vector<uint8_t>(agentCount) };
+    double policySeconds[2];
+    PolicyScratch scratch;
+    for (int quantized = 0; quantized < 2; ++quantized) {
+        policy.setQuantized(quantized != 0);
+        auto policyStart = std::chrono::steady_clock::now();
+        for (int round = 0; round < config.rounds; ++round) {
+            for (int i = 0; i < agentCount; ++i) {
+                PolicyNetwork::getFeatures(inputs[i], teams[i], proximityThreshold, &features[static_cast<size_t>(i) * PolicyNetwork::featureCount]);
+                masks[i] = PolicyNetwork::getActionMask(inputs[i], proximityThreshold);
+            }
+            policy.evaluate(features.data(), masks.data(), agentCount, scratch, policyDecisions[quantized].data());
+        }
+        policySeconds[quantized] = std::chrono::duration<double>(std::chrono::steady_clock::now() - policyStart).count();
+    }
+
+    int agreeing = 0;
+    int treeAgreeing = 0;
+    int policyAgreeing = 0;
+    int quantizedAgreeing = 0;
+    for (int i = 0; i < agentCount; ++i) {
+        agreeing += rulesDecisions[i] == utilityBrain.getDecision(i) ? 1 : 0;
+        treeAgreeing += rulesDecisions[i] == static_cast<BrainDecision>(blackboards[i].decision) ? 1 : 0;
+        policyAgreeing += rulesDecisions[i] == static_cast<BrainDecision>(policyDecisions[0][i]) ? 1 : 0;
+        quantizedAgreeing += rulesDecisions[i] == static_cast<BrainDecision>(policyDecisions[1][i]) ? 1 : 0;
+    }
+
+    double decisions = static_cast<double>(agentCount) * config.rounds;
+    BrainResult result;
+    result.agentCount = agentCount;
+    result.rounds = config.rounds;
+    result.rulesDecisionsPerSecond = decisions / std::max(rulesSeconds, 1e-9);
+    result.utilityDecisionsPerSecond = decisions / std::max(utilitySeconds, 1e-9);
+    result.treeDecisionsPerSecond = decisions / std::max(treeSeconds, 1e-9);
+    result.policyDecisionsPerSecond = decisions / std::max(policySeconds[0], 1e-9);
+    result.quantizedDecisionsPerSecond = decisions / std::max(policySeconds[1], 1e-9);
+    result.policyTickMicros = policySeconds[0] * 1e6 / config.rounds;
+    result.quantizedTickMicros = policySeconds[1] * 1e6 / config.rounds;
+    result.agreement = agentCount > 0 ? static_cast<double>(agreeing) / agentCount : 0.0;
+    result.treeAgreement = agentCount > 0 ? static_cast<double>(treeAgreeing) / agentCount : 0.0;
+    result.policyAgreement = agentCount > 0 ? static_cast<double>(policyAgreeing) / agentCount : 0.0;
+    result.quantizedAgreement = agentCount > 0 ? static_cast<double>(quantizedAgreeing) / agentCount : 0.0;
+    return result;
+}
+
+bool BrainBenchmark::parseArguments(const QStringList& arguments, BrainBenchmarkConfig& config, std::string& error) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures decisions per second of the rules, utility, behaviour tree and policy brains");
+    QCommandLineOption benchOption("brain-bench", "Run the brain benchmark and exit.");
+    QCommandLineOption agentsOption("agents", "Comma separated agent counts.", "counts", "8,1000,10000,100000");
+    QCommandLineOption roundsOption("rounds", "Decisions per agent per point.", "count", "100");
+    QCommandLineOption seedOption("seed", "Seed for the decision inputs.", "seed", QString::number(GameManager::defaultMatchSeed));
+    QCommandLineOption outputOption("output", "CSV result file.", "path", "brain_results.csv");
+    QCommandLineOption policyOption("policy", "Policy network weight file to time instead of the rules network.", "path");
+    QCommandLineOption hiddenOption("policy-hidden", "Comma separated hidden layer widths of a randomly weighted policy network to time instead.", "widths");
+    parser.addOptions({ benchOption, agentsOption, roundsOption, seedOption, outputOption, policyOption, hiddenOption });
+
+    if (!parser.parse(arguments)) {
+        error = parser.errorText().toStdString();
+        return false;
+    }
+
+    bool ok = true;
+    config.agentCounts.clear();
+    for (const QString& count : parser.value(agentsOption).split(',', Qt::SkipEmptyParts)) {
+        int agentCount = count.trimmed().toInt(&ok);
+        if (!ok || agentCount < 0) {
+            error = "Agent counts must be whole numbers, got " + count.toStdString();
+            return false;
+        }
+        config.agentCounts.push_back(agentCount);
+    }
+
+    bool allOk = true;
+    config.rounds = parser.value(roundsOption).toInt(&ok); allOk &= ok;
+    config.seed = parser.value(seedOption).toULongLong(&ok); allOk &= ok;
+    config.outputPath = parser.value(outputOption).toStdString();
+
+    if (!allOk || config.rounds < 1) {
+        error = "Rounds must be at least 1";
+        return false;
+    }
+
+    config.policy = PolicyNetwork::makeRulesNetwork();
+    if (parser.isSet(policyOption)) {
+        return PolicyNetwork::loadFile(parser.value(policyOption).toStdString(), config.policy, error);
+    }
+    if (parser.isSet(hiddenOption)) {
+        std::vector<int> sizes = { PolicyNetwork::featureCount };
+        for (const QString& width : parser.value(hiddenOption).split(',', Qt::SkipEmptyParts)) {
+            sizes.push_back(width.trimmed().toInt(&ok));
+            if (!ok || sizes.back() < 1 || sizes.back() > PolicyNetwork::maxWidth) {
+                error = "Hidden widths must be whole numbers between 1 and " + std::to_string(PolicyNetwork::maxWidth) + ", got " + width.toStdString();
+                return false;
+            }
+        }
+        sizes.push_back(PolicyNetwork::actionCount);
+        return makeRandomPolicy(sizes, config.seed, config.policy, error);
+    }
+    return true;
+}
+
+int BrainBenchmark::runFromArguments(const QStringList& arguments) {
+    BrainBenchmarkConfig config;
+    std::string error;
+    if (!parseArguments(arguments, config, error)) {
+        std::cerr << error << std::endl;
+        return 2;
+    }
+
+    // Only the results table should reach the terminal
+    QLoggingCategory::setFilterRules("*.debug=false");
+
+    BrainBenchmark benchmark(config);
+    return benchmark.run();
+}
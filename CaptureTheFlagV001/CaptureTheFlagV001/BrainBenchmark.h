@@ -0,0 +1,60 @@
+#ifndef BRAINBENCHMARK_H
+#define BRAINBENCHMARK_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <QStringList>
+#include "PolicyNetwork.h"
+
+struct BrainBenchmarkConfig {
+    std::vector<int> agentCounts;
+    int rounds;
+    uint64_t seed;
+    std::string outputPath;
+    // The rules network unless --policy or --policy-hidden asks for another
+    PolicyNetwork policy;
+};
+
+struct BrainResult {
+    int agentCount;
+    int rounds;
+    double rulesDecisionsPerSecond;
+    double utilityDecisionsPerSecond;
+    double treeDecisionsPerSecond;
+    double policyDecisionsPerSecond;
+    double quantizedDecisionsPerSecond;
+    // Microseconds to decide every agent once, as a tick where all of them decide
+    double policyTickMicros;
+    double quantizedTickMicros;
+    // Share of agents the utility brain, the rules tree and the policy send where the rules brain does
+    double agreement;
+    double treeAgreement;
+    double policyAgreement;
+    double quantizedAgreement;
+};
+
+// Measures decisions per second of each brain backend on its own, away from
+// the rest of the tick. Every round decides once for every agent from inputs
+// drawn like a busy match's: the rules brain agent by agent, the utility
+// brain loading its inputs and scoring the whole batch, the rules
+// behaviour tree filling in facts and ticking every blackboard, and the
+// policy network filling in its feature matrix and evaluating all of it,
+// in floats and quantized.
+class BrainBenchmark {
+public:
+    explicit BrainBenchmark(const BrainBenchmarkConfig& config);
+
+    // Returns a process exit code
+    int run();
+
+    static bool parseArguments(const QStringList& arguments, BrainBenchmarkConfig& config, std::string& error);
+    static int runFromArguments(const QStringList& arguments);
+
+private:
+    BrainResult measure(int agentCount) const;
+
+    BrainBenchmarkConfig config;
+};
+
+#endif
@@ -0,0 +1,200 @@
+#include "CollisionAvoidance.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COLLISIONAVOIDANCE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+    // Below this the direction out of an overlap is meaningless
+    const float minDistance = 1e-4f;
+    // Share of the correction turned sideways. Both agents of a pair turn the
+    // same way relative to each other, so head-on walkers pass instead of
+    // pushing each other back along their paths.
+    const float sidestep = 0.5f;
+}
+
+CollisionAvoidance::CollisionAvoidance(int gameFieldWidth, int gameFieldHeight)
+    : gameFieldWidth(gameFieldWidth), gameFieldHeight(gameFieldHeight), grid(gameFieldWidth, gameFieldHeight, gridCellSize), largestStep(0.0f) {
+}
+
+void CollisionAvoidance::resize(size_t agentCount) {
+    for (std::vector<float>* values : { &startX, &startY, &endX, &endY, &stepX, &stepY, &maxStep, &resultX, &resultY }) {
+        values->assign(agentCount, 0.0f);
+    }
+    active.assign(agentCount, 0);
+    startCells.assign(agentCount, std::make_pair(0, 0));
+
+    size_t laneCount = agentCount * maxNeighbors;
+    for (std::vector<float>* values : { &laneX, &laneY, &laneMask, &correctionX, &correctionY }) {
+        values->assign(laneCount, 0.0f);
+    }
+}
+
+void CollisionAvoidance::recordStep(size_t index, float fromX, float fromY, float toX, float toY, float stepLimit, bool isActive) {
+    startX[index] = fromX;
+    startY[index] = fromY;
+    endX[index] = toX;
+    endY[index] = toY;
+    stepX[index] = toX - fromX;
+    stepY[index] = toY - fromY;
+    maxStep[index] = stepLimit;
+    active[index] = isActive ? 1 : 0;
+}
+
+void CollisionAvoidance::buildGrid() {
+    largestStep = 0.0f;
+    for (size_t i = 0; i < startCells.size(); ++i) {
+        startCells[i] = std::make_pair(static_cast<int>(std::lround(startX[i])), static_cast<int>(std::lround(startY[i])));
+        largestStep = std::max(largestStep, maxStep[i]);
+    }
+    grid.build(startCells);
+}
+
+float CollisionAvoidance::getInteractionRadius(float cellsPerTick) {
+    // The pair closes in by at most both steps, and each start position is
+    // up to half a cell from its cell on either axis
+    return 2.0f * agentRadius + 2.0f * cellsPerTick + 1.5f;
+}
+
+void CollisionAvoidance::resolve(size_t begin, size_t end) {
+    if (begin >= end) {
+        return;
+    }
+
+    for (size_t i = begin; i < end; ++i) {
+        gatherNeighbors(i);
+    }
+    computeLanes(begin * maxNeighbors, (end - begin) * maxNeighbors);
+
+    for (size_t i = begin; i < end; ++i) {
+        resultX[i] = endX[i];
+        resultY[i] = endY[i];
+        if (!active[i]) {
+            continue;
+        }
+
+        // Lanes are summed in a fixed order, so the result never depends on batching
+        float sumX = 0.0f;
+        float sumY = 0.0f;
+        for (size_t lane = i * maxNeighbors; lane < (i + 1) * maxNeighbors; ++lane) {
+            sumX += correctionX[lane];
+            sumY += correctionY[lane];
+        }
+
+        // Untouched agents keep exactly the position their path gave them
+        if (sumX == 0.0f && sumY == 0.0f) {
+            continue;
+        }
+
+        float x = stepX[i] + sumX;
+        float y = stepY[i] + sumY;
+        float length = std::sqrt(x * x + y * y);
+        if (length > maxStep[i]) {
+            float scale = maxStep[i] / length;
+            x *= scale;
+            y *= scale;
+        }
+        resultX[i] = std::max(0.0f, std::min(static_cast<float>(gameFieldWidth - 1), startX[i] + x));
+        resultY[i] = std::max(0.0f, std::min(static_cast<float>(gameFieldHeight - 1), startY[i] + y));
+    }
+}
+
+void CollisionAvoidance::gatherNeighbors(size_t index) {
+    size_t base = index * maxNeighbors;
+    int count = 0;
+    float laneDistance[maxNeighbors];
+
+    if (active[index]) {
+        int radius = static_cast<int>(std::ceil(getInteractionRadius(largestStep)));
+        float x = startX[index];
+        float y = startY[index];
+
+        // Keeps the nearest maxNeighbors, earlier entries winning ties
+        grid.forEachInRadius(startCells[index].first, startCells[index].second, radius, [&](int other) {
+            size_t j = static_cast<size_t>(other);
+            if (j == index || !active[j]) {
+                return true;
+            }
+
+            float offsetX = startX[j] - x;
+            float offsetY = startY[j] - y;
+            float distance = offsetX * offsetX + offsetY * offsetY;
+            int lane = count;
+            if (count < maxNeighbors) {
+                count++;
+            }
+            else {
+                lane = static_cast<int>(std::max_element(laneDistance, laneDistance + maxNeighbors) - laneDistance);
+                if (distance >= laneDistance[lane]) {
+                    return true;
+                }
+            }
+            laneDistance[lane] = distance;
+
+            // Relative position once both agents took their planned steps
+            float relativeX = offsetX - (stepX[index] - stepX[j]);
+            float relativeY = offsetY - (stepY[index] - stepY[j]);
+            if (relativeX == 0.0f && relativeY == 0.0f) {
+                // Agents landing on the same spot part along x, in opposite directions
+                relativeX = j > index ? minDistance : -minDistance;
+            }
+            laneX[base + lane] = relativeX;
+            laneY[base + lane] = relativeY;
+            laneMask[base + lane] = 1.0f;
+            return true;
+        });
+    }
+
+    for (int lane = count; lane < maxNeighbors; ++lane) {
+        laneX[base + lane] = 0.0f;
+        laneY[base + lane] = 0.0f;
+        laneMask[base + lane] = 0.0f;
+    }
+}
+
+void CollisionAvoidance::computeLanes(size_t firstLane, size_t laneCount) {
+    // For each lane: how deep the neighbour ends up inside the combined
+    // radius, and half of the way back out along the line between the two,
+    // turned partly sideways. Empty lanes have a mask of zero and come out as
+    // zero. The SSE2 and scalar paths do the same operations lane by lane.
+    const float reach = 2.0f * agentRadius;
+    size_t lane = firstLane;
+    size_t lastLane = firstLane + laneCount;
+
+#ifdef COLLISIONAVOIDANCE_SSE2
+    const __m128 reachLanes = _mm_set1_ps(reach);
+    const __m128 halfLanes = _mm_set1_ps(0.5f);
+    const __m128 minDistanceLanes = _mm_set1_ps(minDistance);
+    const __m128 sidestepLanes = _mm_set1_ps(sidestep);
+    const __m128 zeroLanes = _mm_setzero_ps();
+    for (; lane + 4 <= lastLane; lane += 4) {
+        __m128 x = _mm_loadu_ps(&laneX[lane]);
+        __m128 y = _mm_loadu_ps(&laneY[lane]);
+        __m128 mask = _mm_loadu_ps(&laneMask[lane]);
+
+        __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)));
+        __m128 depth = _mm_mul_ps(_mm_max_ps(_mm_sub_ps(reachLanes, distance), zeroLanes), mask);
+        __m128 scale = _mm_div_ps(_mm_mul_ps(halfLanes, depth), _mm_max_ps(distance, minDistanceLanes));
+
+        __m128 awayX = _mm_sub_ps(_mm_sub_ps(zeroLanes, x), _mm_mul_ps(sidestepLanes, y));
+        __m128 awayY = _mm_add_ps(_mm_sub_ps(zeroLanes, y), _mm_mul_ps(sidestepLanes, x));
+        _mm_storeu_ps(&correctionX[lane], _mm_mul_ps(scale, awayX));
+        _mm_storeu_ps(&correctionY[lane], _mm_mul_ps(scale, awayY));
+    }
+#endif
+
+    for (; lane < lastLane; ++lane) {
+        float x = laneX[lane];
+        float y = laneY[lane];
+
+        float distance = std::sqrt(x * x + y * y);
+        float depth = std::max(reach - distance, 0.0f) * laneMask[lane];
+        float scale = (0.5f * depth) / std::max(distance, minDistance);
+
+        correctionX[lane] = scale * ((0.0f - x) - sidestep * y);
+        correctionY[lane] = scale * ((0.0f - y) + sidestep * x);
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef COLLISIONAVOIDANCE_H
+#define COLLISIONAVOIDANCE_H
+
+#include <cstddef>
+#include <vector>
+#include "SpatialGrid.h"
+
+// Reciprocal collision avoidance, run after path following. The movement
+// phase records where each agent started the tick and where its path took
+// it; resolve() then bends those steps so no two agents end the tick closer
+// than twice agentRadius.
+//
+// This is ORCA with a one-tick horizon: the velocity obstacle of a neighbour
+// shrinks to a disc around its relative position, and each agent of a pair
+// takes half of the shortest way out of it. Instead of solving ORCA's linear
+// program per agent, the half-plane corrections of the nearest neighbours are
+// summed and the step is clamped to the agent's speed. That keeps the inner
+// kernel free of branches over flat arrays with a fixed number of neighbour
+// lanes per agent, four lanes at a time with SSE2.
+//
+// Every array is indexed like the agents passed to resize(). Batches of
+// agents may resolve in parallel: they read the recorded steps of everyone
+// and only write their own lanes and results.
+class CollisionAvoidance {
+public:
+    CollisionAvoidance(int gameFieldWidth, int gameFieldHeight);
+
+    void resize(size_t agentCount);
+
+    // Movement phase, once per agent. Inactive agents neither move aside nor
+    // get in anyone's way.
+    void recordStep(size_t index, float fromX, float fromY, float toX, float toY, float stepLimit, bool isActive);
+
+    // Indexes every recorded start position, once per tick before resolve
+    void buildGrid();
+
+    // Corrects the steps of agents begin to end-1
+    void resolve(size_t begin, size_t end);
+
+    bool isActive(size_t index) const { return active[index] != 0; }
+    float getStartX(size_t index) const { return startX[index]; }
+    float getStartY(size_t index) const { return startY[index]; }
+    float getResultX(size_t index) const { return resultX[index]; }
+    float getResultY(size_t index) const { return resultY[index]; }
+
+    // Cell distance beyond which two agents cannot affect each other this
+    // tick, with margin for rounding positions to cells
+    static float getInteractionRadius(float cellsPerTick);
+
+    static constexpr float agentRadius = 2.5f;
+    static const int maxNeighbors = 8;
+
+private:
+    void gatherNeighbors(size_t index);
+    void computeLanes(size_t firstLane, size_t laneCount);
+
+    int gameFieldWidth;
+    int gameFieldHeight;
+    SpatialGrid grid;
+    std::vector<std::pair<int, int>> startCells;
+    float largestStep;
+
+    // One entry per agent
+    std::vector<float> startX;
+    std::vector<float> startY;
+    std::vector<float> endX;
+    std::vector<float> endY;
+    std::vector<float> stepX;
+    std::vector<float> stepY;
+    std::vector<float> maxStep;
+    std::vector<char> active;
+    std::vector<float> resultX;
+    std::vector<float> resultY;
+
+    // maxNeighbors lanes per agent: where the neighbour ends up relative to
+    // the agent if both take their planned steps, whether the lane is used,
+    // and the correction the kernel computed for it
+    std::vector<float> laneX;
+    std::vector<float> laneY;
+    std::vector<float> laneMask;
+    std::vector<float> correctionX;
+    std::vector<float> correctionY;
+
+    static const int gridCellSize = 32;
+};
+
+#endif
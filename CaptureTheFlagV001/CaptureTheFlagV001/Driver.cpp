@@ -3,13 +3,27 @@
 
 #include <QMenuBar>
 #include <QAction>
+#include <QActionGroup>
 #include <QInputDialog>
+#include <QCoreApplication>
+#include <QStringList>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QSignalBlocker>
 
 Driver::Driver(QWidget* parent) : QMainWindow(parent), gameField(nullptr) {
     int gameFieldWidth = 800;
     int gameFieldHeight = 600;
 
-    gameField = new GameField(this, gameFieldWidth, gameFieldHeight);
+    // "--seed N" replays a match exactly
+    uint64_t matchSeed = GameManager::defaultMatchSeed;
+    const QStringList arguments = QCoreApplication::arguments();
+    int seedIndex = arguments.indexOf("--seed");
+    if (seedIndex >= 0 && seedIndex + 1 < arguments.size()) {
+        matchSeed = arguments.at(seedIndex + 1).toULongLong();
+    }
+
+    gameField = new GameField(this, gameFieldWidth, gameFieldHeight, matchSeed);
     gameManager = gameField->getGameManager();
 
     setCentralWidget(gameField);
@@ -33,6 +47,97 @@ Driver::Driver(QWidget* parent) : QMainWindow(parent), gameField(nullptr) {
     QAction* testCase3Action = new QAction("Test Case 3: Change Team Zone Positions", this);
     connect(testCase3Action, &QAction::triggered, this, &Driver::runTestCase3);
     testCaseMenu->addAction(testCase3Action);
+
+    QAction* largeScaleAction = new QAction("Test Case 4: Large Scale", this);
+    connect(largeScaleAction, &QAction::triggered, this, &Driver::runLargeScale);
+    testCaseMenu->addAction(largeScaleAction);
+
+    // Create the "Speed" menu, rendering stays at display rate whatever the speed
+    speedMenu = menuBar->addMenu("Speed");
+    QActionGroup* speedGroup = new QActionGroup(this);
+    const int speeds[] = { 1, 10, 100, 1000, GameField::maxSpeed };
+    for (int speed : speeds) {
+        QAction* speedAction = new QAction(speed == GameField::maxSpeed ? QString("As Fast As Possible") : QString::number(speed) + "x", speedGroup);
+        speedAction->setCheckable(true);
+        speedAction->setChecked(speed == 1);
+        connect(speedAction, &QAction::triggered, this, [this, speed]() {
+            gameField->setSpeedMultiplier(speed);
+        });
+        speedMenu->addAction(speedAction);
+    }
+
+    // Create the "Replay" menu and the playback toolbar it shows
+    replayMenu = menuBar->addMenu("Replay");
+    QAction* openReplayAction = new QAction("Open Replay...", this);
+    connect(openReplayAction, &QAction::triggered, this, &Driver::openReplay);
+    replayMenu->addAction(openReplayAction);
+    setupReplayControls();
+
+    // "--params FILE" plays with the parameters in FILE, reloaded as it is edited
+    int paramsIndex = arguments.indexOf("--params");
+    if (paramsIndex >= 0 && paramsIndex + 1 < arguments.size()) {
+        QString error;
+        if (!gameField->watchParamsFile(arguments.at(paramsIndex + 1), error)) {
+            QMessageBox::warning(this, "Parameters", error);
+        }
+    }
+
+    // "--replay FILE" opens a recorded match straight away
+    int replayIndex = arguments.indexOf("--replay");
+    if (replayIndex >= 0 && replayIndex + 1 < arguments.size()) {
+        startReplay(arguments.at(replayIndex + 1));
+    }
+}
+
+void Driver::setupReplayControls() {
+    replayToolBar = addToolBar("Replay");
+    replayToolBar->setMovable(false);
+
+    playPauseAction = replayToolBar->addAction("Pause");
+    connect(playPauseAction, &QAction::triggered, this, [this]() {
+        gameField->setReplayPaused(!gameField->isReplayPaused());
+        playPauseAction->setText(gameField->isReplayPaused() ? "Play" : "Pause");
+    });
+
+    // Scrubbing seeks on every move; the field decodes in the background and shows the newest
+    replaySlider = new QSlider(Qt::Horizontal, replayToolBar);
+    replayToolBar->addWidget(replaySlider);
+    connect(replaySlider, &QSlider::valueChanged, this, [this](int tick) {
+        gameField->seekReplay(tick);
+    });
+    connect(gameField, &GameField::replayPositionChanged, this, [this](long long tick) {
+        if (!replaySlider->isSliderDown()) {
+            QSignalBlocker blocker(replaySlider);
+            replaySlider->setValue(static_cast<int>(tick));
+        }
+        playPauseAction->setText(gameField->isReplayPaused() ? "Play" : "Pause");
+    });
+
+    replayToolBar->hide();
+}
+
+void Driver::openReplay() {
+    QString path = QFileDialog::getOpenFileName(this, "Open Replay", QString(), "Replays (*.ctfr)");
+    if (!path.isEmpty()) {
+        startReplay(path);
+    }
+}
+
+void Driver::startReplay(const QString& path) {
+    QString error;
+    if (!gameField->playReplay(path, error)) {
+        QMessageBox::warning(this, "Replay", error);
+        return;
+    }
+
+    QSignalBlocker blocker(replaySlider);
+    replaySlider->setRange(static_cast<int>(gameField->getReplayFirstTick()), static_cast<int>(gameField->getReplayLastTick()));
+    replaySlider->setValue(static_cast<int>(gameField->getReplayFirstTick()));
+    playPauseAction->setText("Pause");
+    replayToolBar->show();
+
+    // Test cases act on the live match, which a replay replaced
+    gameManager = gameField->getGameManager();
 }
 
 void Driver::runTestCase1() {
@@ -43,8 +148,9 @@ void Driver::runTestCase1() {
 void Driver::runTestCase2() {
     gameManager->resetGame();
     bool ok;
-    int agentCount = QInputDialog::getInt(this, "Test Case 2", "Enter the number of agents:", 8, 1, 100, 1, &ok);
+    int agentCount = QInputDialog::getInt(this, "Test Case 2", "Enter the number of agents:", 8, 1, 100000, 1, &ok);
     if (ok) {
+        replayToolBar->hide();
         gameField->runTestCase2(agentCount, gameField->getGameManager());
     }
 }
@@ -52,4 +158,22 @@ void Driver::runTestCase2() {
 void Driver::runTestCase3() {
     gameManager->resetGame();
     gameField->runTestCase3();
+}
+
+void Driver::runLargeScale() {
+    bool ok;
+    int agentCount = QInputDialog::getInt(this, "Large Scale", "Enter the number of agents:", 10000, 2, 200000, 1000, &ok);
+    if (!ok) {
+        return;
+    }
+
+    // The field stays 4:3 so the default layout scales with it
+    int fieldWidth = QInputDialog::getInt(this, "Large Scale", "Enter the field width:", 2000, 800, 16000, 200, &ok);
+    if (ok) {
+        replayToolBar->hide();
+        gameField->runLargeScale(agentCount, fieldWidth, fieldWidth * 3 / 4);
+
+        // The old match and its game manager are gone
+        gameManager = gameField->getGameManager();
+    }
 }
\ No newline at end of file
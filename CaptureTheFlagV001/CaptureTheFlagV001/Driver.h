@@ -3,6 +3,8 @@
 
 #include <QMainWindow>
 #include <QMenu>
+#include <QSlider>
+#include <QToolBar>
 
 class GameField;
 class GameManager; 
@@ -17,9 +19,19 @@ private slots:
     void runTestCase1();
     void runTestCase2();
     void runTestCase3();
+    void runLargeScale();
+    void openReplay();
 
 private:
+    void setupReplayControls();
+    void startReplay(const QString& path);
+
     QMenu* testCaseMenu;
+    QMenu* speedMenu;
+    QMenu* replayMenu;
+    QToolBar* replayToolBar;
+    QAction* playPauseAction;
+    QSlider* replaySlider;
     GameField* gameField;
     std::shared_ptr<GameManager> gameManager;
 };
@@ -1,38 +1,56 @@
 #include "FlagManager.h"
-#include "Agent.h"
-#include <iostream>
+#include "GameManager.h"
+#include "SpatialGrid.h"
+#include <cmath>
 
-bool FlagManager::grabFlag(Agent* agent) {
-    if (!agent->isCarryingFlag() && !agent->isTagged() && agent->distanceToEnemyFlag() <= 10) {
-            agent->setCarryingFlag(true);
-            return true;
-    }
-
-    return false;
-}
+void FlagManager::resolve(const std::vector<RuleIntent>& intents, const SpatialGrid& blueGrid, const SpatialGrid& redGrid, size_t blueCount, const GameManager& gameManager) {
+    drops.clear();
+    captures.clear();
+    grabs.clear();
 
-bool FlagManager::captureFlag(Agent* agent) {
-    if (agent->isCarryingFlag() && agent->checkInTeamZone() && !agent->isTagged()) {
-        agent->setCarryingFlag(false);
-        if (agent->getSide() == "blue") {
-            std::cout << "Blue flag captured!" << std::endl;
+    // Carriers left holding the flag after drops and captures, per team
+    bool blueCarrying = false;
+    bool redCarrying = false;
+    for (size_t i = 0; i < intents.size(); ++i) {
+        const RuleIntent& intent = intents[i];
+        if (!intent.carrying) {
+            continue;
+        }
+        if (intent.tagged) {
+            drops.push_back(static_cast<int>(i));
+        }
+        else if (intent.appliesRules && intent.inTeamZone) {
+            captures.push_back(static_cast<int>(i));
         }
         else {
-            std::cout << "Red flag captured!" << std::endl;
+            (intent.blueTeam ? blueCarrying : redCarrying) = true;
         }
-        resetFlag(agent);
-        return true;
     }
 
-    return false;
-}
-
-void FlagManager::resetFlag(Agent* agent) {
-    agent->setCarryingFlag(false);
-    if (agent->getSide() == "blue") {
-        std::cout << "Red flag reset!" << std::endl;
+    // Only agents near the enemy flag can grab it, so each team looks there alone
+    const float grabDistance = gameManager.getParams().flagReachDistance;
+    auto findGrab = [&](const SpatialGrid& grid, size_t offset, const std::pair<int, int>& enemyFlag) {
+        int grabber = -1;
+        grid.forEachInRadius(enemyFlag.first, enemyFlag.second, static_cast<int>(std::ceil(grabDistance)), [&](int index) {
+            size_t i = offset + static_cast<size_t>(index);
+            const RuleIntent& intent = intents[i];
+            if (!intent.appliesRules || !intent.enabled || intent.carrying || intent.tagged || intent.enemyFlagDistance > grabDistance) {
+                return true;
+            }
+            if (grabber < 0 || intent.enemyFlagDistance < intents[grabber].enemyFlagDistance ||
+                (intent.enemyFlagDistance == intents[grabber].enemyFlagDistance && static_cast<int>(i) < grabber)) {
+                grabber = static_cast<int>(i);
+            }
+            return true;
+        });
+        if (grabber >= 0) {
+            grabs.push_back(grabber);
+        }
+    };
+    if (!blueCarrying) {
+        findGrab(blueGrid, 0, gameManager.getEnemyFlagPosition("blue"));
     }
-    else {
-        std::cout << "Blue flag reset!" << std::endl;
+    if (!redCarrying) {
+        findGrab(redGrid, blueCount, gameManager.getEnemyFlagPosition("red"));
     }
-}
\ No newline at end of file
+}
@@ -1,15 +1,31 @@
 #ifndef FLAGMANAGER_H
 #define FLAGMANAGER_H
 
+#include <cstddef>
 #include <vector>
+#include "RuleIntent.h"
 
-class Agent;
+class GameManager;
+class SpatialGrid;
 
+// Flag resolution for the rules phase, run once the tick's tags are in the
+// intents. A tagged carrier drops the flag and a carrier in its own team
+// zone captures it. A team left without a carrier has the agent nearest the
+// enemy flag grab it, within the game's flag reach distance, lower index on
+// ties. Outcomes are listed in agent
+// order and the agents are left untouched for the caller to update.
 class FlagManager {
 public:
-    static bool grabFlag(Agent* agent);
-    static bool captureFlag(Agent* agent);
-    static void resetFlag(Agent* agent);
+    void resolve(const std::vector<RuleIntent>& intents, const SpatialGrid& blueGrid, const SpatialGrid& redGrid, size_t blueCount, const GameManager& gameManager);
+
+    const std::vector<int>& getDrops() const { return drops; }
+    const std::vector<int>& getCaptures() const { return captures; }
+    const std::vector<int>& getGrabs() const { return grabs; }
+
+private:
+    std::vector<int> drops;
+    std::vector<int> captures;
+    std::vector<int> grabs;
 };
 
-#endif
\ No newline at end of file
+#endif
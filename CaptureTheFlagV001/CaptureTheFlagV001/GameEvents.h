@@ -0,0 +1,75 @@
+#ifndef GAMEEVENTS_H
+#define GAMEEVENTS_H
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+enum class GameEventType : uint8_t {
+    FlagCaptured,
+    FlagReset,
+    FlagGrabbed,
+    AgentTagged
+};
+
+// One rule firing. agentId caused it and blueTeam is that agent's team;
+// targetId is the agent that got tagged, -1 for flag events.
+struct GameEvent {
+    long long tick;
+    int agentId;
+    int targetId;
+    GameEventType type;
+    bool blueTeam;
+};
+
+static_assert(std::is_trivially_copyable<GameEvent>::value, "Game events are copied around as plain bytes");
+
+// Fixed-size ring of game events shared by everything in one match. Rules
+// append as they fire; each consumer keeps its own cursor and drains what
+// is new whenever it likes, the score display once a frame, logging and
+// replays once a tick. A consumer that falls more than the capacity behind
+// loses the oldest events and is told how many. Only the thread stepping
+// the match may push or drain.
+class GameEventBuffer {
+public:
+    static const size_t defaultCapacity = 4096;
+
+    explicit GameEventBuffer(size_t capacity = defaultCapacity) : written(0) {
+        size_t size = 1;
+        while (size < capacity) {
+            size *= 2;
+        }
+        events.resize(size);
+        mask = size - 1;
+    }
+
+    void push(const GameEvent& event) {
+        events[written & mask] = event;
+        ++written;
+    }
+
+    // Total events ever pushed; a new consumer starts its cursor here
+    uint64_t getWritten() const { return written; }
+
+    // Calls visit(event) for every event after cursor, oldest first, and
+    // moves the cursor past them. Returns how many were overwritten unread.
+    template <typename Visitor>
+    uint64_t drain(uint64_t& cursor, Visitor visit) const {
+        uint64_t dropped = 0;
+        if (written - cursor > events.size()) {
+            dropped = written - events.size() - cursor;
+            cursor = written - events.size();
+        }
+        for (; cursor < written; ++cursor) {
+            visit(events[cursor & mask]);
+        }
+        return dropped;
+    }
+
+private:
+    std::vector<GameEvent> events;
+    size_t mask;
+    uint64_t written;
+};
+
+#endif
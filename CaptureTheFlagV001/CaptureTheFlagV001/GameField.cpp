@@ -1,17 +1,21 @@
 #include "GameField.h"
 #include <QPainter>
 #include <QPolygon>
-#include <QRandomGenerator>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QGraphicsItem>
 #include <QGraphicsTextItem>
 #include <QFont>
+#include <algorithm>
+#include <limits>
 #include <memory>
 #include "GameManager.h"
+#include "Logging.h"
 
 
-GameField::GameField(QWidget* parent, int width, int height)
-    : QGraphicsView(parent), gameFieldWidth(0), gameFieldHeight(0) {
+GameField::GameField(QWidget* parent, int width, int height, uint64_t matchSeed)
+    : QGraphicsView(parent), scene(nullptr), gameFieldWidth(0), gameFieldHeight(0), agentLayer(nullptr), lastFrameMillis(0), tickAccumulatorMillis(0.0),
+    speedMultiplier(1), lastRenderedTick(-1), scoreEventCursor(0), replayPaused(false), replayTickPosition(0.0) {
     setRenderHint(QPainter::Antialiasing);
     setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
@@ -20,17 +24,32 @@ GameField::GameField(QWidget* parent, int width, int height)
     gameFieldWidth = 800;
     gameFieldHeight = 600;
 
-    gameManager = std::make_shared<GameManager>(gameFieldWidth, gameFieldHeight);
-
-    // Set up the pathfinder
-    pathfinder = std::make_shared<Pathfinder>(gameFieldWidth, gameFieldHeight);
+    simulation = std::make_unique<Simulation>(gameFieldWidth, gameFieldHeight, matchSeed);
+    qDebug() << "Match seed:" << matchSeed;
 
     // Set up the agents before setting up the scene
-    setupAgents(4, 4, gameFieldWidth, gameFieldHeight, gameManager);
+    setupAgents(4, 4);
 
     // Set up the scene after setting up the agents
     setupScene();
+    setupHud();
+
+    // Rendering runs at display rate; the simulation steps from an accumulator inside each frame
+    frameTimer = new QTimer(this);
+    frameTimer->setTimerType(Qt::PreciseTimer);
+    connect(frameTimer, &QTimer::timeout, this, &GameField::handleFrameTimerTimeout);
+    startGame();
+}
+
+void GameField::clearAgents() {
+    simulation->clearAgents();
+}
 
+void GameField::setupAgents(int blueCount, int redCount) {
+    simulation->setupAgents(blueCount, redCount);
+}
+
+void GameField::setupHud() {
     // Set up the score displays
     QGraphicsTextItem* blueScoreText = new QGraphicsTextItem();
     blueScoreTextItem = blueScoreText;
@@ -38,6 +57,7 @@ GameField::GameField(QWidget* parent, int width, int height)
     blueScoreTextItem->setDefaultTextColor(Qt::blue);
     blueScoreTextItem->setFont(QFont("Arial", 16));
     blueScoreTextItem->setPos(10, 10);
+    blueScoreTextItem->setFlag(QGraphicsItem::ItemIgnoresTransformations);
     scene->addItem(blueScoreTextItem);
 
     QGraphicsTextItem* redScoreText = new QGraphicsTextItem();
@@ -45,142 +65,231 @@ GameField::GameField(QWidget* parent, int width, int height)
     redScoreTextItem->setPlainText("Red Score: 0");
     redScoreTextItem->setDefaultTextColor(Qt::red);
     redScoreTextItem->setFont(QFont("Arial", 16));
-    redScoreTextItem->setPos(600, 10);
+    redScoreTextItem->setPos(gameFieldWidth - 200, 10);
+    redScoreTextItem->setFlag(QGraphicsItem::ItemIgnoresTransformations);
     scene->addItem(redScoreTextItem);
 
     // Add time remaining display
     QGraphicsTextItem* timeRemainingText = new QGraphicsTextItem();
     timeRemainingTextItem = timeRemainingText;
-    timeRemainingTextItem->setPlainText("Time Remaining: 600");
+    timeRemainingTextItem->setPlainText("Time Remaining: " + QString::number(simulation->getTimeRemaining()));
     timeRemainingTextItem->setDefaultTextColor(Qt::black);
     timeRemainingTextItem->setFont(QFont("Arial", 16));
-    timeRemainingTextItem->setPos(300, 10);
+    timeRemainingTextItem->setPos(gameFieldWidth / 2 - 100, 10);
+    timeRemainingTextItem->setFlag(QGraphicsItem::ItemIgnoresTransformations);
     scene->addItem(timeRemainingTextItem);
 
-    // Start a timer to update agents
-    int gameDuration = 600; // 10 minutes in seconds
-    timeRemaining = gameDuration;
-    blueScore = 0;
-    redScore = 0;
+    // Scores are read once here and then redrawn only on captures
+    scoreEventCursor = simulation->getGameManager()->getEvents().getWritten();
+    updateScoreDisplay();
+}
+
+void GameField::startGame() {
+    tickAccumulatorMillis = 0.0;
+    lastRenderedTick = -1;
 
-    gameTimer = new QTimer(this);
-    connect(gameTimer, &QTimer::timeout, this, &GameField::handleGameTimerTimeout);
-    gameTimer->start(1000);
+    frameClock.start();
+    lastFrameMillis = 0;
+    frameTimer->start(frameIntervalMillis);
 }
 
-void GameField::clearAgents() {
-    // Delete all existing agents
-    blueAgents.clear();
-    redAgents.clear();
+void GameField::setSpeedMultiplier(int multiplier) {
+    speedMultiplier = multiplier;
+
+    // A smaller multiplier should not inherit a backlog built up at the old speed
+    tickAccumulatorMillis = 0.0;
 }
 
-void GameField::setupAgents(int blueCount, int redCount, int gameFieldWidth, int gameFieldHeight, const std::shared_ptr<GameManager>& gameManager) {
-    // Initialize blue agents
-    for (int i = 0; i < blueCount; i++) {
-        int x, y;
-        bool validPosition = false;
+void GameField::runTestCase1() {
+    // Test case 1: Default game setup (4 blue agents, 4 red agents)
+}
 
-        while (!validPosition) {
-            x = QRandomGenerator::global()->bounded(0, gameFieldWidth / 2);
-            y = QRandomGenerator::global()->bounded(0, gameFieldHeight);
+void GameField::runTestCase2(int agentCount, const std::shared_ptr<GameManager>& gameManager) {
+    stopReplay();
 
-            // Check if the position is within the game field boundaries
-            if (x >= 0 && x < gameFieldWidth / 2 && y >= 0 && y < gameFieldHeight) {
-                validPosition = true;
-            }
+    // The simulation and its agent pool are reused; setupAgents replaces the teams in place
+    simulation->resetMatch(simulation->getGameManager()->getMatchSeed());
+    int blueCount = agentCount / 2;
+    int redCount = agentCount - blueCount;
+    setupAgents(blueCount, redCount);
+    setupScene();
+    updateSceneItems();
+    setupHud();
+
+    // Keeps the speed picked in the Speed menu
+    startGame();
+}
+
+void GameField::runLargeScale(int agentCount, int fieldWidth, int fieldHeight) {
+    frameTimer->stop();
+    stopReplay();
+    uint64_t matchSeed = simulation->getGameManager()->getMatchSeed();
+
+    // The scene points into the old simulation's agents, so empty it first
+    scene->clear();
+    agentItems.clear();
+    agentLayer = nullptr;
+
+    gameFieldWidth = fieldWidth;
+    gameFieldHeight = fieldHeight;
+    simulation = std::make_unique<Simulation>(gameFieldWidth, gameFieldHeight, matchSeed);
+    if (!paramsPath.isEmpty()) {
+        QString error;
+        if (!watchParamsFile(paramsPath, error)) {
+            qWarning() << error;
         }
+    }
 
-        // Construct the blue agent and add to the list
-        auto blueBrain = std::make_shared<Brain>();
-        auto blueMemory = std::make_shared<Memory>();
-        auto agent = std::make_shared<Agent>(x, y, "blue", gameFieldWidth, gameFieldHeight, pathfinder, taggingDistance, blueBrain, blueMemory, gameManager, blueAgents, redAgents);
-        agent->setCarryingFlag(false);
-        agent->setIsTagged(false);
-        blueAgents.push_back(agent);
+    int blueCount = agentCount / 2;
+    setupAgents(blueCount, agentCount - blueCount);
+    setupScene();
+    setupHud();
+    fitFieldInView();
+    startGame();
+}
 
-        // Connect signals
-        connect(agent.get(), &Agent::redFlagCaptured, this, [this, gameManager]() {
-            handleFlagCapture("red", gameManager);
-            });
+bool GameField::watchParamsFile(const QString& path, QString& error) {
+    std::string watchError;
+    if (!simulation->watchParamsFile(path.toStdString(), watchError)) {
+        error = QString::fromStdString(watchError);
+        return false;
+    }
+    paramsPath = path;
+    return true;
+}
 
+bool GameField::playReplay(const QString& path, QString& error) {
+    auto player = std::make_unique<ReplayPlayer>();
+    std::string openError;
+    if (!player->open(path, openError)) {
+        error = QString::fromStdString(openError);
+        return false;
     }
 
-    // Initialize red agents
-    for (int i = 0; i < redCount; i++) {
-        int x, y;
-        bool validPosition = false;
+    frameTimer->stop();
+    stopReplay();
+    scene->clear();
+    agentItems.clear();
+    agentLayer = nullptr;
 
-        while (!validPosition) {
-            x = QRandomGenerator::global()->bounded(gameFieldWidth / 2, gameFieldWidth);
-            y = QRandomGenerator::global()->bounded(0, gameFieldHeight);
+    // An agentless simulation of the recorded size keeps the field layout and HUD code shared
+    const ReplayHeader& header = player->getHeader();
+    gameFieldWidth = header.gameFieldWidth;
+    gameFieldHeight = header.gameFieldHeight;
+    simulation = std::make_unique<Simulation>(gameFieldWidth, gameFieldHeight, header.matchSeed);
+    simulation->setGameDuration(header.gameDuration);
 
-            if (x >= gameFieldWidth / 2 && x < gameFieldWidth && y >= 0 && y < gameFieldHeight) {
-                validPosition = true;
-            }
-        }
+    replayPlayer = std::move(player);
+    replayPaused = false;
+    replayTickPosition = static_cast<double>(replayPlayer->getFirstTick());
+
+    setupScene();
+    setupHud();
+    createReplayItems();
+    fitFieldInView();
+    startGame();
+    return true;
+}
 
-        // Construct the red agent and add to the list
-        auto redBrain = std::make_shared<Brain>();
-        auto redMemory = std::make_shared<Memory>();
-        auto agent = std::make_shared<Agent>(x, y, "red", gameFieldWidth, gameFieldHeight, pathfinder, taggingDistance, redBrain, redMemory, gameManager, blueAgents, redAgents);
-        agent->setCarryingFlag(false);
-        agent->setIsTagged(false);
-        redAgents.push_back(agent);
+void GameField::setReplayPaused(bool paused) {
+    if (!replayPlayer) {
+        return;
+    }
 
-        // Connect signals
-        connect(agent.get(), &Agent::blueFlagReset, this, [this, gameManager]() {
-            resetEnemyFlag("blue", gameManager);
-            });
+    // Playing from the last frame starts the replay over
+    if (!paused && replayPlayer->getFrame().tick >= replayPlayer->getLastTick()) {
+        seekReplay(replayPlayer->getFirstTick());
     }
+    replayPaused = paused;
 }
 
-void GameField::runTestCase1() {
-    // Test case 1: Default game setup (4 blue agents, 4 red agents)
+void GameField::seekReplay(long long tick) {
+    if (!replayPlayer) {
+        return;
+    }
+    tick = std::clamp(tick, replayPlayer->getFirstTick(), replayPlayer->getLastTick());
+    replayTickPosition = static_cast<double>(tick);
+    replayPlayer->seek(tick);
 }
 
-void GameField::runTestCase2(int agentCount, const std::shared_ptr<GameManager>& gameManager) {
-    clearAgents();
-    int blueCount = agentCount / 2;
-    int redCount = agentCount - blueCount;
-    setupAgents(blueCount, redCount, gameFieldWidth, gameFieldHeight, gameManager);
-    setupScene();
-    updateSceneItems();
+void GameField::stopReplay() {
+    replayPlayer.reset();
+    replayItems.clear();
+}
 
-    // Set up the score displays
-    QGraphicsTextItem* blueScoreText = new QGraphicsTextItem();
-    blueScoreTextItem = blueScoreText;
-    blueScoreTextItem->setPlainText("Blue Score: 0");
-    blueScoreTextItem->setDefaultTextColor(Qt::blue);
-    blueScoreTextItem->setFont(QFont("Arial", 16));
-    blueScoreTextItem->setPos(10, 10);
-    scene->addItem(blueScoreTextItem);
+void GameField::createReplayItems() {
+    const ReplayHeader& header = replayPlayer->getHeader();
+    int agentCount = header.blueCount + header.redCount;
+    if (agentCount > agentLayerThreshold) {
+        agentLayer = new AgentLayerItem(simulation->getBlueAgents(), simulation->getRedAgents(), QRectF(0, 0, gameFieldWidth, gameFieldHeight));
+        agentLayer->setReplayFrame(&replayPlayer->getFrame(), header.blueCount);
+        scene->addItem(agentLayer);
+        return;
+    }
 
-    QGraphicsTextItem* redScoreText = new QGraphicsTextItem();
-    redScoreTextItem = redScoreText;
-    redScoreTextItem->setPlainText("Red Score: 0");
-    redScoreTextItem->setDefaultTextColor(Qt::red);
-    redScoreTextItem->setFont(QFont("Arial", 16));
-    redScoreTextItem->setPos(600, 10);
-    scene->addItem(redScoreTextItem);
+    for (int i = 0; i < agentCount; ++i) {
+        QGraphicsEllipseItem* agentItem = new QGraphicsEllipseItem(-10, -10, 20, 20);
+        agentItem->setBrush(i < header.blueCount ? Qt::blue : Qt::red);
+        scene->addItem(agentItem);
+        replayItems.append(agentItem);
+    }
+    syncReplayScene();
+}
 
-    // Add time remaining display
-    QGraphicsTextItem* timeRemainingText = new QGraphicsTextItem();
-    timeRemainingTextItem = timeRemainingText;
-    timeRemainingTextItem->setPlainText("Time Remaining: 600");
-    timeRemainingTextItem->setDefaultTextColor(Qt::black);
-    timeRemainingTextItem->setFont(QFont("Arial", 16));
-    timeRemainingTextItem->setPos(300, 10);
-    scene->addItem(timeRemainingTextItem);
+void GameField::handleReplayFrame(qint64 realElapsedMillis) {
+    bool seekFinished = replayPlayer->collectSeek();
+
+    if (!replayPaused && !replayPlayer->isSeeking()) {
+        if (speedMultiplier == maxSpeed) {
+            replayTickPosition += 1.0;
+        }
+        else {
+            replayTickPosition += static_cast<double>(realElapsedMillis) * speedMultiplier / replayPlayer->getHeader().tickMillis;
+        }
+
+        // Stop on the last frame rather than looping
+        if (replayTickPosition >= replayPlayer->getLastTick()) {
+            replayTickPosition = static_cast<double>(replayPlayer->getLastTick());
+            replayPaused = true;
+        }
+        replayPlayer->advanceTo(static_cast<long long>(replayTickPosition));
+    }
+
+    if (seekFinished || replayPlayer->getFrame().tick != lastRenderedTick) {
+        syncReplayScene();
+        emit replayPositionChanged(replayPlayer->getFrame().tick);
+    }
+}
+
+void GameField::syncReplayScene() {
+    const ReplayFrame& frame = replayPlayer->getFrame();
+    const ReplayHeader& header = replayPlayer->getHeader();
 
-    // Start a timer to update agents
-    int gameDuration = 600; // 10 minutes in seconds
-    timeRemaining = gameDuration;
-    blueScore = 0;
-    redScore = 0;
+    if (agentLayer) {
+        agentLayer->update();
+    }
+    else {
+        for (int i = 0; i < replayItems.size() && i < static_cast<int>(frame.agents.size()); ++i) {
+            const ReplayAgentState& state = frame.agents[i];
+            bool isBlue = i < header.blueCount;
+            QGraphicsEllipseItem* agentItem = replayItems[i];
+            agentItem->setPos(state.x, state.y);
+            agentItem->setPen((state.flags & ReplayFormat::taggedFlag) ? QPen(Qt::yellow, 3) : QPen(Qt::black, 1));
+            if (state.flags & ReplayFormat::carryingFlag) {
+                agentItem->setBrush(isBlue ? Qt::cyan : Qt::magenta);
+            }
+            else {
+                agentItem->setBrush(isBlue ? Qt::blue : Qt::red);
+            }
+        }
+    }
 
-    gameTimer = new QTimer(this);
-    connect(gameTimer, &QTimer::timeout, this, &GameField::handleGameTimerTimeout);
-    gameTimer->start(100);
+    blueScoreTextItem->setPlainText("Blue Score: " + QString::number(frame.blueScore));
+    redScoreTextItem->setPlainText("Red Score: " + QString::number(frame.redScore));
+    long long elapsedSeconds = frame.tick * header.tickMillis / 1000;
+    timeRemainingTextItem->setPlainText("Time Remaining: " + QString::number(std::max(0LL, header.gameDuration - elapsedSeconds)));
+    viewport()->update();
+    lastRenderedTick = frame.tick;
 }
 
 void GameField::runTestCase3() {
@@ -240,89 +349,37 @@ void GameField::runTestCase3() {
         }
 
         // Update the agent item positions
-        for (const auto& agent : blueAgents) {
-            QGraphicsItem* item = getAgentItem(agent.get());
-            updateAgentItemPositions(item, agent);
-        }
-
-        for (const auto& agent : redAgents) {
-            QGraphicsItem* item = getAgentItem(agent.get());
-            updateAgentItemPositions(item, agent);
-        }
+        syncScene();
     }
     else {
         qDebug() << "Error: Red or blue flag item not found in the scene";
     }
 }
 
-void GameField::handleFlagCapture(const QString& side, const std::shared_ptr<GameManager>& gameManager) {
-    if (side == "blue") {
-        blueScore++;
-        resetEnemyFlag("red", gameManager);
+void GameField::syncScene() {
+    if (agentLayer) {
+        // The layer reads agent state itself when it paints
+        agentLayer->update();
     }
-    else if (side == "red") {
-        redScore++;
-        resetEnemyFlag("blue", gameManager);
-    }
-
-    updateScoreDisplay();
-}
-
-void GameField::updateAgents(int elapsedTime) {
-    // Log the start of the update process
-    qDebug() << "Updating agents...";
-
-    // Update and render blue agents
-    for (const auto& agent : blueAgents) {
-        std::vector<std::pair<int, int>> blueAgentPositions = getAgentPositions(blueAgents);
-        std::vector<Agent*> blueAgentPointers;
-        for (const auto& blueAgent : blueAgents) {
-            blueAgentPointers.push_back(blueAgent.get());
+    else {
+        for (const auto& agent : simulation->getBlueAgents()) {
+            updateAgentItemPositions(getAgentItem(agent.get()), agent);
         }
-
-        // Log the agent's initial state
-        qDebug() << "Updating red agent at (" << agent->getX() << ", " << agent->getY() << "), carrying flag:" << agent->isCarryingFlag() << ", tagged:" << agent->isTagged();
-
-        agent->update(blueAgentPositions, blueAgentPointers, blueAgents, redAgents, elapsedTime);
-
-        QGraphicsItem* item = getAgentItem(agent.get());
-        updateAgentItemPositions(item, agent);
-
-        // Log the agent's updated state
-        qDebug() << "Updated red agent at (" << agent->getX() << ", " << agent->getY() << "), carrying flag:" << agent->isCarryingFlag() << ", tagged:" << agent->isTagged();
-
-        // Render the updated agent
-        viewport()->update();
-    }
-
-    // Update and render red agents
-    for (const auto& agent : redAgents) {
-        std::vector<std::pair<int, int>> redAgentPositions = getAgentPositions(redAgents);
-        std::vector<Agent*> redAgentPointers;
-        for (const auto& redAgent : redAgents) {
-            redAgentPointers.push_back(redAgent.get());
+        for (const auto& agent : simulation->getRedAgents()) {
+            updateAgentItemPositions(getAgentItem(agent.get()), agent);
         }
-
-        // Log the agent's initial state
-        qDebug() << "Updating blue agent at (" << agent->getX() << ", " << agent->getY() << "), carrying flag:" << agent->isCarryingFlag() << ", tagged:" << agent->isTagged();
-
-        agent->update(redAgentPositions, redAgentPointers, blueAgents, redAgents, elapsedTime);
-
-        QGraphicsItem* item = getAgentItem(agent.get());
-        updateAgentItemPositions(item, agent);
-
-        // Log the agent's updated state
-        qDebug() << "Updated blue agent at (" << agent->getX() << ", " << agent->getY() << "), carrying flag:" << agent->isCarryingFlag() << ", tagged:" << agent->isTagged();
-
-        // Render the updated agent
-        viewport()->update();
     }
 
-    // Check for tagging after updating all agents
-    checkTagging();
-
-    // Log the end of the update process
-    qDebug() << "Agents updated.";
+    bool scoresChanged = false;
+    uint64_t missedEvents = simulation->getGameManager()->getEvents().drain(scoreEventCursor, [&scoresChanged](const GameEvent& event) {
+        scoresChanged |= event.type == GameEventType::FlagCaptured;
+    });
+    if (scoresChanged || missedEvents > 0) {
+        updateScoreDisplay();
+    }
+    updateTimeDisplay();
+    viewport()->update();
+    lastRenderedTick = simulation->getTick();
 }
 
 void GameField::updateAgentItemPositions(QGraphicsItem* item, const std::shared_ptr<Agent>& agent) {
@@ -355,51 +412,66 @@ void GameField::updateAgentItemPositions(QGraphicsItem* item, const std::shared_
 
             // Check for unexpected changes
             if (agent->getX() != oldX || agent->getY() != oldY) {
-                qDebug() << "Agent position changed unexpectedly from (" << oldX << ", " << oldY << ") to (" << agent->getX() << ", " << agent->getY() << ")";
+                qCDebug(renderLog) << "Agent position changed unexpectedly from (" << oldX << ", " << oldY << ") to (" << agent->getX() << ", " << agent->getY() << ")";
             }
         }
     }
     else {
-        qDebug() << "Agent item not found in the scene for agent at position (" << agent->getX() << ", " << agent->getY() << ")";
+        qCDebug(renderLog) << "Agent item not found in the scene for agent at position (" << agent->getX() << ", " << agent->getY() << ")";
     }
 }
 
-std::vector<std::pair<int, int>> GameField::getAgentPositions(const std::vector<std::shared_ptr<Agent>>& agents) const {
-    std::vector<std::pair<int, int>> positions;
-    for (const auto& agent : agents) {
-        positions.emplace_back(agent->getX(), agent->getY());
+void GameField::handleFrameTimerTimeout() {
+    qint64 now = frameClock.elapsed();
+    qint64 realElapsedMillis = now - lastFrameMillis;
+    lastFrameMillis = now;
+
+    if (replayPlayer) {
+        handleReplayFrame(realElapsedMillis);
+        return;
     }
-    return positions;
-}
 
-void GameField::handleGameTimerTimeout() {
-    // Calculate the elapsed time since the last frame
-    int elapsedTime = gameTimer->interval();
+    QElapsedTimer simulationBudget;
+    simulationBudget.start();
+    int tickMillis = simulation->getTickMillis();
 
-    // Update the agents based on the elapsed time
-    updateAgents(elapsedTime);
+    if (speedMultiplier == maxSpeed) {
+        // Step as many ticks as fit in the frame and leave the rest for rendering
+        while (!simulation->isFinished() && simulationBudget.elapsed() < simulationBudgetMillis) {
+            simulation->advance(std::numeric_limits<long long>::max());
+        }
+    }
+    else {
+        // Real time scaled by the speed multiplier buys fixed-size ticks
+        tickAccumulatorMillis += static_cast<double>(realElapsedMillis) * speedMultiplier;
+        while (!simulation->isFinished() && tickAccumulatorMillis >= tickMillis) {
+            // Quiet stretches may be skipped, but never past the time this frame bought
+            long long ticksDue = static_cast<long long>(tickAccumulatorMillis / tickMillis);
+            tickAccumulatorMillis -= static_cast<double>(simulation->advance(ticksDue)) * tickMillis;
+
+            // Falling behind: drop the backlog instead of starving the display
+            if (simulationBudget.elapsed() >= simulationBudgetMillis) {
+                tickAccumulatorMillis = std::min(tickAccumulatorMillis, static_cast<double>(tickMillis));
+                break;
+            }
+        }
+    }
 
-    // Update the remaining time and display
-    timeRemaining -= elapsedTime / 1000;
-    updateTimeDisplay();
+    // Only redraw when the simulation moved since the last frame
+    if (simulation->getTick() != lastRenderedTick) {
+        syncScene();
+    }
 
     // Check if the game has ended
-    if (timeRemaining <= 0) {
+    if (simulation->isFinished()) {
         stopGame();
         declareWinner();
     }
 }
 
 void GameField::stopGame() {
-    gameTimer->stop();
-
-    for (const auto& agent : blueAgents) {
-        agent->setEnabled(false);
-    }
-
-    for (const auto& agent : redAgents) {
-        agent->setEnabled(false);
-    }
+    frameTimer->stop();
+    simulation->stop();
 }
 
 void GameField::declareWinner() {
@@ -407,6 +479,9 @@ void GameField::declareWinner() {
     winnerText->setFont(QFont("Arial", 24));
     winnerText->setPos(300, 250);
 
+    int blueScore = simulation->getBlueScore();
+    int redScore = simulation->getRedScore();
+
     if (blueScore > redScore) {
         // Blue team wins
         winnerText->setPlainText("Game Over! Blue Team Wins!");
@@ -427,103 +502,16 @@ void GameField::declareWinner() {
 }
 
 
-void GameField::checkTagging() {
-    for (const auto& agent : blueAgents) {
-        if (agent->isOnEnemySide() && !agent->isTagged()) {
-            for (const auto& enemyAgent : redAgents) {
-                if (enemyAgent->checkInTeamZone() && !enemyAgent->isTagged() && agent->distanceTo(enemyAgent.get()) <= taggingDistance) {
-                    agent->setIsTagged(true);
-                    break;
-                }
-            }
-        }
-    }
-
-    for (const auto& agent : redAgents) {
-        if (agent->isOnEnemySide() && !agent->isTagged()) {
-            for (const auto& enemyAgent : blueAgents) {
-                if (enemyAgent->checkInTeamZone() && !enemyAgent->isTagged() && agent->distanceTo(enemyAgent.get()) <= taggingDistance) {
-                    agent->setIsTagged(true);
-                    break;
-                }
-            }
-        }
-    }
-}
-
 QGraphicsItem* GameField::getAgentItem(Agent* agent) {
-    qDebug() << "Looking for agent item with pointer with getAgentItem:" << agent;
-    qDebug() << "Agent position with getAgentItem: (" << agent->getX() << ", " << agent->getY() << ")";
-    qDebug() << "Agent side with getAgentItem:" << QString::fromStdString(agent->getSide());
-
-    for (QGraphicsItem* item : scene->items()) {
-        qDebug() << "Item data with getAgentItem:" << item->data(0).toString();
-        if (item->data(0).value<quintptr>() == reinterpret_cast<quintptr>(agent)) {
-            qDebug() << "Found matching item for agent with getAgentItem:" << agent;
-            return item;
-        }
+    QGraphicsEllipseItem* item = agentItems.value(agent, nullptr);
+    if (!item) {
+        qCDebug(renderLog) << "No matching item found for agent with getAgentItem:" << agent;
     }
-
-    qDebug() << "No matching item found for agent with getAgentItem:" << agent;
-    return nullptr;
+    return item;
 }
 
 void GameField::updateSceneItems() {
-    for (QGraphicsItem* item : scene->items()) {
-        updateAgentItem(item, blueAgents, Qt::blue);
-        updateAgentItem(item, redAgents, Qt::red);
-    }
-}
-
-void GameField::updateAgentItem(QGraphicsItem* item, const std::vector<std::shared_ptr<Agent>>& agents, QColor color) {
-    if (QGraphicsEllipseItem* agentItem = qgraphicsitem_cast<QGraphicsEllipseItem*>(item)) {
-        for (const auto& agent : agents) {
-            if (agentItem->brush().color() == color) {
-                int x = agent->getX();
-                int y = agent->getY();
-                agentItem->setRect(x - 10, y - 10, 20, 20);
-            }
-        }
-    }
-}
-
-void GameField::resetEnemyFlag(const QString& team, const std::shared_ptr<GameManager>& gameManager) {
-    if (team == "red") {
-        // Reset the red flag position
-        QGraphicsPolygonItem* redFlag = findFlagItem("red");
-        if (redFlag) {
-            QPolygon redTriangle;
-            redTriangle << QPoint(710, 280) << QPoint(720, 300) << QPoint(700, 300);
-            redFlag->setPolygon(redTriangle);
-        }
-        else {
-            // Handle the case when the red flag item is not found in the scene
-            qDebug() << "Red flag item not found in the scene";
-        }
-
-        // Reset the carrying flag state of blue agents
-        for (const auto& agent : blueAgents) {
-            agent->setCarryingFlag(false);
-        }
-    }
-    else if (team == "blue") {
-        // Reset the blue flag position
-        QGraphicsPolygonItem* blueFlag = findFlagItem("blue");
-        if (blueFlag) {
-            QPolygon blueTriangle;
-            blueTriangle << QPoint(70, 280) << QPoint(80, 300) << QPoint(60, 300);
-            blueFlag->setPolygon(blueTriangle);
-        }
-        else {
-            // Handle the case when the blue flag item is not found in the scene
-            qDebug() << "Blue flag item not found in the scene";
-        }
-
-        // Reset the carrying flag state of red agents
-        for (const auto& agent : redAgents) {
-            agent->setCarryingFlag(false);
-        }
-    }
+    syncScene();
 }
 
 QGraphicsPolygonItem* GameField::findFlagItem(const QString& team) {
@@ -539,47 +527,62 @@ QGraphicsPolygonItem* GameField::findFlagItem(const QString& team) {
 }
 
 void GameField::updateScoreDisplay() {
-    blueScoreTextItem->setPlainText("Blue Score: " + QString::number(blueScore));
-    redScoreTextItem->setPlainText("Red Score: " + QString::number(redScore));
+    blueScoreTextItem->setPlainText("Blue Score: " + QString::number(simulation->getBlueScore()));
+    redScoreTextItem->setPlainText("Red Score: " + QString::number(simulation->getRedScore()));
 }
 
 void GameField::updateTimeDisplay() {
-    timeRemainingTextItem->setPlainText("Time Remaining: " + QString::number(timeRemaining));
+    timeRemainingTextItem->setPlainText("Time Remaining: " + QString::number(std::max(0, simulation->getTimeRemaining())));
 }
 
 void GameField::setupScene() {
-    scene = new QGraphicsScene(this);
-    setScene(scene);
+    // One scene for the life of the view; a new match empties it instead of leaking the old one
+    if (!scene) {
+        scene = new QGraphicsScene(this);
+        setScene(scene);
+    }
+    else {
+        scene->clear();
+        agentItems.clear();
+        agentLayer = nullptr;
+    }
 
     // Set the scene rect to match the game field size
-    setSceneRect(0, 0, 800, 600);
+    setSceneRect(0, 0, gameFieldWidth, gameFieldHeight);
 
     setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
 
     // Add the combined game field of blue area and red area
-    this->gameField = new QGraphicsRectItem(5, 10, 790, 580);
+    this->gameField = new QGraphicsRectItem(5, 10, gameFieldWidth - 10, gameFieldHeight - 20);
     this->gameField->setPen(QPen(Qt::black, 2));
     scene->addItem(this->gameField);
 
     // Add team areas fields
-    QGraphicsRectItem* blueArea = new QGraphicsRectItem(5, 10, 400, 580);
+    QGraphicsRectItem* blueArea = new QGraphicsRectItem(5, 10, gameFieldWidth / 2, gameFieldHeight - 20);
     blueArea->setPen(QPen(Qt::blue, 2));
     scene->addItem(blueArea);
 
-    QGraphicsRectItem* redArea = new QGraphicsRectItem(410, 10, 390, 580);
+    QGraphicsRectItem* redArea = new QGraphicsRectItem(gameFieldWidth / 2 + 10, 10, gameFieldWidth / 2 - 10, gameFieldHeight - 20);
     redArea->setPen(QPen(Qt::red, 2));
     scene->addItem(redArea);
 
-    // Add team zones (circular areas around flags)
-    QGraphicsEllipseItem* blueZone = new QGraphicsEllipseItem(50, 260, 80, 80);
+    // Add team zones (circular areas around flags) at the default layout for this field
+    simulation->placeFlagsAndZones();
+    std::shared_ptr<GameManager> gameManager = simulation->getGameManager();
+    std::pair<int, int> blueZonePosition = gameManager->getTeamZonePosition("blue");
+    std::pair<int, int> redZonePosition = gameManager->getTeamZonePosition("red");
+    std::pair<int, int> blueFlagPosition = gameManager->getFlagPosition("blue");
+    std::pair<int, int> redFlagPosition = gameManager->getFlagPosition("red");
+
+    QGraphicsEllipseItem* blueZone = new QGraphicsEllipseItem(blueZonePosition.first - 40, blueZonePosition.second - 40, 80, 80);
     QPen bluePen(Qt::blue);
     bluePen.setWidth(3);
     blueZone->setPen(bluePen);
     blueZone->setBrush(Qt::NoBrush);
     scene->addItem(blueZone);
 
-    QGraphicsEllipseItem* redZone = new QGraphicsEllipseItem(690, 260, 80, 80);
+    QGraphicsEllipseItem* redZone = new QGraphicsEllipseItem(redZonePosition.first - 40, redZonePosition.second - 40, 80, 80);
     QPen redPen(Qt::red);
     redPen.setWidth(3);
     redZone->setPen(redPen);
@@ -589,53 +592,68 @@ void GameField::setupScene() {
     // Add flags
     QGraphicsPolygonItem* blueFlag = new QGraphicsPolygonItem();
     QPolygon blueTriangle;
-    qreal blueFlagCenter = blueZone->rect().center().y();
-    blueTriangle << QPoint(70, blueFlagCenter - 20) << QPoint(80, blueFlagCenter) << QPoint(60, blueFlagCenter);
+    blueTriangle << QPoint(blueFlagPosition.first, blueFlagPosition.second - 10) << QPoint(blueFlagPosition.first + 10, blueFlagPosition.second + 10) << QPoint(blueFlagPosition.first - 10, blueFlagPosition.second + 10);
     blueFlag->setPolygon(blueTriangle);
     blueFlag->setBrush(Qt::blue);
     scene->addItem(blueFlag);
 
     QGraphicsPolygonItem* redFlag = new QGraphicsPolygonItem();
     QPolygon redTriangle;
-    qreal redFlagCenter = redZone->rect().center().y();
-    redTriangle << QPoint(710, redFlagCenter - 20) << QPoint(720, redFlagCenter) << QPoint(700, redFlagCenter);
+    redTriangle << QPoint(redFlagPosition.first, redFlagPosition.second - 10) << QPoint(redFlagPosition.first + 10, redFlagPosition.second + 10) << QPoint(redFlagPosition.first - 10, redFlagPosition.second + 10);
     redFlag->setPolygon(redTriangle);
     redFlag->setBrush(Qt::red);
     scene->addItem(redFlag);
 
-    // Update the GameManager with the flag positions
-    QPointF blueFlagPosition = blueFlag->boundingRect().center();
-    QPointF redFlagPosition = redFlag->boundingRect().center();
-
-    gameManager->setFlagPosition("blue", blueFlagPosition.x(), blueFlagPosition.y());
-    gameManager->setFlagPosition("red", redFlagPosition.x(), redFlagPosition.y());
+    createAgentItems();
+}
 
-    // Update the GameManager with the team zone positions
-    QPointF blueZoneCenter = blueZone->rect().center();
-    QPointF redZoneCenter = redZone->rect().center();
+void GameField::createAgentItems() {
+    agentItems.clear();
+    agentLayer = nullptr;
 
-    gameManager->setTeamZonePosition("blue", blueZoneCenter.x(), blueZoneCenter.y());
-    gameManager->setTeamZonePosition("red", redZoneCenter.x(), redZoneCenter.y());
+    const auto& blueAgents = simulation->getBlueAgents();
+    const auto& redAgents = simulation->getRedAgents();
+    if (static_cast<int>(blueAgents.size() + redAgents.size()) > agentLayerThreshold) {
+        agentLayer = new AgentLayerItem(blueAgents, redAgents, QRectF(0, 0, gameFieldWidth, gameFieldHeight));
+        scene->addItem(agentLayer);
+        return;
+    }
 
     // Create the visual representation of the agents
     for (const auto& agent : blueAgents) {
-        QGraphicsEllipseItem* blueAgentItem = new QGraphicsEllipseItem(agent->getX() - 10, agent->getY() - 10, 20, 20);
+        QGraphicsEllipseItem* blueAgentItem = new QGraphicsEllipseItem(-10, -10, 20, 20);
+        blueAgentItem->setPos(agent->getX(), agent->getY());
         blueAgentItem->setBrush(Qt::blue);
         blueAgentItem->setData(0, QVariant::fromValue(reinterpret_cast<quintptr>(agent.get())));
         scene->addItem(blueAgentItem);
+        agentItems.insert(agent.get(), blueAgentItem);
     }
 
     for (const auto& agent : redAgents) {
-        QGraphicsEllipseItem* redAgentItem = new QGraphicsEllipseItem(agent->getX() - 10, agent->getY() - 10, 20, 20);
+        QGraphicsEllipseItem* redAgentItem = new QGraphicsEllipseItem(-10, -10, 20, 20);
+        redAgentItem->setPos(agent->getX(), agent->getY());
         redAgentItem->setBrush(Qt::red);
         redAgentItem->setData(0, QVariant::fromValue(reinterpret_cast<quintptr>(agent.get())));
         scene->addItem(redAgentItem);
+        agentItems.insert(agent.get(), redAgentItem);
     }
 }
 
-GameField::~GameField() {
-    // Assuming agents are now managed via shared_ptr, no need to delete them
-    blueAgents.clear();
-    redAgents.clear();
+void GameField::fitFieldInView() {
+    // Fields bigger than the window are shown whole rather than cropped
+    if (gameFieldWidth > viewport()->width() || gameFieldHeight > viewport()->height()) {
+        fitInView(sceneRect(), Qt::KeepAspectRatio);
+    }
+    else {
+        resetTransform();
+    }
+}
 
+void GameField::resizeEvent(QResizeEvent* event) {
+    QGraphicsView::resizeEvent(event);
+    fitFieldInView();
+}
+
+GameField::~GameField() {
+    // Agents are owned by the simulation and released with it
 }
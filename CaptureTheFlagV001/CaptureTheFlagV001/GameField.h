@@ -6,61 +6,116 @@
 #include <QGraphicsItem>
 #include <QTimer>
 #include <QPointer>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QVector>
 #include "Agent.h"
 #include "GameManager.h"
 #include "Pathfinder.h"
+#include "Simulation.h"
+#include "AgentLayerItem.h"
+#include "ReplayPlayer.h"
 
 class GameField : public QGraphicsView {
     Q_OBJECT
 
 public:
-    GameField(QWidget* parent, int width, int height);
+    // Speed multiplier that steps as many ticks as fit in each frame
+    static const int maxSpeed = 0;
+
+    GameField(QWidget* parent, int width, int height, uint64_t matchSeed = GameManager::defaultMatchSeed);
     ~GameField();
 
     // Getter functions
-    std::shared_ptr<GameManager> getGameManager() const { return gameManager; }
-    std::shared_ptr<Pathfinder> getPathfinder() const { return pathfinder; }
-    int getTaggingDistance() const { return taggingDistance; }
+    std::shared_ptr<GameManager> getGameManager() const { return simulation->getGameManager(); }
+    std::shared_ptr<Pathfinder> getPathfinder() const { return simulation->getPathfinder(); }
+    int getTaggingDistance() const { return simulation->getTaggingDistance(); }
     QGraphicsScene* getScene() const { return scene; }
+    Simulation& getSimulation() { return *simulation; }
 
     void clearAgents();
-    void setupAgents(int blueCount, int redCount, int cols, int rows, const std::shared_ptr<GameManager>& gameManager);
+    void setupAgents(int blueCount, int redCount);
     void runTestCase1();
     void runTestCase2(int agentCount, const std::shared_ptr<GameManager>& gameManager);
     void runTestCase3();
-    void handleFlagCapture(const QString& side, const std::shared_ptr<GameManager>& gameManager);
-    void updateAgents(int elapsedTime);
+
+    // Replaces the match with a fresh one of any size, drawn as points past agentLayerThreshold
+    void runLargeScale(int agentCount, int fieldWidth, int fieldHeight);
+
+    // Reloads the match's parameters whenever the file changes, also after
+    // runLargeScale replaces the match; see Simulation::watchParamsFile
+    bool watchParamsFile(const QString& path, QString& error);
+
+    // Game seconds per real second, or maxSpeed
+    void setSpeedMultiplier(int multiplier);
+    int getSpeedMultiplier() const { return speedMultiplier; }
+
+    // Playback mode: the field shows a recorded match instead of simulating.
+    // The speed multiplier applies as for live matches; at maxSpeed every
+    // recorded tick gets one display frame.
+    bool playReplay(const QString& path, QString& error);
+    bool isPlayingReplay() const { return replayPlayer != nullptr; }
+    void setReplayPaused(bool paused);
+    bool isReplayPaused() const { return replayPaused; }
+    void seekReplay(long long tick);
+    long long getReplayFirstTick() const { return replayPlayer ? replayPlayer->getFirstTick() : 0; }
+    long long getReplayLastTick() const { return replayPlayer ? replayPlayer->getLastTick() : 0; }
+
+signals:
+    void replayPositionChanged(long long tick);
 
 private slots:
     void updateAgentItemPositions(QGraphicsItem* item, const std::shared_ptr<Agent>& agent);
-    std::vector<std::pair<int, int>> getAgentPositions(const std::vector<std::shared_ptr<Agent>>& agents) const;
-    void handleGameTimerTimeout();
+    void handleFrameTimerTimeout();
 
 private:
     void setupScene();
+    void setupHud();
+    void startGame();
+    void syncScene();
+    void createAgentItems();
+    void fitFieldInView();
+    void resizeEvent(QResizeEvent* event) override;
     QGraphicsPolygonItem* findFlagItem(const QString& team);
+    void stopReplay();
+    void createReplayItems();
+    void handleReplayFrame(qint64 realElapsedMillis);
+    void syncReplayScene();
 
     QGraphicsScene* scene;
-    std::vector<std::shared_ptr<Agent>> blueAgents;
-    std::vector<std::shared_ptr<Agent>> redAgents;
+    std::unique_ptr<Simulation> simulation;
+    QString paramsPath;
     int gameFieldWidth;
     int gameFieldHeight;
-    std::shared_ptr<GameManager> gameManager;
-    std::shared_ptr<Pathfinder> pathfinder;
-    int blueScore;
-    int redScore;
-    int timeRemaining;
-    QTimer* gameTimer;
-    float taggingDistance;
     QGraphicsTextItem* timeRemainingTextItem;
     QPointer<QGraphicsTextItem> blueScoreTextItem;
     QPointer<QGraphicsTextItem> redScoreTextItem;
     QGraphicsRectItem* gameField;
 
-    void checkTagging();
+    // One ellipse per agent for small matches, one point layer for large ones
+    QHash<const Agent*, QGraphicsEllipseItem*> agentItems;
+    AgentLayerItem* agentLayer;
+    static const int agentLayerThreshold = 2000;
+
+    // Frame pacing: the frame timer runs at display rate and the simulation
+    // catches up from an accumulator of speed-scaled real time
+    QTimer* frameTimer;
+    QElapsedTimer frameClock;
+    qint64 lastFrameMillis;
+    double tickAccumulatorMillis;
+    int speedMultiplier;
+    long long lastRenderedTick;
+    uint64_t scoreEventCursor;
+    static const int frameIntervalMillis = 16;
+    static const int simulationBudgetMillis = 12;
+
+    // Playback state; replayItems follow the frame's agent order
+    std::unique_ptr<ReplayPlayer> replayPlayer;
+    QVector<QGraphicsEllipseItem*> replayItems;
+    bool replayPaused;
+    double replayTickPosition;
+
     QGraphicsItem* getAgentItem(Agent* agent);
-    void updateAgentItem(QGraphicsItem* item, const std::vector<std::shared_ptr<Agent>>& agents, QColor color);
-    void resetEnemyFlag(const QString& team, const std::shared_ptr<GameManager>& gameManager);
     void updateSceneItems();
     void updateScoreDisplay();
     void updateTimeDisplay();
@@ -3,10 +3,19 @@
 
 #include <utility>
 #include <string>
+#include <cstdint>
+#include "GameEvents.h"
+#include "GameParams.h"
+#include "SimClock.h"
+
+class BinaryWriter;
+class BinaryReader;
 
 class GameManager {
 public:
-    GameManager(int gameFieldWidth, int gameFieldHeight);
+    static const uint64_t defaultMatchSeed = 20240501;
+
+    GameManager(int gameFieldWidth, int gameFieldHeight, uint64_t matchSeed = defaultMatchSeed);
 
     std::pair<int, int> getFlagPosition(const std::string& side) const;
     void setFlagPosition(const std::string& side, int x, int y);
@@ -16,8 +25,27 @@ public:
     std::pair<int, int> getEnemyFlagPosition(const std::string& side) const;
     std::pair<int, int> getTeamZonePosition(const std::string& side) const;
 
+    // First column of the red half; the gap of midlineOffset columns between halves counts as blue
+    int getMidlineX() const { return gameFieldWidth / 2 + params.midlineOffset; }
+
+    // Rule and brain parameters for everyone holding this manager
+    const GameParams& getParams() const { return params; }
+    void setParams(const GameParams& newParams) { params = newParams; }
+
     void resetGame();
 
+    SimClock& getClock() { return clock; }
+    const SimClock& getClock() const { return clock; }
+    GameEventBuffer& getEvents() { return events; }
+    const GameEventBuffer& getEvents() const { return events; }
+    uint64_t getMatchSeed() const { return matchSeed; }
+    void setMatchSeed(uint64_t seed) { matchSeed = seed; }
+
+    // Flags, zones, clock, seed and parameters; the field size is fixed at construction.
+    // Events are not part of the state, consumers have drained them by then.
+    void saveState(BinaryWriter& writer) const;
+    void loadState(BinaryReader& reader);
+
 private:
     int gameFieldWidth, gameFieldHeight;
     std::pair<int, int> blueFlagPosition;
@@ -27,6 +55,10 @@ private:
     int maxTime;
     int currentTime;
     bool gameOver;
+    SimClock clock;
+    GameEventBuffer events;
+    uint64_t matchSeed;
+    GameParams params;
 };
 
 #endif 
\ No newline at end of file
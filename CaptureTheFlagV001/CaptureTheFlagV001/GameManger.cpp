@@ -1,10 +1,13 @@
 #include "GameManager.h"
+#include "BinaryStream.h"
 
-GameManager::GameManager(int gameFieldWidth, int gameFieldHeight)
-    : blueFlagPosition(35, 3), // Set the correct initial position for the blue flag
+GameManager::GameManager(int gameFieldWidth, int gameFieldHeight, uint64_t matchSeed)
+    : gameFieldWidth(gameFieldWidth), gameFieldHeight(gameFieldHeight),
+    blueFlagPosition(35, 3), // Set the correct initial position for the blue flag
     redFlagPosition(35, 14), // Set the correct initial position for the red flag
     blueTeamZonePosition(0, gameFieldHeight / 2),
-    redTeamZonePosition(gameFieldWidth - 1, gameFieldHeight / 2) {}
+    redTeamZonePosition(gameFieldWidth - 1, gameFieldHeight / 2),
+    maxTime(0), currentTime(0), gameOver(false), matchSeed(matchSeed) {}
 
 std::pair<int, int> GameManager::getFlagPosition(const std::string& side) const {
     if (side == "blue") {
@@ -32,7 +35,7 @@ std::pair<int, int> GameManager::getEnemyFlagPosition(const std::string& side) c
     return (side == "blue") ? redFlagPosition : blueFlagPosition;
 }
 std::pair<int, int> GameManager::getTeamZonePosition(const std::string& side) const {
-    int teamZoneRadius = 40; // Radius of the team zone (half of the team zone diameter)
+    int teamZoneRadius = params.teamZoneRadius; // Radius of the team zone (half of the team zone diameter)
 
     // Get the current flag position based on the agent's side
     std::pair<int, int> flagPosition = getFlagPosition(side);
@@ -63,7 +66,7 @@ bool GameManager::isFlag(int x, int y) const {
 }
 
 bool GameManager::isTeamZone(int x, int y) const {
-    const int teamZoneRadius = 40;
+    const int teamZoneRadius = params.teamZoneRadius;
     const std::pair<int, int> blueTeamZoneCenter = getTeamZonePosition("blue");
     const std::pair<int, int> redTeamZoneCenter = getTeamZonePosition("red");
 
@@ -86,4 +89,33 @@ void GameManager::resetGame() {
     // Reset game state variables
     currentTime = maxTime;
     gameOver = false;
-}
\ No newline at end of file
+    clock.reset();
+}
+
+void GameManager::saveState(BinaryWriter& writer) const {
+    for (const auto& position : { blueFlagPosition, redFlagPosition, blueTeamZonePosition, redTeamZonePosition }) {
+        writer.writeInt32(position.first);
+        writer.writeInt32(position.second);
+    }
+    writer.writeInt32(maxTime);
+    writer.writeInt32(currentTime);
+    writer.writeBool(gameOver);
+    writer.writeUInt64(matchSeed);
+    writer.writeInt64(clock.getTick());
+    writer.writeInt32(clock.getTickMillis());
+    params.saveState(writer);
+}
+
+void GameManager::loadState(BinaryReader& reader) {
+    for (auto* position : { &blueFlagPosition, &redFlagPosition, &blueTeamZonePosition, &redTeamZonePosition }) {
+        position->first = reader.readInt32();
+        position->second = reader.readInt32();
+    }
+    maxTime = reader.readInt32();
+    currentTime = reader.readInt32();
+    gameOver = reader.readBool();
+    matchSeed = reader.readUInt64();
+    clock.setTick(reader.readInt64());
+    clock.setTickMillis(reader.readInt32());
+    params.loadState(reader);
+}
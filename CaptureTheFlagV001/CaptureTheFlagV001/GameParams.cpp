@@ -0,0 +1,202 @@
+#include "GameParams.h"
+#include "BinaryStream.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <vector>
+
+GameParams::GameParams()
+    : proximityThreshold(10.0f), flagReachDistance(10.0f), teamZoneRadius(40), midlineOffset(10), tagCooldownSeconds(30),
+    memoryRetentionSeconds(5.0), viewRange(64.0f), viewAngle(120.0f),
+    blueUtility(UtilityBrain::getDefaultWeights()), redUtility(UtilityBrain::getDefaultWeights()) {}
+
+namespace {
+    // One parameter: its key, where it lives and the smallest and largest value it takes
+    struct ParamField {
+        std::string key;
+        float* floatValue;
+        int* intValue;
+        double* doubleValue;
+        double lowest;
+        double highest;
+    };
+
+    ParamField floatField(const std::string& key, float& value, double lowest, double highest) {
+        return ParamField{ key, &value, nullptr, nullptr, lowest, highest };
+    }
+
+    ParamField intField(const std::string& key, int& value, double lowest, double highest) {
+        return ParamField{ key, nullptr, &value, nullptr, lowest, highest };
+    }
+
+    ParamField doubleField(const std::string& key, double& value, double lowest, double highest) {
+        return ParamField{ key, nullptr, nullptr, &value, lowest, highest };
+    }
+
+    std::vector<ParamField> getFields(GameParams& params) {
+        const double unbounded = 1.0e9;
+        std::vector<ParamField> fields = {
+            floatField("proximity_threshold", params.proximityThreshold, 0.0, unbounded),
+            floatField("flag_reach_distance", params.flagReachDistance, 0.0, unbounded),
+            intField("team_zone_radius", params.teamZoneRadius, 1.0, 100000.0),
+            intField("midline_offset", params.midlineOffset, -100000.0, 100000.0),
+            intField("tag_cooldown_seconds", params.tagCooldownSeconds, 0.0, 100000.0),
+            doubleField("memory_retention_seconds", params.memoryRetentionSeconds, 0.001, unbounded),
+            floatField("view_range", params.viewRange, 0.0, unbounded),
+            floatField("view_angle", params.viewAngle, 0.001, 360.0),
+        };
+        for (auto team : { std::make_pair(std::string("blue"), &params.blueUtility), std::make_pair(std::string("red"), &params.redUtility) }) {
+            UtilityWeights& weights = *team.second;
+            std::string prefix = team.first + ".utility.";
+            fields.push_back(floatField(prefix + "capture_flag", weights.captureFlag, -unbounded, unbounded));
+            fields.push_back(floatField(prefix + "tag_enemy", weights.tagEnemy, -unbounded, unbounded));
+            fields.push_back(floatField(prefix + "recover_flag", weights.recoverFlag, -unbounded, unbounded));
+            fields.push_back(floatField(prefix + "return_to_home_zone", weights.returnToHomeZone, -unbounded, unbounded));
+            fields.push_back(floatField(prefix + "grab_flag", weights.grabFlag, -unbounded, unbounded));
+            fields.push_back(floatField(prefix + "explore", weights.explore, -unbounded, unbounded));
+        }
+        return fields;
+    }
+
+    std::string trim(const std::string& text) {
+        size_t first = text.find_first_not_of(" \t\r");
+        if (first == std::string::npos) {
+            return std::string();
+        }
+        size_t last = text.find_last_not_of(" \t\r");
+        return text.substr(first, last - first + 1);
+    }
+}
+
+bool GameParams::parse(const std::string& text, GameParams& params, std::string& error) {
+    GameParams parsed = params;
+    std::vector<ParamField> fields = getFields(parsed);
+    std::set<std::string> seen;
+
+    std::istringstream lines(text);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(lines, line)) {
+        lineNumber++;
+        std::string content = trim(line.substr(0, line.find('#')));
+        if (content.empty()) {
+            continue;
+        }
+
+        std::string where = "Line " + std::to_string(lineNumber) + ": ";
+        size_t equals = content.find('=');
+        if (equals == std::string::npos) {
+            error = where + "expected key = value";
+            return false;
+        }
+        std::string key = trim(content.substr(0, equals));
+        std::string valueText = trim(content.substr(equals + 1));
+
+        auto field = std::find_if(fields.begin(), fields.end(), [&key](const ParamField& candidate) { return candidate.key == key; });
+        if (field == fields.end()) {
+            error = where + "unknown key " + key;
+            return false;
+        }
+        if (!seen.insert(key).second) {
+            error = where + key + " is set twice";
+            return false;
+        }
+
+        // Whole numbers for integer keys, and nothing after the number
+        char* end = nullptr;
+        double value = std::strtod(valueText.c_str(), &end);
+        bool wellFormed = !valueText.empty() && end != nullptr && *end == '\0' && std::isfinite(value);
+        if (!wellFormed || (field->intValue != nullptr && value != std::floor(value))) {
+            error = where + key + " needs " + (field->intValue != nullptr ? "a whole number" : "a number") + ", got " + valueText;
+            return false;
+        }
+        if (value < field->lowest || value > field->highest) {
+            std::ostringstream range;
+            range << where << key << " must be between " << field->lowest << " and " << field->highest << ", got " << valueText;
+            error = range.str();
+            return false;
+        }
+
+        if (field->floatValue != nullptr) {
+            *field->floatValue = static_cast<float>(value);
+        }
+        else if (field->intValue != nullptr) {
+            *field->intValue = static_cast<int>(value);
+        }
+        else {
+            *field->doubleValue = value;
+        }
+    }
+
+    params = parsed;
+    return true;
+}
+
+bool GameParams::loadFile(const std::string& path, GameParams& params, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "Could not open " + path;
+        return false;
+    }
+    std::ostringstream text;
+    text << file.rdbuf();
+    if (!parse(text.str(), params, error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+std::string GameParams::format() const {
+    GameParams copy = *this;
+    std::ostringstream text;
+    text.precision(9);
+    for (const ParamField& field : getFields(copy)) {
+        text << field.key << " = ";
+        if (field.floatValue != nullptr) {
+            text << *field.floatValue;
+        }
+        else if (field.intValue != nullptr) {
+            text << *field.intValue;
+        }
+        else {
+            text.precision(17);
+            text << *field.doubleValue;
+            text.precision(9);
+        }
+        text << '\n';
+    }
+    return text.str();
+}
+
+void GameParams::saveState(BinaryWriter& writer) const {
+    GameParams copy = *this;
+    for (const ParamField& field : getFields(copy)) {
+        if (field.floatValue != nullptr) {
+            writer.writeFloat(*field.floatValue);
+        }
+        else if (field.intValue != nullptr) {
+            writer.writeInt32(*field.intValue);
+        }
+        else {
+            writer.writeDouble(*field.doubleValue);
+        }
+    }
+}
+
+void GameParams::loadState(BinaryReader& reader) {
+    for (const ParamField& field : getFields(*this)) {
+        if (field.floatValue != nullptr) {
+            *field.floatValue = reader.readFloat();
+        }
+        else if (field.intValue != nullptr) {
+            *field.intValue = reader.readInt32();
+        }
+        else {
+            *field.doubleValue = reader.readDouble();
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef GAMEPARAMS_H
+#define GAMEPARAMS_H
+
+#include <string>
+#include "UtilityBrain.h"
+
+class BinaryWriter;
+class BinaryReader;
+
+// Every tunable of the rules and brains in one place. A parameter file sets
+// any of them with "key = value" lines, "#" starting a comment; keys are the
+// field names in snake_case, utility weights under blue.utility.* and
+// red.utility.*, see format(). Keys left out keep their defaults.
+struct GameParams {
+    // Enemy distance that counts as in reach for tagging decisions
+    float proximityThreshold;
+    // Distance from the enemy flag at which it can be grabbed
+    float flagReachDistance;
+    int teamZoneRadius;
+    // The red half starts this many columns right of the field's centre
+    int midlineOffset;
+    // Game seconds a tagger waits before tagging again
+    int tagCooldownSeconds;
+    // Game seconds an unseen opponent is remembered
+    double memoryRetentionSeconds;
+    float viewRange;
+    float viewAngle;
+    UtilityWeights blueUtility;
+    UtilityWeights redUtility;
+
+    GameParams();
+
+    // All or nothing: params only change when the whole text is valid.
+    // Unknown keys, keys set twice and out of range values are errors.
+    static bool parse(const std::string& text, GameParams& params, std::string& error);
+    static bool loadFile(const std::string& path, GameParams& params, std::string& error);
+    // Every key with its value, in a form parse reads back
+    std::string format() const;
+
+    void saveState(BinaryWriter& writer) const;
+    void loadState(BinaryReader& reader);
+};
+
+#endif
@@ -0,0 +1,224 @@
+#include "InfluenceMap.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define INFLUENCEMAP_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// One pass of the 1 4 6 4 1 kernel over count cells, taps step apart. The
+// weights are shifts and adds, so plain SSE2 covers it four cells at a time.
+void blurRun(const int* center, ptrdiff_t step, int* out, int count, bool accumulate) {
+    int i = 0;
+
+#ifdef INFLUENCEMAP_SSE2
+    for (; i + 4 <= count; i += 4) {
+        const int* tap = center + i;
+        __m128i outer = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(tap - 2 * step)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(tap + 2 * step)));
+        __m128i inner = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(tap - step)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(tap + step)));
+        __m128i middle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tap));
+        __m128i sum = _mm_add_epi32(outer, _mm_slli_epi32(inner, 2));
+        sum = _mm_add_epi32(sum, _mm_add_epi32(_mm_slli_epi32(middle, 2), _mm_slli_epi32(middle, 1)));
+        if (accumulate) {
+            sum = _mm_add_epi32(sum, _mm_loadu_si128(reinterpret_cast<const __m128i*>(out + i)));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), sum);
+    }
+#endif
+
+    for (; i < count; ++i) {
+        const int* tap = center + i;
+        int sum = tap[-2 * step] + tap[2 * step] + 4 * (tap[-step] + tap[step]) + 6 * tap[0];
+        out[i] = accumulate ? out[i] + sum : sum;
+    }
+}
+
+}
+
+InfluenceMap::InfluenceMap(int gameFieldWidth, int gameFieldHeight, int cellSize)
+    : gameFieldWidth(gameFieldWidth), gameFieldHeight(gameFieldHeight), cellSize(std::max(1, cellSize)), blueCount(0), load() {
+    columns = std::max(1, (gameFieldWidth + this->cellSize - 1) / this->cellSize);
+    rows = std::max(1, (gameFieldHeight + this->cellSize - 1) / this->cellSize);
+    stride = columns + 2 * kernelRadius;
+
+    size_t paddedSize = static_cast<size_t>(stride) * (rows + 2 * kernelRadius);
+    for (int team = 0; team < 2; ++team) {
+        delta[team].assign(paddedSize, 0);
+        influence[team].assign(paddedSize, 0);
+        dirtyBegin[team].assign(rows, columns);
+        dirtyEnd[team].assign(rows, 0);
+        route[team].assign(static_cast<size_t>(columns) * rows, 0.0f);
+    }
+    horizontal.assign(paddedSize, 0);
+    horizontalBegin.assign(rows, columns);
+    horizontalEnd.assign(rows, 0);
+}
+
+void InfluenceMap::resize(size_t blueCount, size_t redCount) {
+    this->blueCount = blueCount;
+    agentCells.assign(blueCount + redCount, -1);
+    for (int team = 0; team < 2; ++team) {
+        std::fill(delta[team].begin(), delta[team].end(), 0);
+        std::fill(influence[team].begin(), influence[team].end(), 0);
+        std::fill(dirtyBegin[team].begin(), dirtyBegin[team].end(), columns);
+        std::fill(dirtyEnd[team].begin(), dirtyEnd[team].end(), 0);
+    }
+}
+
+void InfluenceMap::setRoutes(std::pair<int, int> blueFlag, std::pair<int, int> blueZone, std::pair<int, int> redFlag, std::pair<int, int> redZone) {
+    // Blue carries the red flag home and red the blue one
+    buildRoute(0, redFlag, blueZone);
+    buildRoute(1, blueFlag, redZone);
+}
+
+void InfluenceMap::buildRoute(int team, std::pair<int, int> from, std::pair<int, int> to) {
+    // Distance from each map cell's centre to the straight run, in map cells
+    float fromX = static_cast<float>(from.first) / cellSize;
+    float fromY = static_cast<float>(from.second) / cellSize;
+    float runX = static_cast<float>(to.first) / cellSize - fromX;
+    float runY = static_cast<float>(to.second) / cellSize - fromY;
+    float runLengthSquared = runX * runX + runY * runY;
+
+    for (int row = 0; row < rows; ++row) {
+        for (int column = 0; column < columns; ++column) {
+            float offsetX = column + 0.5f - fromX;
+            float offsetY = row + 0.5f - fromY;
+            float along = runLengthSquared > 0.0f ? std::max(0.0f, std::min(1.0f, (offsetX * runX + offsetY * runY) / runLengthSquared)) : 0.0f;
+            float distance = std::hypot(offsetX - along * runX, offsetY - along * runY);
+            route[team][row * columns + column] = std::max(0.0f, 1.0f - distance / routeWidth);
+        }
+    }
+}
+
+int InfluenceMap::toCell(int x, int y) const {
+    int column = std::max(0, std::min(columns - 1, x / cellSize));
+    int row = std::max(0, std::min(rows - 1, y / cellSize));
+    return row * columns + column;
+}
+
+void InfluenceMap::place(size_t index, int x, int y, bool isActive) {
+    int cell = isActive ? toCell(x, y) : -1;
+    if (cell == agentCells[index]) {
+        return;
+    }
+
+    int team = index < blueCount ? 0 : 1;
+    if (agentCells[index] >= 0) {
+        stamp(team, agentCells[index], -1);
+    }
+    if (cell >= 0) {
+        stamp(team, cell, 1);
+    }
+    agentCells[index] = cell;
+    load.moves++;
+}
+
+void InfluenceMap::stamp(int team, int cell, int amount) {
+    int column = cell % columns;
+    int row = cell / columns;
+    delta[team][paddedIndex(column, row)] += amount;
+    dirtyBegin[team][row] = std::min(dirtyBegin[team][row], column);
+    dirtyEnd[team][row] = std::max(dirtyEnd[team][row], column + 1);
+}
+
+void InfluenceMap::propagate() {
+    propagateTeam(0);
+    propagateTeam(1);
+    load.updates++;
+}
+
+void InfluenceMap::propagateTeam(int team) {
+    // Rows first: each changed run and the kernel's reach either side. The
+    // deltas are used up as they are read.
+    bool changed = false;
+    for (int row = 0; row < rows; ++row) {
+        horizontalBegin[row] = columns;
+        horizontalEnd[row] = 0;
+        if (dirtyBegin[team][row] >= dirtyEnd[team][row]) {
+            continue;
+        }
+
+        int begin = std::max(0, dirtyBegin[team][row] - kernelRadius);
+        int end = std::min(columns, dirtyEnd[team][row] + kernelRadius);
+        blurRun(&delta[team][paddedIndex(begin, row)], 1, &horizontal[paddedIndex(begin, row)], end - begin, false);
+        std::fill(delta[team].begin() + paddedIndex(dirtyBegin[team][row], row), delta[team].begin() + paddedIndex(dirtyEnd[team][row], row), 0);
+        horizontalBegin[row] = begin;
+        horizontalEnd[row] = end;
+        dirtyBegin[team][row] = columns;
+        dirtyEnd[team][row] = 0;
+        load.blurredCells += end - begin;
+        changed = true;
+    }
+    if (!changed) {
+        return;
+    }
+
+    // Then columns, added onto the influence. A row gathers from the rows
+    // within the kernel radius, so it covers the union of their runs.
+    for (int row = 0; row < rows; ++row) {
+        int begin = columns;
+        int end = 0;
+        for (int source = std::max(0, row - kernelRadius); source <= std::min(rows - 1, row + kernelRadius); ++source) {
+            begin = std::min(begin, horizontalBegin[source]);
+            end = std::max(end, horizontalEnd[source]);
+        }
+        if (begin < end) {
+            blurRun(&horizontal[paddedIndex(begin, row)], stride, &influence[team][paddedIndex(begin, row)], end - begin, true);
+            load.blurredCells += end - begin;
+        }
+    }
+
+    // Rows outside every run are still zero, so only the runs need clearing
+    for (int row = 0; row < rows; ++row) {
+        if (horizontalBegin[row] < horizontalEnd[row]) {
+            std::fill(horizontal.begin() + paddedIndex(horizontalBegin[row], row), horizontal.begin() + paddedIndex(horizontalEnd[row], row), 0);
+        }
+    }
+}
+
+float InfluenceMap::sample(bool blueTeam, InfluenceLayer layer, int x, int y) const {
+    int cell = toCell(x, y);
+    int index = paddedIndex(cell % columns, cell / columns);
+    int team = blueTeam ? 0 : 1;
+    float own = static_cast<float>(influence[team][index]) / kernelWeight;
+    float enemy = static_cast<float>(influence[1 - team][index]) / kernelWeight;
+
+    switch (layer) {
+    case InfluenceLayer::Threat:
+        return enemy;
+    case InfluenceLayer::Control:
+        return own - enemy;
+    case InfluenceLayer::FlagRouteDanger:
+        return enemy * route[team][cell];
+    }
+    return 0.0f;
+}
+
+PathInfluence InfluenceMap::samplePath(bool blueTeam, InfluenceLayer layer, int fromX, int fromY, const std::vector<std::pair<int, int>>& waypoints) const {
+    PathInfluence result;
+    result.total = sample(blueTeam, layer, fromX, fromY);
+    result.peak = result.total;
+    result.samples = 1;
+
+    // About one sample per map cell crossed, so long straight runs cost no more than they cover
+    int startX = fromX;
+    int startY = fromY;
+    for (const auto& waypoint : waypoints) {
+        float runX = static_cast<float>(waypoint.first - startX);
+        float runY = static_cast<float>(waypoint.second - startY);
+        int steps = std::max(1, static_cast<int>(std::ceil(std::hypot(runX, runY) / cellSize)));
+        for (int step = 1; step <= steps; ++step) {
+            float along = static_cast<float>(step) / steps;
+            float value = sample(blueTeam, layer, startX + static_cast<int>(std::lround(runX * along)), startY + static_cast<int>(std::lround(runY * along)));
+            result.total += value;
+            result.peak = std::max(result.peak, value);
+            result.samples++;
+        }
+        startX = waypoint.first;
+        startY = waypoint.second;
+    }
+    return result;
+}
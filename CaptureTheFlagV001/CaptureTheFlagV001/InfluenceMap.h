@@ -0,0 +1,111 @@
+#ifndef INFLUENCEMAP_H
+#define INFLUENCEMAP_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+enum class InfluenceLayer {
+    Threat,         // opponents nearby
+    Control,        // teammates nearby minus opponents nearby
+    FlagRouteDanger // threat on the way from the enemy flag back to the team zone
+};
+
+// What keeping the maps up to date cost, to go with the influence phase timing
+struct InfluenceLoad {
+    long long updates;
+    long long moves;        // agents stamped into a new cell
+    long long blurredCells; // cells run through either blur pass
+    double totalMillis;     // placing every agent and propagating, as timed by the caller
+
+    double getMeanMillis() const { return updates > 0 ? totalMillis / updates : 0.0; }
+    double getMovesPerUpdate() const { return updates > 0 ? static_cast<double>(moves) / updates : 0.0; }
+    double getBlurredCellsPerUpdate() const { return updates > 0 ? static_cast<double>(blurredCells) / updates : 0.0; }
+};
+
+// Influence along a path: the sum of samples one map cell apart, and the worst one
+struct PathInfluence {
+    float total;
+    float peak;
+    int samples;
+};
+
+// Coarse per-team influence over the field. Each team's presence is a count
+// of active agents per map cell, and its influence is that presence blurred
+// by a separable 1 4 6 4 1 kernel. The blur is linear, so instead of
+// blurring everything again each update, only the cells agents left and
+// entered are blurred and added on. Counts and kernel are integers, so the
+// maps always equal a blur from scratch, whatever order agents moved in.
+//
+// Agents are indexed like the tick graph's agents, blue first. Blue and red
+// read the same two influence grids from opposite sides.
+class InfluenceMap {
+public:
+    InfluenceMap(int gameFieldWidth, int gameFieldHeight, int cellSize = defaultCellSize);
+
+    // Forgets every agent and clears the maps; the next update stamps everyone again
+    void resize(size_t blueCount, size_t redCount);
+
+    // Carrier routes, from each enemy flag to the team zone it is carried to
+    void setRoutes(std::pair<int, int> blueFlag, std::pair<int, int> blueZone, std::pair<int, int> redFlag, std::pair<int, int> redZone);
+
+    // Once per agent and tick, then propagate() once. Only agents that
+    // changed map cell, or became active or inactive, cost anything.
+    void place(size_t index, int x, int y, bool isActive);
+    void propagate();
+
+    // Field cell lookups; positions outside the field read the nearest edge
+    float sample(bool blueTeam, InfluenceLayer layer, int x, int y) const;
+    // Walks from (fromX, fromY) through each waypoint in turn
+    PathInfluence samplePath(bool blueTeam, InfluenceLayer layer, int fromX, int fromY, const std::vector<std::pair<int, int>>& waypoints) const;
+
+    const InfluenceLoad& getLoad() const { return load; }
+    void addUpdateMillis(double millis) { load.totalMillis += millis; }
+    void resetLoad() { load = InfluenceLoad(); }
+    int getCellSize() const { return cellSize; }
+    int getColumns() const { return columns; }
+    int getRows() const { return rows; }
+
+    static const int defaultCellSize = 16;
+    static const int kernelRadius = 2;
+    // Sum of the 2D kernel, what one agent adds to its own cell's neighbourhood
+    static const int kernelWeight = 256;
+    // Map cells either side of a carrier route that still count as on it
+    static constexpr float routeWidth = 3.0f;
+
+private:
+    void stamp(int team, int cell, int amount);
+    void propagateTeam(int team);
+    void buildRoute(int team, std::pair<int, int> from, std::pair<int, int> to);
+    int toCell(int x, int y) const;
+    int paddedIndex(int column, int row) const { return (row + kernelRadius) * stride + column + kernelRadius; }
+
+    int gameFieldWidth;
+    int gameFieldHeight;
+    int cellSize;
+    int columns;
+    int rows;
+    // Rows are padded by the kernel radius on every side, so the blur never checks bounds
+    int stride;
+
+    size_t blueCount;
+    // Map cell each agent is counted in, -1 while inactive or not yet placed
+    std::vector<int> agentCells;
+
+    // Per team: presence changes since the last propagate, the blurred
+    // influence, and the columns each row changed in
+    std::vector<int> delta[2];
+    std::vector<int> influence[2];
+    std::vector<int> dirtyBegin[2];
+    std::vector<int> dirtyEnd[2];
+    std::vector<int> horizontal;
+    std::vector<int> horizontalBegin;
+    std::vector<int> horizontalEnd;
+
+    // Per team weight of each map cell for its carrier route, 0 to 1
+    std::vector<float> route[2];
+
+    InfluenceLoad load;
+};
+
+#endif
@@ -0,0 +1,6 @@
+#include "Logging.h"
+
+Q_LOGGING_CATEGORY(agentLog, "ctf.agent")
+Q_LOGGING_CATEGORY(pathfinderLog, "ctf.pathfinder")
+Q_LOGGING_CATEGORY(renderLog, "ctf.render")
+Q_LOGGING_CATEGORY(simulationLog, "ctf.simulation")
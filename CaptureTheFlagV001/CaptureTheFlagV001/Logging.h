@@ -0,0 +1,14 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <QLoggingCategory>
+
+// Categories for per-agent and per-tick messages. qCDebug skips formatting
+// entirely when a category is off, which matters at tens of thousands of
+// agents: "ctf.*.debug=false" silences them for free.
+Q_DECLARE_LOGGING_CATEGORY(agentLog)
+Q_DECLARE_LOGGING_CATEGORY(pathfinderLog)
+Q_DECLARE_LOGGING_CATEGORY(renderLog)
+Q_DECLARE_LOGGING_CATEGORY(simulationLog)
+
+#endif
@@ -1,28 +1,330 @@
 #include "Memory.h"
+#include "BinaryStream.h"
+#include <algorithm>
+#include <functional>
 
-void Memory::updateOpponentInfo(int x, int y, bool hasFlag, int dirX, int dirY) {
-    opponentInfo[std::make_pair(x, y)] = { hasFlag, std::make_pair(dirX, dirY), std::chrono::system_clock::now() };
+Memory::Memory(int capacity)
+    : capacity(std::max(1, capacity)), indexMask(0), retention(defaultRetentionTicks), expiredThrough(-1), wheelMask(0), filterTick(0) {}
+
+void Memory::observeOpponent(int opponentId, int x, int y, bool hasFlag, long long tick) {
+    predictTracks(tick);
+
+    int track = findTrack(opponentId);
+    if (track < 0) {
+        track = addTrack(opponentId);
+        filters.start(track, static_cast<float>(x), static_cast<float>(y));
+    }
+    else {
+        filters.update(track, static_cast<float>(x), static_cast<float>(y));
+        unlinkTrack(track);
+    }
+
+    trackX[track] = x;
+    trackY[track] = y;
+    carryingFlag[track] = hasFlag ? 1 : 0;
+    lastSeenTick[track] = tick;
+    linkTrack(track);
+}
+
+void Memory::predictTracks(long long tick) {
+    if (tick > filterTick) {
+        filters.predict(tick - filterTick);
+        filterTick = tick;
+    }
+}
+
+std::pair<float, float> Memory::getTrackIntercept(int track, float fromX, float fromY, float cellsPerTick) const {
+    float ticks = filters.solveIntercept(track, fromX, fromY, cellsPerTick, static_cast<float>(retention));
+    return filters.predictPosition(track, ticks);
+}
+
+void Memory::setRetention(long long ticks) {
+    ticks = std::max(1LL, ticks);
+    if (ticks == retention) {
+        return;
+    }
+    retention = ticks;
+
+    // Every expiry tick moved, so the wheel is laid out again
+    if (!wheelHeads.empty()) {
+        buildWheel();
+    }
 }
 
-bool Memory::hasOpponentFlag(int x, int y) const {
-    auto it = opponentInfo.find(std::make_pair(x, y));
-    return it != opponentInfo.end() && std::get<0>(it->second);
+void Memory::expire(long long tick) {
+    if (tick <= expiredThrough) {
+        return;
+    }
+
+    // One bucket per tick that passed; a whole turn of the wheel covers any longer gap
+    long long first = std::max(expiredThrough + 1, tick - wheelMask);
+    expiredThrough = tick;
+    if (trackIds.empty()) {
+        return;
+    }
+    expiring.clear();
+    for (long long passed = first; passed <= tick; ++passed) {
+        for (int track = wheelHeads[passed & wheelMask]; track >= 0; track = wheelNext[track]) {
+            if (lastSeenTick[track] + retention < tick) {
+                expiring.push_back(track);
+            }
+        }
+    }
+
+    // Highest first: the last track, moved into each freed one, is never
+    // one still to go, and the outcome does not depend on bucket order
+    std::sort(expiring.begin(), expiring.end(), std::greater<int>());
+    for (int track : expiring) {
+        forgetTrack(track);
+    }
 }
 
-std::pair<int, int> Memory::getOpponentDirection(int x, int y) const {
-    auto it = opponentInfo.find(std::make_pair(x, y));
-    return it != opponentInfo.end() ? std::get<1>(it->second) : std::make_pair(0, 0);
+int Memory::findTrack(int opponentId) const {
+    int entry = findIndexEntry(opponentId);
+    return entry >= 0 ? trackIndex[entry] : -1;
 }
 
-double Memory::getTimeSinceLastSeen(int x, int y) const {
-    auto it = opponentInfo.find(std::make_pair(x, y));
-    return it != opponentInfo.end() ? std::chrono::duration<double>(std::chrono::system_clock::now() - std::get<2>(it->second)).count() : std::numeric_limits<double>::max();
+bool Memory::hasOpponentFlag(int opponentId) const {
+    int track = findTrack(opponentId);
+    return track >= 0 && carryingFlag[track] != 0;
 }
 
-std::pair<int, int> Memory::getLastKnownPosition(int x, int y) const {
-    return std::make_pair(x, y);
+bool Memory::isAnyOpponentCarryingFlag() const {
+    return std::any_of(carryingFlag.begin(), carryingFlag.end(), [](char carrying) { return carrying != 0; });
 }
 
-const std::unordered_map<std::pair<int, int>, std::tuple<bool, std::pair<int, int>, std::chrono::system_clock::time_point>, pair_hash>& Memory::getOpponentInfo() const {
-    return opponentInfo;
-}
\ No newline at end of file
+long long Memory::getTicksSinceLastSeen(int opponentId, long long currentTick) const {
+    int track = findTrack(opponentId);
+    return track >= 0 ? currentTick - lastSeenTick[track] : std::numeric_limits<long long>::max();
+}
+
+std::pair<int, int> Memory::getLastKnownPosition(int opponentId) const {
+    int track = findTrack(opponentId);
+    return track >= 0 ? getTrackPosition(track) : std::make_pair(-1, -1);
+}
+
+std::pair<float, float> Memory::predictPosition(int opponentId, long long ticksAhead) const {
+    int track = findTrack(opponentId);
+    return track >= 0 ? getTrackPrediction(track, ticksAhead) : std::make_pair(-1.0f, -1.0f);
+}
+
+void Memory::clear() {
+    trackIds.clear();
+    trackX.clear();
+    trackY.clear();
+    carryingFlag.clear();
+    lastSeenTick.clear();
+    filters.clear();
+    wheelNext.clear();
+    wheelPrevious.clear();
+    std::fill(trackIndex.begin(), trackIndex.end(), -1);
+    std::fill(wheelHeads.begin(), wheelHeads.end(), -1);
+    expiredThrough = -1;
+    filterTick = 0;
+}
+
+void Memory::copyTracksFrom(const Memory& other) {
+    // Emptying the buckets of this memory's own tracks empties its wheel
+    if (wheelHeads.size() == other.wheelHeads.size()) {
+        for (int track = 0; track < getTrackCount(); ++track) {
+            wheelHeads[getBucket(track)] = -1;
+        }
+    }
+    else {
+        wheelHeads.assign(other.wheelHeads.size(), -1);
+        wheelMask = other.wheelMask;
+    }
+
+    retention = other.retention;
+    expiredThrough = other.expiredThrough;
+    trackIds = other.trackIds;
+    trackX = other.trackX;
+    trackY = other.trackY;
+    carryingFlag = other.carryingFlag;
+    lastSeenTick = other.lastSeenTick;
+    trackIndex = other.trackIndex;
+    indexMask = other.indexMask;
+    filters = other.filters;
+    filterTick = other.filterTick;
+
+    // Bucket order never matters, so the tracks are linked afresh
+    wheelNext.resize(trackIds.size());
+    wheelPrevious.resize(trackIds.size());
+    for (int track = 0; track < getTrackCount(); ++track) {
+        linkTrack(track);
+    }
+}
+
+int Memory::findIndexEntry(int opponentId) const {
+    if (trackIndex.empty()) {
+        return -1;
+    }
+    for (int entry = getHome(opponentId); trackIndex[entry] >= 0; entry = (entry + 1) & indexMask) {
+        if (trackIds[trackIndex[entry]] == opponentId) {
+            return entry;
+        }
+    }
+    return -1;
+}
+
+int Memory::addTrack(int opponentId) {
+    // The index and the wheel are sized once, on the first sighting
+    if (trackIndex.empty()) {
+        int size = 1;
+        while (size < 2 * capacity) {
+            size *= 2;
+        }
+        trackIndex.assign(size, -1);
+        indexMask = size - 1;
+        buildWheel();
+    }
+
+    // A full table forgets whoever has gone unseen the longest, the lowest
+    // track on ties. Rare next to expiry, so a scan of the tracks will do.
+    if (getTrackCount() >= capacity) {
+        forgetTrack(static_cast<int>(std::min_element(lastSeenTick.begin(), lastSeenTick.end()) - lastSeenTick.begin()));
+    }
+
+    // The caller sets the sighting and links the track into the wheel
+    int track = getTrackCount();
+    trackIds.push_back(opponentId);
+    trackX.push_back(0);
+    trackY.push_back(0);
+    filters.add();
+    carryingFlag.push_back(0);
+    lastSeenTick.push_back(0);
+    wheelNext.push_back(-1);
+    wheelPrevious.push_back(-1);
+
+    int entry = getHome(opponentId);
+    while (trackIndex[entry] >= 0) {
+        entry = (entry + 1) & indexMask;
+    }
+    trackIndex[entry] = track;
+    return track;
+}
+
+void Memory::forgetTrack(int track) {
+    // Backward shift deletion: later entries of the probe run move into the
+    // hole whenever their home slot allows it, so no tombstones are needed
+    int hole = findIndexEntry(trackIds[track]);
+    for (int entry = (hole + 1) & indexMask; trackIndex[entry] >= 0; entry = (entry + 1) & indexMask) {
+        int home = getHome(trackIds[trackIndex[entry]]);
+        if (((entry - hole) & indexMask) <= ((entry - home) & indexMask)) {
+            trackIndex[hole] = trackIndex[entry];
+            hole = entry;
+        }
+    }
+    trackIndex[hole] = -1;
+    unlinkTrack(track);
+
+    // The last track fills the gap so tracks stay packed; its neighbours in
+    // the index and the wheel are pointed at its new place
+    int last = getTrackCount() - 1;
+    if (track != last) {
+        trackIds[track] = trackIds[last];
+        trackX[track] = trackX[last];
+        trackY[track] = trackY[last];
+        filters.moveTrack(last, track);
+        carryingFlag[track] = carryingFlag[last];
+        lastSeenTick[track] = lastSeenTick[last];
+        wheelNext[track] = wheelNext[last];
+        wheelPrevious[track] = wheelPrevious[last];
+        trackIndex[findIndexEntry(trackIds[track])] = track;
+
+        if (wheelPrevious[track] >= 0) {
+            wheelNext[wheelPrevious[track]] = track;
+        }
+        else {
+            wheelHeads[getBucket(track)] = track;
+        }
+        if (wheelNext[track] >= 0) {
+            wheelPrevious[wheelNext[track]] = track;
+        }
+    }
+    trackIds.pop_back();
+    trackX.pop_back();
+    trackY.pop_back();
+    filters.removeLast();
+    carryingFlag.pop_back();
+    lastSeenTick.pop_back();
+    wheelNext.pop_back();
+    wheelPrevious.pop_back();
+}
+
+void Memory::linkTrack(int track) {
+    int bucket = getBucket(track);
+    wheelPrevious[track] = -1;
+    wheelNext[track] = wheelHeads[bucket];
+    if (wheelHeads[bucket] >= 0) {
+        wheelPrevious[wheelHeads[bucket]] = track;
+    }
+    wheelHeads[bucket] = track;
+}
+
+void Memory::unlinkTrack(int track) {
+    if (wheelPrevious[track] >= 0) {
+        wheelNext[wheelPrevious[track]] = wheelNext[track];
+    }
+    else {
+        wheelHeads[getBucket(track)] = wheelNext[track];
+    }
+    if (wheelNext[track] >= 0) {
+        wheelPrevious[wheelNext[track]] = wheelPrevious[track];
+    }
+    wheelNext[track] = -1;
+    wheelPrevious[track] = -1;
+}
+
+void Memory::buildWheel() {
+    long long size = 1;
+    while (size <= retention + 1 && size < maxWheelSize) {
+        size *= 2;
+    }
+    wheelHeads.assign(static_cast<size_t>(size), -1);
+    wheelMask = size - 1;
+    for (int track = 0; track < getTrackCount(); ++track) {
+        linkTrack(track);
+    }
+}
+
+void Memory::saveState(BinaryWriter& writer) const {
+    writer.writeInt64(expiredThrough);
+    writer.writeInt64(filterTick);
+    writer.writeUInt32(static_cast<uint32_t>(getTrackCount()));
+    for (int track = 0; track < getTrackCount(); ++track) {
+        writer.writeInt32(trackIds[track]);
+        writer.writeInt32(trackX[track]);
+        writer.writeInt32(trackY[track]);
+        writer.writeBool(carryingFlag[track] != 0);
+        writer.writeInt64(lastSeenTick[track]);
+        filters.saveTrack(writer, track);
+    }
+}
+
+void Memory::loadState(BinaryReader& reader) {
+    clear();
+    long long savedExpiredThrough = reader.readInt64();
+    long long savedFilterTick = reader.readInt64();
+    uint32_t count = reader.readUInt32();
+    if (reader.hasFailed() || count > static_cast<uint32_t>(capacity)) {
+        return;
+    }
+
+    // Tracks come back in the same order; bucket order never matters
+    for (uint32_t i = 0; i < count; ++i) {
+        int opponentId = reader.readInt32();
+        if (reader.hasFailed() || findTrack(opponentId) >= 0) {
+            return;
+        }
+        int track = addTrack(opponentId);
+        trackX[track] = reader.readInt32();
+        trackY[track] = reader.readInt32();
+        carryingFlag[track] = reader.readBool() ? 1 : 0;
+        lastSeenTick[track] = reader.readInt64();
+        filters.loadTrack(reader, track);
+        linkTrack(track);
+    }
+    expiredThrough = savedExpiredThrough;
+    filterTick = savedFilterTick;
+}
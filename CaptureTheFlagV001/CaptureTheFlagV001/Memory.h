@@ -1,32 +1,127 @@
 #ifndef MEMORY_H
 #define MEMORY_H
 
-#include <unordered_map>
+#include <cstdint>
 #include <vector>
-#include <chrono>
 #include <limits>
-#include <tuple>
-
-struct pair_hash {
-    template <class T1, class T2>
-    std::size_t operator()(const std::pair<T1, T2>& p) const {
-        auto h1 = std::hash<T1>{}(p.first);
-        auto h2 = std::hash<T2>{}(p.second);
-        return h1 ^ h2;
-    }
-};
+#include <utility>
+#include "TrackFilters.h"
+
+class BinaryWriter;
+class BinaryReader;
 
+// Opponents an agent has seen, one track per opponent id. Tracks live in
+// flat arrays packed at the front, so walking them reads only what is there,
+// and a small open addressing index finds an id's track in O(1). The table
+// never holds more than its capacity: a new opponent beyond that replaces
+// the one unseen for longest. Storage is taken on the first sighting, so an
+// agent that never sees anyone costs nothing.
+//
+// Tracks are also forgotten once unseen for longer than the retention. Each
+// track waits in the timing wheel bucket of the tick it expires on, so
+// expire() only visits the buckets of the ticks that passed and everything
+// left in the table is fresh: queries never filter by age. Confidence falls
+// linearly from 1 when seen to 0 when the track expires.
+//
+// Every track also runs a constant velocity Kalman filter. All filters are
+// predicted together to the latest tick before sightings are folded in, so
+// positions and velocities are estimates for that tick, and pursuit can
+// aim where an opponent is going rather than where it was.
 class Memory {
 public:
-    void updateOpponentInfo(int x, int y, bool hasFlag, int dirX, int dirY);
-    bool hasOpponentFlag(int x, int y) const;
-    std::pair<int, int> getOpponentDirection(int x, int y) const;
-    double getTimeSinceLastSeen(int x, int y) const;
-    std::pair<int, int> getLastKnownPosition(int x, int y) const;
-    const std::unordered_map<std::pair<int, int>, std::tuple<bool, std::pair<int, int>, std::chrono::system_clock::time_point>, pair_hash>& getOpponentInfo() const;
+    static const int defaultCapacity = 32;
+    static const long long defaultRetentionTicks = 5;
+
+    explicit Memory(int capacity = defaultCapacity);
+
+    // Timestamps are simulation ticks, see SimClock. Sightings must come in tick order.
+    void observeOpponent(int opponentId, int x, int y, bool hasFlag, long long tick);
+
+    // Predicts every filter forward to tick in one batch
+    void predictTracks(long long tick);
+    long long getFilterTick() const { return filterTick; }
+
+    // Ticks a track survives without a sighting
+    void setRetention(long long ticks);
+    long long getRetention() const { return retention; }
+    // Forgets every track unseen for longer than the retention at tick
+    void expire(long long tick);
+
+    // Track of an opponent, or -1. Track indices run up to getTrackCount()
+    // and change when an opponent is forgotten.
+    int findTrack(int opponentId) const;
+    int getTrackCount() const { return static_cast<int>(trackIds.size()); }
+    int getCapacity() const { return capacity; }
+    int getTrackId(int track) const { return trackIds[track]; }
+    std::pair<int, int> getTrackPosition(int track) const { return std::make_pair(trackX[track], trackY[track]); }
+    // Filtered estimates at the filter tick, in cells and cells per tick
+    std::pair<float, float> getTrackEstimate(int track) const { return std::make_pair(filters.getX(track), filters.getY(track)); }
+    std::pair<float, float> getTrackVelocity(int track) const { return std::make_pair(filters.getVelocityX(track), filters.getVelocityY(track)); }
+    std::pair<float, float> getTrackPrediction(int track, long long ticksAhead) const { return filters.predictPosition(track, static_cast<float>(ticksAhead)); }
+    // Where a pursuer moving cellsPerTick meets the track, looking no further ahead than the retention
+    std::pair<float, float> getTrackIntercept(int track, float fromX, float fromY, float cellsPerTick) const;
+    bool isTrackCarryingFlag(int track) const { return carryingFlag[track] != 0; }
+    long long getTrackLastSeen(int track) const { return lastSeenTick[track]; }
+    float getTrackConfidence(int track, long long currentTick) const {
+        return 1.0f - static_cast<float>(currentTick - lastSeenTick[track]) / static_cast<float>(retention + 1);
+    }
+
+    bool hasOpponentFlag(int opponentId) const;
+    bool isAnyOpponentCarryingFlag() const;
+    long long getTicksSinceLastSeen(int opponentId, long long currentTick) const;
+    // (-1, -1) for an opponent never seen
+    std::pair<int, int> getLastKnownPosition(int opponentId) const;
+    // Estimated position ticksAhead after the filter tick, (-1, -1) for an opponent not tracked
+    std::pair<float, float> predictPosition(int opponentId, long long ticksAhead) const;
+
+    // Forgets every opponent but keeps the storage for the next match
+    void clear();
+
+    // Becomes a copy of other, which must share the capacity and retention.
+    // Costs the tracks of both rather than the wheel, see TeamBlackboard.
+    void copyTracksFrom(const Memory& other);
+
+    void saveState(BinaryWriter& writer) const;
+    void loadState(BinaryReader& reader);
 
 private:
-    std::unordered_map<std::pair<int, int>, std::tuple<bool, std::pair<int, int>, std::chrono::system_clock::time_point>, pair_hash> opponentInfo;
+    int getHome(int opponentId) const { return static_cast<int>((static_cast<uint32_t>(opponentId) * 2654435761u) & static_cast<uint32_t>(indexMask)); }
+    int findIndexEntry(int opponentId) const;
+    int addTrack(int opponentId);
+    void forgetTrack(int track);
+    int getBucket(int track) const { return static_cast<int>((lastSeenTick[track] + retention + 1) & wheelMask); }
+    void linkTrack(int track);
+    void unlinkTrack(int track);
+    void buildWheel();
+
+    int capacity;
+    std::vector<int> trackIds;
+    std::vector<int> trackX;
+    std::vector<int> trackY;
+    std::vector<char> carryingFlag;
+    std::vector<long long> lastSeenTick;
+
+    // Track per index entry or -1, with linear probing; at least twice the
+    // capacity so probes stay short
+    std::vector<int> trackIndex;
+    int indexMask;
+
+    // Timing wheel with one bucket per tick, more buckets than the retention
+    // so a bucket only ever holds tracks expiring on the same tick. Longer
+    // retentions share maxWheelSize buckets between turns of the wheel, and
+    // expire() passes over tracks whose turn has not come. Buckets are
+    // intrusive lists through the tracks.
+    static const long long maxWheelSize = 4096;
+    long long retention;
+    long long expiredThrough;
+    std::vector<int> wheelHeads;
+    std::vector<int> wheelNext;
+    std::vector<int> wheelPrevious;
+    long long wheelMask;
+    std::vector<int> expiring;
+
+    TrackFilters filters;
+    long long filterTick;
 };
 
 #endif
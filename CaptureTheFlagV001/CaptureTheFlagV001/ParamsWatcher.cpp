@@ -0,0 +1,74 @@
+#include "ParamsWatcher.h"
+#include "Logging.h"
+#include <QString>
+#include <algorithm>
+#include <chrono>
+
+ParamsWatcher::ParamsWatcher(const std::string& path, int pollMillis)
+    : path(path), pollMillis(std::max(1, pollMillis)), lastSize(0), stopping(false), hasUpdate(false), reloadCount(0), failedReloadCount(0) {
+    fileChanged();
+    thread = std::thread(&ParamsWatcher::run, this);
+}
+
+ParamsWatcher::~ParamsWatcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    thread.join();
+}
+
+bool ParamsWatcher::takeUpdate(GameParams& params) {
+    if (!hasUpdate.load(std::memory_order_acquire)) {
+        return false;
+    }
+    // The watcher only holds the lock to hand over parsed parameters; if it
+    // is doing so right now the update is taken next time
+    std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return false;
+    }
+    params = pending;
+    hasUpdate.store(false, std::memory_order_release);
+    return true;
+}
+
+bool ParamsWatcher::fileChanged() {
+    std::error_code error;
+    std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(path, error);
+    if (error) {
+        return false;
+    }
+    uintmax_t size = std::filesystem::file_size(path, error);
+    if (error || (writeTime == lastWriteTime && size == lastSize)) {
+        return false;
+    }
+    lastWriteTime = writeTime;
+    lastSize = size;
+    return true;
+}
+
+void ParamsWatcher::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!wake.wait_for(lock, std::chrono::milliseconds(pollMillis), [this]() { return stopping; })) {
+        // Reading and parsing happen unlocked
+        lock.unlock();
+        GameParams params;
+        std::string error;
+        bool changed = fileChanged();
+        bool loaded = changed && GameParams::loadFile(path, params, error);
+        lock.lock();
+
+        if (loaded) {
+            pending = params;
+            hasUpdate.store(true, std::memory_order_release);
+            reloadCount++;
+            qCDebug(simulationLog) << "Reloaded parameters from" << QString::fromStdString(path);
+        }
+        else if (changed) {
+            failedReloadCount++;
+            qCWarning(simulationLog) << "Kept the last parameters:" << QString::fromStdString(error);
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef PARAMSWATCHER_H
+#define PARAMSWATCHER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "GameParams.h"
+
+// Watches a parameter file from a thread of its own. Each time the file's
+// modification time or size changes it is read and parsed there, and a
+// valid result waits to be taken; an invalid one is logged and the last
+// good parameters stay. takeUpdate never waits on the watcher, so the tick
+// loop can ask every tick.
+class ParamsWatcher {
+public:
+    // Starts watching from the file as it is now; changes after that are reloaded
+    explicit ParamsWatcher(const std::string& path, int pollMillis = defaultPollMillis);
+    ~ParamsWatcher();
+
+    ParamsWatcher(const ParamsWatcher&) = delete;
+    ParamsWatcher& operator=(const ParamsWatcher&) = delete;
+
+    // True, once per reload, with the newest valid parameters
+    bool takeUpdate(GameParams& params);
+    const std::string& getPath() const { return path; }
+    int getReloadCount() const { return reloadCount; }
+    int getFailedReloadCount() const { return failedReloadCount; }
+
+    static const int defaultPollMillis = 250;
+
+private:
+    void run();
+    // Whether the file looks different from the last time it was read
+    bool fileChanged();
+
+    std::string path;
+    int pollMillis;
+    std::filesystem::file_time_type lastWriteTime;
+    uintmax_t lastSize;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping;
+    GameParams pending;
+    std::atomic<bool> hasUpdate;
+    std::atomic<int> reloadCount;
+    std::atomic<int> failedReloadCount;
+    std::thread thread;
+};
+
+#endif
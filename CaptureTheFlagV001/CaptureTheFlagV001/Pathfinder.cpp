@@ -1,6 +1,7 @@
 #include "Pathfinder.h"
 #include "GameField.h"
 #include "Agent.h"
+#include "Logging.h"
 #include <queue>
 #include <cmath>
 #include <algorithm>
@@ -14,7 +15,12 @@ Pathfinder::Pathfinder(int gameFieldWidth, int gameFieldHeight)
 }
 
 void Pathfinder::setDynamicObstacles(const std::vector<std::pair<int, int>>& obstacles) {
-    dynamicObstacles = obstacles;
+    dynamicObstacles.clear();
+    for (const auto& obstacle : obstacles) {
+        if (isValidPosition(obstacle.first, obstacle.second)) {
+            dynamicObstacles.insert(toIndex(obstacle.first, obstacle.second));
+        }
+    }
 }
 
 double Pathfinder::calculateHeuristic(int x1, int y1, int x2, int y2) {
@@ -24,57 +30,107 @@ double Pathfinder::calculateHeuristic(int x1, int y1, int x2, int y2) {
 }
 
 std::vector<std::pair<int, int>> Pathfinder::findPath(int startX, int startY, int goalX, int goalY) {
-    std::priority_queue<std::pair<double, std::pair<int, int>>,
-        std::vector<std::pair<double, std::pair<int, int>>>,
-        std::greater<std::pair<double, std::pair<int, int>>>> openSet;
+    // Expand the corners back into single steps
+    std::vector<std::pair<int, int>> path;
+    int x = startX;
+    int y = startY;
+    for (const auto& waypoint : findWaypoints(startX, startY, goalX, goalY)) {
+        while (x != waypoint.first || y != waypoint.second) {
+            if (x != waypoint.first) {
+                x += waypoint.first > x ? 1 : -1;
+            }
+            else {
+                y += waypoint.second > y ? 1 : -1;
+            }
+            path.emplace_back(x, y);
+        }
+    }
+    return path;
+}
 
-    std::unordered_map<std::pair<int, int>, double, pair_hash> gScore;
-    std::unordered_map<std::pair<int, int>, std::pair<int, int>, pair_hash> cameFrom;
+std::vector<std::pair<int, int>> Pathfinder::findWaypoints(int startX, int startY, int goalX, int goalY) {
+    if (!isValidPosition(goalX, goalY)) {
+        qCDebug(pathfinderLog) << "Pathfinder: Goal" << goalX << goalY << "is outside the field";
+        return std::vector<std::pair<int, int>>();
+    }
 
-    openSet.push({ 0.0, {startX, startY} });
-    gScore[{startX, startY}] = 0.0;
+    if (startX == goalX && startY == goalY) {
+        return std::vector<std::pair<int, int>>();
+    }
 
-    qDebug() << "Pathfinder: Starting pathfinding from" << startX << startY << "to" << goalX << goalY;
+    // On an open field every shortest path is as good as any other, so take
+    // the horizontal-then-vertical one without searching
+    if (dynamicObstacles.empty()) {
+        std::vector<std::pair<int, int>> waypoints;
+        if (startX != goalX) {
+            waypoints.emplace_back(goalX, startY);
+        }
+        if (startY != goalY) {
+            waypoints.emplace_back(goalX, goalY);
+        }
+        return waypoints;
+    }
 
-    while (!openSet.empty()) {
-        std::pair<int, int> current = openSet.top().second;
-        openSet.pop();
+    return searchWaypoints(startX, startY, goalX, goalY);
+}
 
-        if (current.first == goalX && current.second == goalY) {
-            qDebug() << "Pathfinder: Goal reached!";
+std::vector<std::pair<int, int>> Pathfinder::searchWaypoints(int startX, int startY, int goalX, int goalY) {
+    std::priority_queue<std::pair<double, int>, std::vector<std::pair<double, int>>, std::greater<std::pair<double, int>>> openSet;
 
-            std::vector<std::pair<int, int>> path;
+    // Cells are keyed by their flat index, which hashes without collisions
+    std::unordered_map<int, double> gScore;
+    std::unordered_map<int, int> cameFrom;
 
-            while (current != std::make_pair(startX, startY)) {
-                path.push_back(current);
-                current = cameFrom[current];
-            }
-            std::reverse(path.begin(), path.end());
+    int startIndex = toIndex(startX, startY);
+    int goalIndex = toIndex(goalX, goalY);
+    openSet.push({ 0.0, startIndex });
+    gScore[startIndex] = 0.0;
 
-            for (const auto& point : path) {
-                qDebug() << point.first << point.second;
-            }
+    qCDebug(pathfinderLog) << "Pathfinder: Starting pathfinding from" << startX << startY << "to" << goalX << goalY;
+
+    while (!openSet.empty()) {
+        int current = openSet.top().second;
+        openSet.pop();
 
-            return path;
+        if (current == goalIndex) {
+            qCDebug(pathfinderLog) << "Pathfinder: Goal reached!";
+
+            // Walk back from the goal and keep only the cells where the direction changes
+            std::vector<std::pair<int, int>> waypoints;
+            waypoints.emplace_back(goalX, goalY);
+            int lastStep = 0;
+            while (current != startIndex) {
+                int previous = cameFrom[current];
+                int step = current - previous;
+                if (lastStep != 0 && step != lastStep) {
+                    waypoints.emplace_back(current % gameFieldWidth, current / gameFieldWidth);
+                }
+                lastStep = step;
+                current = previous;
+            }
+            std::reverse(waypoints.begin(), waypoints.end());
+            return waypoints;
         }
 
-        for (const auto& neighbor : getNeighbors(current.first, current.second)) {
-            // Check if the neighbor position is within the game field boundaries
-            if (isValidPosition(neighbor.first, neighbor.second)) {
-                double tentativeGScore = gScore[current] + 1;
+        int currentX = current % gameFieldWidth;
+        int currentY = current / gameFieldWidth;
+        double currentScore = gScore[current];
+        for (const auto& neighbor : getNeighbors(currentX, currentY)) {
+            int neighborIndex = toIndex(neighbor.first, neighbor.second);
+            double tentativeGScore = currentScore + 1;
 
-                if (gScore.find(neighbor) == gScore.end() || tentativeGScore < gScore[neighbor]) {
-                    cameFrom[neighbor] = current;
-                    gScore[neighbor] = tentativeGScore;
-                    double fScore = tentativeGScore + calculateHeuristic(neighbor.first, neighbor.second, goalX, goalY);
+            auto scoreIt = gScore.find(neighborIndex);
+            if (scoreIt == gScore.end() || tentativeGScore < scoreIt->second) {
+                cameFrom[neighborIndex] = current;
+                gScore[neighborIndex] = tentativeGScore;
+                double fScore = tentativeGScore + calculateHeuristic(neighbor.first, neighbor.second, goalX, goalY);
 
-                    openSet.push({ fScore, neighbor });
-                }
+                openSet.push({ fScore, neighborIndex });
             }
         }
     }
 
-    qDebug() << "Pathfinder: No path found!";
+    qCDebug(pathfinderLog) << "Pathfinder: No path found!";
     return std::vector<std::pair<int, int>>();
 }
 
@@ -90,7 +146,7 @@ std::vector<std::pair<int, int>> Pathfinder::getNeighbors(int x, int y) {
         // Check if the neighbor position is within the game field boundaries
         if (isValidPosition(newX, newY)) {
             // Check if the neighbor position is not occupied by another AI agent
-            if (std::find(dynamicObstacles.begin(), dynamicObstacles.end(), std::make_pair(newX, newY)) == dynamicObstacles.end()) {
+            if (!isObstacle(newX, newY)) {
                 neighbors.push_back({ newX, newY });
             }
         }
@@ -99,22 +155,33 @@ std::vector<std::pair<int, int>> Pathfinder::getNeighbors(int x, int y) {
     return neighbors;
 }
 
-std::pair<int, int> Pathfinder::getRandomFreePosition() {
-    std::vector<std::pair<int, int>> freePositions;
-    for (int x = 0; x < gameFieldWidth; ++x) {
+std::pair<int, int> Pathfinder::getRandomFreePosition(RandomStream& random) {
+    // Sample instead of listing every free cell, which is far too many on large fields
+    if (static_cast<long long>(dynamicObstacles.size()) < static_cast<long long>(gameFieldWidth) * gameFieldHeight) {
+        for (int attempt = 0; attempt < 64; ++attempt) {
+            int x = random.bounded(0, gameFieldWidth);
+            int y = random.bounded(0, gameFieldHeight);
+            if (!isObstacle(x, y)) {
+                return { x, y };
+            }
+        }
+
+        // Nearly full field: fall back to a scan in row order
         for (int y = 0; y < gameFieldHeight; ++y) {
-            if (std::find(dynamicObstacles.begin(), dynamicObstacles.end(), std::make_pair(x, y)) == dynamicObstacles.end()) {
-                freePositions.push_back({ x, y });
+            for (int x = 0; x < gameFieldWidth; ++x) {
+                if (!isObstacle(x, y)) {
+                    return { x, y };
+                }
             }
         }
     }
-    if (!freePositions.empty()) {
-        int randomIndex = std::rand() % freePositions.size();
-        return freePositions[randomIndex];
-    }
     return { -1, -1 };
 }
 
 bool Pathfinder::isValidPosition(int x, int y) {
     return x >= 0 && x < gameFieldWidth && y >= 0 && y < gameFieldHeight;
-}
\ No newline at end of file
+}
+
+bool Pathfinder::isObstacle(int x, int y) const {
+    return dynamicObstacles.find(toIndex(x, y)) != dynamicObstacles.end();
+}
@@ -4,23 +4,32 @@
 #include <vector>
 #include <utility>
 #include <unordered_map>
+#include <unordered_set>
 #include "Memory.h"
+#include "RandomStream.h"
 
 class Pathfinder {
 public:
     Pathfinder(int gameFieldWidth, int gameFieldHeight);
     void setDynamicObstacles(const std::vector<std::pair<int, int>>& obstacles);
     std::vector<std::pair<int, int>> findPath(int startX, int startY, int goalX, int goalY);
-    std::pair<int, int> getRandomFreePosition();
+
+    // Corners of a 4-connected path, ending with the goal. A path of any
+    // length costs a few entries, which keeps per-agent memory flat at scale.
+    std::vector<std::pair<int, int>> findWaypoints(int startX, int startY, int goalX, int goalY);
+    std::pair<int, int> getRandomFreePosition(RandomStream& random);
 
 private:
     int gameFieldWidth;
     int gameFieldHeight;
-    std::vector<std::pair<int, int>> dynamicObstacles;
+    std::unordered_set<int> dynamicObstacles;
 
     double calculateHeuristic(int x1, int y1, int x2, int y2);
     std::vector<std::pair<int, int>> getNeighbors(int x, int y);
+    std::vector<std::pair<int, int>> searchWaypoints(int startX, int startY, int goalX, int goalY);
     bool isValidPosition(int x, int y);
+    bool isObstacle(int x, int y) const;
+    int toIndex(int x, int y) const { return y * gameFieldWidth + x; }
 };
 
-#endif 
\ No newline at end of file
+#endif
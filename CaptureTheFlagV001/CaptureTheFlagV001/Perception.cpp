@@ -0,0 +1,135 @@
+#include "Perception.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PERCEPTION_SSE2
+#include <emmintrin.h>
+#endif
+
+Perception::Perception(int gameFieldWidth, int gameFieldHeight)
+    : gameFieldWidth(gameFieldWidth), gameFieldHeight(gameFieldHeight), obstacleCount(0) {
+    occupancy.assign((static_cast<size_t>(gameFieldWidth) * gameFieldHeight + 63) / 64, 0);
+}
+
+void Perception::setObstacles(const std::vector<std::pair<int, int>>& obstacles) {
+    std::fill(occupancy.begin(), occupancy.end(), 0);
+    obstacleCount = 0;
+    for (const auto& obstacle : obstacles) {
+        if (obstacle.first < 0 || obstacle.first >= gameFieldWidth || obstacle.second < 0 || obstacle.second >= gameFieldHeight || isOccupied(obstacle.first, obstacle.second)) {
+            continue;
+        }
+        size_t cell = static_cast<size_t>(obstacle.second) * gameFieldWidth + obstacle.first;
+        occupancy[cell >> 6] |= uint64_t(1) << (cell & 63);
+        obstacleCount++;
+    }
+}
+
+bool Perception::hasLineOfSight(int fromX, int fromY, int toX, int toY) const {
+    // An open field, or a target on the viewer's own cell, has nothing to walk
+    if (obstacleCount == 0 || (fromX == toX && fromY == toY)) {
+        return true;
+    }
+
+    int dx = std::abs(toX - fromX);
+    int dy = -std::abs(toY - fromY);
+    int stepX = fromX < toX ? 1 : -1;
+    int stepY = fromY < toY ? 1 : -1;
+    int error = dx + dy;
+    int x = fromX;
+    int y = fromY;
+    while (true) {
+        int doubled = 2 * error;
+        if (doubled >= dy) {
+            error += dy;
+            x += stepX;
+        }
+        if (doubled <= dx) {
+            error += dx;
+            y += stepY;
+        }
+        if (x == toX && y == toY) {
+            return true;
+        }
+        if (isOccupied(x, y)) {
+            return false;
+        }
+    }
+}
+
+void Perception::perceive(const Viewer& viewer, const SpatialGrid& targets, size_t maxVisible, PerceptionScratch& scratch) const {
+    scratch.candidates.clear();
+    scratch.inView.clear();
+    scratch.visible.clear();
+    int radius = static_cast<int>(std::ceil(viewer.range));
+    targets.gatherCandidates(viewer.x, viewer.y, radius, scratch.candidates);
+
+    // Offsets are small whole numbers, exact as floats, so both paths agree
+    const std::vector<std::pair<int, int>>& positions = targets.getPositions();
+    size_t count = scratch.candidates.size();
+    scratch.offsetX.resize(count);
+    scratch.offsetY.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const std::pair<int, int>& position = positions[scratch.candidates[i]];
+        scratch.offsetX[i] = static_cast<float>(position.first - viewer.x);
+        scratch.offsetY[i] = static_cast<float>(position.second - viewer.y);
+    }
+
+    // In range, and either close enough to notice or inside the cone
+    const float rangeSquared = viewer.range * viewer.range;
+    const float awarenessSquared = viewer.awarenessRadius * viewer.awarenessRadius;
+    auto keep = [&](size_t i) {
+        const std::pair<int, int>& position = positions[scratch.candidates[i]];
+        long long dx = position.first - viewer.x;
+        long long dy = position.second - viewer.y;
+        scratch.inView.emplace_back(dx * dx + dy * dy, scratch.candidates[i]);
+    };
+    size_t i = 0;
+
+#ifdef PERCEPTION_SSE2
+    const __m128 rangeLanes = _mm_set1_ps(rangeSquared);
+    const __m128 awarenessLanes = _mm_set1_ps(awarenessSquared);
+    const __m128 facingXLanes = _mm_set1_ps(viewer.facingX);
+    const __m128 facingYLanes = _mm_set1_ps(viewer.facingY);
+    const __m128 cosineLanes = _mm_set1_ps(viewer.halfAngleCosine);
+    for (; i + 4 <= count; i += 4) {
+        __m128 dx = _mm_loadu_ps(&scratch.offsetX[i]);
+        __m128 dy = _mm_loadu_ps(&scratch.offsetY[i]);
+        __m128 distanceSquared = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        __m128 along = _mm_add_ps(_mm_mul_ps(dx, facingXLanes), _mm_mul_ps(dy, facingYLanes));
+        __m128 inCone = _mm_cmpge_ps(along, _mm_mul_ps(cosineLanes, _mm_sqrt_ps(distanceSquared)));
+        __m128 noticed = _mm_or_ps(inCone, _mm_cmple_ps(distanceSquared, awarenessLanes));
+        int mask = _mm_movemask_ps(_mm_and_ps(noticed, _mm_cmple_ps(distanceSquared, rangeLanes)));
+        for (int lane = 0; mask != 0; ++lane, mask >>= 1) {
+            if (mask & 1) {
+                keep(i + lane);
+            }
+        }
+    }
+#endif
+
+    for (; i < count; ++i) {
+        float dx = scratch.offsetX[i];
+        float dy = scratch.offsetY[i];
+        float distanceSquared = dx * dx + dy * dy;
+        float along = dx * viewer.facingX + dy * viewer.facingY;
+        bool noticed = along >= viewer.halfAngleCosine * std::sqrt(distanceSquared) || distanceSquared <= awarenessSquared;
+        if (noticed && distanceSquared <= rangeSquared) {
+            keep(i);
+        }
+    }
+
+    // Nearest first, then by index so equal distances always come out the
+    // same; sight lines are only walked until enough are visible
+    std::sort(scratch.inView.begin(), scratch.inView.end());
+    for (const auto& target : scratch.inView) {
+        if (scratch.visible.size() >= maxVisible) {
+            break;
+        }
+        const std::pair<int, int>& position = positions[target.second];
+        if (hasLineOfSight(viewer.x, viewer.y, position.first, position.second)) {
+            scratch.visible.push_back(target.second);
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef PERCEPTION_H
+#define PERCEPTION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "SpatialGrid.h"
+
+// Where one agent looks from this tick. Facing is a unit vector; anyone
+// within awarenessRadius is noticed whatever the facing.
+struct Viewer {
+    int x;
+    int y;
+    float facingX;
+    float facingY;
+    float range;
+    float halfAngleCosine;
+    float awarenessRadius;
+};
+
+// Working storage for one batch of viewers, so batches perceive in parallel
+struct PerceptionScratch {
+    std::vector<int> candidates;
+    std::vector<float> offsetX;
+    std::vector<float> offsetY;
+    // Squared distance and target index of everyone in view, nearest first after perceive
+    std::vector<std::pair<long long, int>> inView;
+    std::vector<int> visible;
+};
+
+// Field of view and line of sight. A viewer's candidates come from the
+// targets' spatial grid, the range and cone tests run over them as flat
+// arrays four at a time with SSE2, and line of sight is a Bresenham walk
+// over a one bit per cell occupancy bitmap, only for those in view.
+class Perception {
+public:
+    Perception(int gameFieldWidth, int gameFieldHeight);
+
+    // Cells that block sight, the same obstacles the pathfinder avoids
+    void setObstacles(const std::vector<std::pair<int, int>>& obstacles);
+    bool isOccupied(int x, int y) const {
+        size_t cell = static_cast<size_t>(y) * gameFieldWidth + x;
+        return (occupancy[cell >> 6] >> (cell & 63)) & 1;
+    }
+    // True when no occupied cell lies strictly between the two ends
+    bool hasLineOfSight(int fromX, int fromY, int toX, int toY) const;
+
+    // Fills scratch.visible with the indices into targets.getPositions() of
+    // everyone the viewer sees, nearest first, at most maxVisible of them
+    void perceive(const Viewer& viewer, const SpatialGrid& targets, size_t maxVisible, PerceptionScratch& scratch) const;
+
+private:
+    int gameFieldWidth;
+    int gameFieldHeight;
+    std::vector<uint64_t> occupancy;
+    size_t obstacleCount;
+};
+
+#endif
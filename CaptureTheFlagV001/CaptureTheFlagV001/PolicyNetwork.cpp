@@ -0,0 +1,634 @@
+#include "PolicyNetwork.h"
+#include "BinaryStream.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#if defined(__AVX2__)
+#define POLICYNETWORK_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define POLICYNETWORK_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+    const int panelWidth = PolicyNetwork::panelWidth;
+
+    int roundUpToPanel(int count) {
+        return (count + panelWidth - 1) / panelWidth * panelWidth;
+    }
+
+    bool checkSizes(const std::vector<int>& sizes, std::string& error) {
+        if (sizes.size() < 2 || sizes.size() > static_cast<size_t>(PolicyNetwork::maxLayers) + 1) {
+            error = "A policy network needs between 1 and " + std::to_string(PolicyNetwork::maxLayers) + " layers";
+            return false;
+        }
+        if (sizes.front() != PolicyNetwork::featureCount || sizes.back() != PolicyNetwork::actionCount) {
+            error = "A policy network takes " + std::to_string(PolicyNetwork::featureCount) + " features and gives " + std::to_string(PolicyNetwork::actionCount) + " logits";
+            return false;
+        }
+        for (int size : sizes) {
+            if (size < 1 || size > PolicyNetwork::maxWidth) {
+                error = "Layer sizes must be between 1 and " + std::to_string(PolicyNetwork::maxWidth) + ", got " + std::to_string(size);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Four rows of a layer's output from its packed weights, a panel at a
+    // time. Each output is summed from zero in input order and only then
+    // gets its bias.
+    void multiplyFourRows(const float* packed, const float* biases, int paddedInputs, int paddedOutputs, const float* input, int inputStride, bool relu, float* output) {
+        const float* row0 = input;
+        const float* row1 = input + inputStride;
+        const float* row2 = input + 2 * inputStride;
+        const float* row3 = input + 3 * inputStride;
+        for (int panel = 0; panel < paddedOutputs; panel += panelWidth) {
+            const float* weights = packed + static_cast<size_t>(panel) * paddedInputs;
+#if defined(POLICYNETWORK_AVX2)
+            __m256 sum0 = _mm256_setzero_ps();
+            __m256 sum1 = _mm256_setzero_ps();
+            __m256 sum2 = _mm256_setzero_ps();
+            __m256 sum3 = _mm256_setzero_ps();
+            for (int k = 0; k < paddedInputs; ++k) {
+                __m256 weight = _mm256_loadu_ps(weights + k * panelWidth);
+                sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_set1_ps(row0[k]), weight));
+                sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_set1_ps(row1[k]), weight));
+                sum2 = _mm256_add_ps(sum2, _mm256_mul_ps(_mm256_set1_ps(row2[k]), weight));
+                sum3 = _mm256_add_ps(sum3, _mm256_mul_ps(_mm256_set1_ps(row3[k]), weight));
+            }
+            __m256 bias = _mm256_loadu_ps(biases + panel);
+            auto store = [&](__m256 sum, int row) {
+                __m256 value = _mm256_add_ps(sum, bias);
+                if (relu) {
+                    value = _mm256_max_ps(value, _mm256_setzero_ps());
+                }
+                _mm256_storeu_ps(output + row * paddedOutputs + panel, value);
+            };
+            store(sum0, 0);
+            store(sum1, 1);
+            store(sum2, 2);
+            store(sum3, 3);
+#elif defined(POLICYNETWORK_SSE2)
+            __m128 low0 = _mm_setzero_ps();
+            __m128 low1 = _mm_setzero_ps();
+            __m128 low2 = _mm_setzero_ps();
+            __m128 low3 = _mm_setzero_ps();
+            __m128 high0 = _mm_setzero_ps();
+            __m128 high1 = _mm_setzero_ps();
+            __m128 high2 = _mm_setzero_ps();
+            __m128 high3 = _mm_setzero_ps();
+            for (int k = 0; k < paddedInputs; ++k) {
+                __m128 lowWeight = _mm_loadu_ps(weights + k * panelWidth);
+                __m128 highWeight = _mm_loadu_ps(weights + k * panelWidth + 4);
+                __m128 value = _mm_set1_ps(row0[k]);
+                low0 = _mm_add_ps(low0, _mm_mul_ps(value, lowWeight));
+                high0 = _mm_add_ps(high0, _mm_mul_ps(value, highWeight));
+                value = _mm_set1_ps(row1[k]);
+                low1 = _mm_add_ps(low1, _mm_mul_ps(value, lowWeight));
+                high1 = _mm_add_ps(high1, _mm_mul_ps(value, highWeight));
+                value = _mm_set1_ps(row2[k]);
+                low2 = _mm_add_ps(low2, _mm_mul_ps(value, lowWeight));
+                high2 = _mm_add_ps(high2, _mm_mul_ps(value, highWeight));
+                value = _mm_set1_ps(row3[k]);
+                low3 = _mm_add_ps(low3, _mm_mul_ps(value, lowWeight));
+                high3 = _mm_add_ps(high3, _mm_mul_ps(value, highWeight));
+            }
+            __m128 lowBias = _mm_loadu_ps(biases + panel);
+            __m128 highBias = _mm_loadu_ps(biases + panel + 4);
+            auto store = [&](__m128 low, __m128 high, int row) {
+                low = _mm_add_ps(low, lowBias);
+                high = _mm_add_ps(high, highBias);
+                if (relu) {
+                    low = _mm_max_ps(low, _mm_setzero_ps());
+                    high = _mm_max_ps(high, _mm_setzero_ps());
+                }
+                _mm_storeu_ps(output + row * paddedOutputs + panel, low);
+                _mm_storeu_ps(output + row * paddedOutputs + panel + 4, high);
+            };
+            store(low0, high0, 0);
+            store(low1, high1, 1);
+            store(low2, high2, 2);
+            store(low3, high3, 3);
+#else
+            const float* rows[4] = { row0, row1, row2, row3 };
+            float sums[4][panelWidth] = {};
+            for (int k = 0; k < paddedInputs; ++k) {
+                for (int row = 0; row < 4; ++row) {
+                    for (int column = 0; column < panelWidth; ++column) {
+                        sums[row][column] += rows[row][k] * weights[k * panelWidth + column];
+                    }
+                }
+            }
+            for (int row = 0; row < 4; ++row) {
+                for (int column = 0; column < panelWidth; ++column) {
+                    float value = sums[row][column] + biases[panel + column];
+                    output[row * paddedOutputs + panel + column] = relu ? std::max(value, 0.0f) : value;
+                }
+            }
+#endif
+        }
+    }
+
+    int32_t loadPair(const int16_t* row, int pair) {
+        int32_t both;
+        std::memcpy(&both, row + pair * 2, sizeof(both));
+        return both;
+    }
+
+    // The same with rounded inputs and weights, summed exactly in 32 bits
+    // two inputs at a time, then scaled back by the row's and the output's
+    // scale before the bias
+    void multiplyQuantizedFourRows(const int16_t* packed, const float* outputScales, const float* biases, int paddedInputs, int paddedOutputs,
+        const int16_t* input, const float* rowScales, bool relu, float* output) {
+        const int16_t* row0 = input;
+        const int16_t* row1 = input + paddedInputs;
+        const int16_t* row2 = input + 2 * paddedInputs;
+        const int16_t* row3 = input + 3 * paddedInputs;
+        int pairs = paddedInputs / 2;
+        for (int panel = 0; panel < paddedOutputs; panel += panelWidth) {
+            const int16_t* weights = packed + static_cast<size_t>(panel) * paddedInputs;
+#if defined(POLICYNETWORK_AVX2)
+            __m256i sum0 = _mm256_setzero_si256();
+            __m256i sum1 = _mm256_setzero_si256();
+            __m256i sum2 = _mm256_setzero_si256();
+            __m256i sum3 = _mm256_setzero_si256();
+            for (int pair = 0; pair < pairs; ++pair) {
+                __m256i weight = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + pair * panelWidth * 2));
+                sum0 = _mm256_add_epi32(sum0, _mm256_madd_epi16(_mm256_set1_epi32(loadPair(row0, pair)), weight));
+                sum1 = _mm256_add_epi32(sum1, _mm256_madd_epi16(_mm256_set1_epi32(loadPair(row1, pair)), weight));
+                sum2 = _mm256_add_epi32(sum2, _mm256_madd_epi16(_mm256_set1_epi32(loadPair(row2, pair)), weight));
+                sum3 = _mm256_add_epi32(sum3, _mm256_madd_epi16(_mm256_set1_epi32(loadPair(row3, pair)), weight));
+            }
+            __m256 scales = _mm256_loadu_ps(outputScales + panel);
+            __m256 bias = _mm256_loadu_ps(biases + panel);
+            auto store = [&](__m256i sum, int row) {
+                __m256 value = _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(sum), _mm256_mul_ps(_mm256_set1_ps(rowScales[row]), scales)), bias);
+                if (relu) {
+                    value = _mm256_max_ps(value, _mm256_setzero_ps());
+                }
+                _mm256_storeu_ps(output + row * paddedOutputs + panel, value);
+            };
+            store(sum0, 0);
+            store(sum1, 1);
+            store(sum2, 2);
+            store(sum3, 3);
+#elif defined(POLICYNETWORK_SSE2)
+            __m128i low0 = _mm_setzero_si128();
+            __m128i low1 = _mm_setzero_si128();
+            __m128i low2 = _mm_setzero_si128();
+            __m128i low3 = _mm_setzero_si128();
+            __m128i high0 = _mm_setzero_si128();
+            __m128i high1 = _mm_setzero_si128();
+            __m128i high2 = _mm_setzero_si128();
+            __m128i high3 = _mm_setzero_si128();
+            for (int pair = 0; pair < pairs; ++pair) {
+                __m128i lowWeight = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + pair * panelWidth * 2));
+                __m128i highWeight = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + pair * panelWidth * 2 + 8));
+                __m128i value = _mm_set1_epi32(loadPair(row0, pair));
+                low0 = _mm_add_epi32(low0, _mm_madd_epi16(value, lowWeight));
+                high0 = _mm_add_epi32(high0, _mm_madd_epi16(value, highWeight));
+                value = _mm_set1_epi32(loadPair(row1, pair));
+                low1 = _mm_add_epi32(low1, _mm_madd_epi16(value, lowWeight));
+                high1 = _mm_add_epi32(high1, _mm_madd_epi16(value, highWeight));
+                value = _mm_set1_epi32(loadPair(row2, pair));
+                low2 = _mm_add_epi32(low2, _mm_madd_epi16(value, lowWeight));
+                high2 = _mm_add_epi32(high2, _mm_madd_epi16(value, highWeight));
+                value = _mm_set1_epi32(loadPair(row3, pair));
+                low3 = _mm_add_epi32(low3, _mm_madd_epi16(value, lowWeight));
+                high3 = _mm_add_epi32(high3, _mm_madd_epi16(value, highWeight));
+            }
+            __m128 lowScales = _mm_loadu_ps(outputScales + panel);
+            __m128 highScales = _mm_loadu_ps(outputScales + panel + 4);
+            __m128 lowBias = _mm_loadu_ps(biases + panel);
+            __m128 highBias = _mm_loadu_ps(biases + panel + 4);
+            auto store = [&](__m128i low, __m128i high, int row) {
+                __m128 rowScale = _mm_set1_ps(rowScales[row]);
+                __m128 lowValue = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(low), _mm_mul_ps(rowScale, lowScales)), lowBias);
+                __m128 highValue = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(high), _mm_mul_ps(rowScale, highScales)), highBias);
+                if (relu) {
+                    lowValue = _mm_max_ps(lowValue, _mm_setzero_ps());
+                    highValue = _mm_max_ps(highValue, _mm_setzero_ps());
+                }
+                _mm_storeu_ps(output + row * paddedOutputs + panel, lowValue);
+                _mm_storeu_ps(output + row * paddedOutputs + panel + 4, highValue);
+            };
+            store(low0, high0, 0);
+            store(low1, high1, 1);
+            store(low2, high2, 2);
+            store(low3, high3, 3);
+#else
+            const int16_t* rows[4] = { row0, row1, row2, row3 };
+            int32_t sums[4][panelWidth] = {};
+            for (int pair = 0; pair < pairs; ++pair) {
+                for (int row = 0; row < 4; ++row) {
+                    int32_t first = rows[row][pair * 2];
+                    int32_t second = rows[row][pair * 2 + 1];
+                    for (int column = 0; column < panelWidth; ++column) {
+                        const int16_t* weight = weights + (pair * panelWidth + column) * 2;
+                        sums[row][column] += first * weight[0] + second * weight[1];
+                    }
+                }
+            }
+            for (int row = 0; row < 4; ++row) {
+                for (int column = 0; column < panelWidth; ++column) {
+                    float value = static_cast<float>(sums[row][column]) * (rowScales[row] * outputScales[panel + column]) + biases[panel + column];
+                    output[row * paddedOutputs + panel + column] = relu ? std::max(value, 0.0f) : value;
+                }
+            }
+#endif
+        }
+    }
+
+    // Each row scaled so its largest magnitude becomes 127, rounding half away from zero
+    void quantizeRows(const float* input, int inputStride, size_t rows, int width, int16_t* quantized, float* rowScales) {
+        for (size_t row = 0; row < rows; ++row) {
+            const float* values = input + row * inputStride;
+            float largest = 0.0f;
+            for (int k = 0; k < width; ++k) {
+                largest = std::max(largest, std::fabs(values[k]));
+            }
+            float inverse = largest > 0.0f ? 127.0f / largest : 0.0f;
+            for (int k = 0; k < width; ++k) {
+                float scaled = values[k] * inverse;
+                quantized[row * width + k] = static_cast<int16_t>(scaled + (scaled < 0.0f ? -0.5f : 0.5f));
+            }
+            rowScales[row] = largest / 127.0f;
+        }
+    }
+}
+
+PolicyNetwork::PolicyNetwork() : quantized(false) {}
+
+void PolicyNetwork::getFeatures(const DecisionInputs& inputs, int team, float proximityThreshold, float* features) {
+    features[0] = inputs.hasFlag ? 1.0f : 0.0f;
+    features[1] = inputs.opponentHasFlag ? 1.0f : 0.0f;
+    features[2] = inputs.isTagged ? 1.0f : 0.0f;
+    features[3] = inputs.inHomeZone ? 1.0f : 0.0f;
+    features[4] = inputs.distanceToNearestEnemy <= proximityThreshold ? 1.0f : 0.0f;
+    features[5] = static_cast<float>(team);
+    // Nobody in view comes in as the largest float
+    features[6] = std::min(inputs.distanceToFlag / 100.0f, maxDistance);
+    features[7] = std::min(inputs.distanceToNearestEnemy / 100.0f, maxDistance);
+}
+
+uint8_t PolicyNetwork::getActionMask(const DecisionInputs& inputs, float proximityThreshold) {
+    bool free = !inputs.isTagged && !inputs.hasFlag;
+    bool reach = inputs.distanceToNearestEnemy <= proximityThreshold;
+    uint8_t mask = 0;
+    mask |= inputs.hasFlag && inputs.inHomeZone && !inputs.isTagged ? 1 << static_cast<int>(BrainDecision::CaptureFlag) : 0;
+    mask |= free && inputs.opponentHasFlag && reach ? 1 << static_cast<int>(BrainDecision::TagEnemy) : 0;
+    mask |= free ? 1 << static_cast<int>(BrainDecision::RecoverFlag) : 0;
+    mask |= inputs.isTagged || (inputs.hasFlag && !inputs.inHomeZone) ? 1 << static_cast<int>(BrainDecision::ReturnToHomeZone) : 0;
+    mask |= free ? 1 << static_cast<int>(BrainDecision::GrabFlag) : 0;
+    mask |= !inputs.isTagged ? 1 << static_cast<int>(BrainDecision::Explore) : 0;
+    return mask;
+}
+
+bool PolicyNetwork::setLayers(const std::vector<int>& newSizes, const std::vector<std::vector<float>>& weights, const std::vector<std::vector<float>>& biases, std::string& error) {
+    if (!checkSizes(newSizes, error)) {
+        return false;
+    }
+    size_t layerCount = newSizes.size() - 1;
+    if (weights.size() != layerCount || biases.size() != layerCount) {
+        error = "Expected weights and biases for " + std::to_string(layerCount) + " layers";
+        return false;
+    }
+
+    std::vector<Layer> newLayers(layerCount);
+    for (size_t index = 0; index < layerCount; ++index) {
+        Layer& layer = newLayers[index];
+        layer.inputs = newSizes[index];
+        layer.outputs = newSizes[index + 1];
+        if (weights[index].size() != static_cast<size_t>(layer.inputs) * layer.outputs || biases[index].size() != static_cast<size_t>(layer.outputs)) {
+            error = "Layer " + std::to_string(index + 1) + " needs " + std::to_string(layer.outputs) + " x " + std::to_string(layer.inputs) + " weights and " + std::to_string(layer.outputs) + " biases";
+            return false;
+        }
+        bool finite = std::all_of(weights[index].begin(), weights[index].end(), [](float value) { return std::isfinite(value); })
+            && std::all_of(biases[index].begin(), biases[index].end(), [](float value) { return std::isfinite(value); });
+        if (!finite) {
+            error = "Layer " + std::to_string(index + 1) + " has weights that are not finite";
+            return false;
+        }
+        layer.weights = weights[index];
+        layer.biases = biases[index];
+        pack(layer);
+    }
+
+    sizes = newSizes;
+    layers = newLayers;
+    return true;
+}
+
+void PolicyNetwork::pack(Layer& layer) const {
+    layer.paddedInputs = roundUpToPanel(layer.inputs);
+    layer.paddedOutputs = roundUpToPanel(layer.outputs);
+    layer.packed.assign(static_cast<size_t>(layer.paddedOutputs) * layer.paddedInputs, 0.0f);
+    layer.packedQuantized.assign(layer.packed.size(), 0);
+    layer.paddedBiases.assign(layer.paddedOutputs, 0.0f);
+    layer.outputScales.assign(layer.paddedOutputs, 0.0f);
+
+    for (int output = 0; output < layer.outputs; ++output) {
+        const float* row = &layer.weights[static_cast<size_t>(output) * layer.inputs];
+        int panel = output / panelWidth;
+        int column = output % panelWidth;
+        float* packedPanel = &layer.packed[static_cast<size_t>(panel) * layer.paddedInputs * panelWidth];
+        int16_t* quantizedPanel = &layer.packedQuantized[static_cast<size_t>(panel) * layer.paddedInputs * panelWidth];
+
+        float largest = 0.0f;
+        for (int input = 0; input < layer.inputs; ++input) {
+            packedPanel[input * panelWidth + column] = row[input];
+            largest = std::max(largest, std::fabs(row[input]));
+        }
+        float scale = largest > 0.0f ? largest / 127.0f : 1.0f;
+        for (int input = 0; input < layer.inputs; ++input) {
+            long rounded = std::lrint(row[input] / scale);
+            quantizedPanel[((input / 2) * panelWidth + column) * 2 + input % 2] = static_cast<int16_t>(std::max(-127L, std::min(127L, rounded)));
+        }
+        layer.outputScales[output] = scale;
+        layer.paddedBiases[output] = layer.biases[output];
+    }
+}
+
+void PolicyNetwork::multiply(const Layer& layer, const float* input, int inputStride, size_t rows, bool relu, float* output) const {
+    for (size_t row = 0; row < rows; row += 4) {
+        multiplyFourRows(layer.packed.data(), layer.paddedBiases.data(), layer.paddedInputs, layer.paddedOutputs,
+            input + row * inputStride, inputStride, relu, output + row * layer.paddedOutputs);
+    }
+}
+
+void PolicyNetwork::multiplyQuantized(const Layer& layer, const float* input, int inputStride, size_t rows, bool relu, PolicyScratch& scratch, float* output) const {
+    int16_t* quantizedInput = scratch.quantized.data();
+    quantizeRows(input, inputStride, rows, layer.paddedInputs, quantizedInput, scratch.rowScales.data());
+    for (size_t row = 0; row < rows; row += 4) {
+        multiplyQuantizedFourRows(layer.packedQuantized.data(), layer.outputScales.data(), layer.paddedBiases.data(), layer.paddedInputs, layer.paddedOutputs,
+            quantizedInput + row * layer.paddedInputs, scratch.rowScales.data() + row, relu, output + row * layer.paddedOutputs);
+    }
+}
+
+void PolicyNetwork::evaluate(const float* features, const uint8_t* masks, size_t rows, PolicyScratch& scratch, uint8_t* decisions) const {
+    if (layers.empty()) {
+        std::fill(decisions, decisions + rows, static_cast<uint8_t>(BrainDecision::Explore));
+        return;
+    }
+
+    // Both halves of the activations fit the widest layer of a row block
+    int width = featureCount;
+    for (const Layer& layer : layers) {
+        width = std::max(width, layer.paddedOutputs);
+    }
+    size_t half = static_cast<size_t>(rowBlock) * width;
+    if (scratch.activations.size() < 2 * half) {
+        scratch.activations.resize(2 * half);
+        scratch.quantized.resize(half);
+        scratch.rowScales.resize(rowBlock);
+    }
+
+    for (size_t block = 0; block < rows; block += rowBlock) {
+        // The kernels take four rows at a time, so the block's features are
+        // copied in behind zero rows up to a multiple of four
+        size_t count = std::min<size_t>(rowBlock, rows - block);
+        size_t paddedCount = (count + 3) / 4 * 4;
+        float* input = scratch.activations.data() + half;
+        std::copy(features + block * featureCount, features + (block + count) * featureCount, input);
+        std::fill(input + count * featureCount, input + paddedCount * featureCount, 0.0f);
+        int inputStride = featureCount;
+
+        for (size_t index = 0; index < layers.size(); ++index) {
+            const Layer& layer = layers[index];
+            float* output = scratch.activations.data() + (index % 2) * half;
+            bool relu = index + 1 < layers.size();
+            if (quantized) {
+                multiplyQuantized(layer, input, inputStride, paddedCount, relu, scratch, output);
+            }
+            else {
+                multiply(layer, input, inputStride, paddedCount, relu, output);
+            }
+            input = output;
+            inputStride = layer.paddedOutputs;
+        }
+
+        // The highest logit among the actions each agent can take
+        for (size_t row = 0; row < count; ++row) {
+            const float* logits = input + row * inputStride;
+            uint8_t mask = masks[block + row];
+            int best = -1;
+            for (int action = 0; action < actionCount; ++action) {
+                if ((mask & (1 << action)) != 0 && (best < 0 || logits[action] > logits[best])) {
+                    best = action;
+                }
+            }
+            decisions[block + row] = static_cast<uint8_t>(best < 0 ? static_cast<int>(BrainDecision::Explore) : best);
+        }
+    }
+}
+
+PolicyNetwork PolicyNetwork::makeRulesNetwork() {
+    // The hidden layer passes the features through, they are never negative
+    std::vector<int> layerSizes = { featureCount, featureCount, actionCount };
+    std::vector<float> hidden(featureCount * featureCount, 0.0f);
+    for (int feature = 0; feature < featureCount; ++feature) {
+        hidden[feature * featureCount + feature] = 1.0f;
+    }
+
+    // With the same actions ruled out as for UtilityBrain, a carrier has
+    // capture or return against explore, and a free agent grabs unless the
+    // other team carries, then tags when in reach and recovers otherwise
+    const int opponentHasFlag = 1;
+    std::vector<float> logits(actionCount * featureCount, 0.0f);
+    std::vector<float> biases(actionCount, 0.0f);
+    biases[static_cast<int>(BrainDecision::CaptureFlag)] = 2.0f;
+    logits[static_cast<int>(BrainDecision::TagEnemy) * featureCount + opponentHasFlag] = 3.0f;
+    logits[static_cast<int>(BrainDecision::RecoverFlag) * featureCount + opponentHasFlag] = 2.0f;
+    biases[static_cast<int>(BrainDecision::ReturnToHomeZone)] = 2.0f;
+    logits[static_cast<int>(BrainDecision::GrabFlag) * featureCount + opponentHasFlag] = -2.0f;
+    biases[static_cast<int>(BrainDecision::GrabFlag)] = 1.0f;
+
+    PolicyNetwork network;
+    std::string error;
+    network.setLayers(layerSizes, { hidden, logits }, { std::vector<float>(featureCount, 0.0f), biases }, error);
+    return network;
+}
+
+bool PolicyNetwork::parse(const std::string& text, PolicyNetwork& network, std::string& error) {
+    std::vector<int> parsedSizes;
+    bool haveSizes = false;
+    std::vector<float> values;
+
+    std::istringstream lines(text);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(lines, line)) {
+        lineNumber++;
+        std::istringstream tokens(line.substr(0, line.find('#')));
+        std::string where = "Line " + std::to_string(lineNumber) + ": ";
+        std::string token;
+        if (!haveSizes) {
+            if (!(tokens >> token)) {
+                continue;
+            }
+            if (token != "sizes") {
+                error = where + "expected the sizes line first";
+                return false;
+            }
+            while (tokens >> token) {
+                char* end = nullptr;
+                long size = std::strtol(token.c_str(), &end, 10);
+                if (*end != '\0' || size < 1 || size > maxWidth) {
+                    error = where + "layer sizes must be whole numbers between 1 and " + std::to_string(maxWidth) + ", got " + token;
+                    return false;
+                }
+                parsedSizes.push_back(static_cast<int>(size));
+            }
+            if (!checkSizes(parsedSizes, error)) {
+                error = where + error;
+                return false;
+            }
+            haveSizes = true;
+            continue;
+        }
+
+        while (tokens >> token) {
+            char* end = nullptr;
+            float value = std::strtof(token.c_str(), &end);
+            if (*end != '\0' || !std::isfinite(value)) {
+                error = where + "expected a number, got " + token;
+                return false;
+            }
+            values.push_back(value);
+        }
+    }
+    if (!haveSizes) {
+        error = "No sizes line";
+        return false;
+    }
+
+    size_t expected = 0;
+    for (size_t index = 0; index + 1 < parsedSizes.size(); ++index) {
+        expected += static_cast<size_t>(parsedSizes[index]) * parsedSizes[index + 1] + parsedSizes[index + 1];
+    }
+    if (values.size() != expected) {
+        error = "The sizes need " + std::to_string(expected) + " weights and biases, got " + std::to_string(values.size());
+        return false;
+    }
+
+    std::vector<std::vector<float>> weights;
+    std::vector<std::vector<float>> biases;
+    auto next = values.begin();
+    for (size_t index = 0; index + 1 < parsedSizes.size(); ++index) {
+        size_t weightCount = static_cast<size_t>(parsedSizes[index]) * parsedSizes[index + 1];
+        weights.emplace_back(next, next + weightCount);
+        next += weightCount;
+        biases.emplace_back(next, next + parsedSizes[index + 1]);
+        next += parsedSizes[index + 1];
+    }
+    return network.setLayers(parsedSizes, weights, biases, error);
+}
+
+bool PolicyNetwork::loadFile(const std::string& path, PolicyNetwork& network, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "Could not open " + path;
+        return false;
+    }
+    std::ostringstream text;
+    text << file.rdbuf();
+    if (!parse(text.str(), network, error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+std::string PolicyNetwork::format() const {
+    std::ostringstream text;
+    text.precision(9);
+    text << "sizes";
+    for (int size : sizes) {
+        text << ' ' << size;
+    }
+    text << '\n';
+    for (size_t index = 0; index < layers.size(); ++index) {
+        const Layer& layer = layers[index];
+        text << "# Layer " << index + 1 << ": " << layer.outputs << " rows of " << layer.inputs << " weights, then the biases\n";
+        for (int output = 0; output < layer.outputs; ++output) {
+            for (int input = 0; input < layer.inputs; ++input) {
+                text << (input > 0 ? " " : "") << layer.weights[static_cast<size_t>(output) * layer.inputs + input];
+            }
+            text << '\n';
+        }
+        for (int output = 0; output < layer.outputs; ++output) {
+            text << (output > 0 ? " " : "") << layer.biases[output];
+        }
+        text << '\n';
+    }
+    return text.str();
+}
+
+void PolicyNetwork::saveState(BinaryWriter& writer) const {
+    writer.writeBool(quantized);
+    writer.writeUInt32(static_cast<uint32_t>(sizes.size()));
+    for (int size : sizes) {
+        writer.writeInt32(size);
+    }
+    for (const Layer& layer : layers) {
+        for (float weight : layer.weights) {
+            writer.writeFloat(weight);
+        }
+        for (float bias : layer.biases) {
+            writer.writeFloat(bias);
+        }
+    }
+}
+
+bool PolicyNetwork::loadState(BinaryReader& reader) {
+    bool loadedQuantized = reader.readBool();
+    uint32_t count = reader.readUInt32();
+    if (reader.hasFailed() || count > static_cast<uint32_t>(maxLayers) + 1) {
+        return false;
+    }
+    std::vector<int> loadedSizes(count);
+    for (int& size : loadedSizes) {
+        size = reader.readInt32();
+    }
+    std::string error;
+    if (reader.hasFailed() || (count > 0 && !checkSizes(loadedSizes, error))) {
+        return false;
+    }
+
+    std::vector<std::vector<float>> weights;
+    std::vector<std::vector<float>> biases;
+    for (size_t index = 0; index + 1 < loadedSizes.size(); ++index) {
+        size_t weightCount = static_cast<size_t>(loadedSizes[index]) * loadedSizes[index + 1];
+        // Only as many floats as the snapshot can hold
+        if ((weightCount + loadedSizes[index + 1]) * 4 > reader.getRemaining()) {
+            return false;
+        }
+        weights.emplace_back(weightCount);
+        for (float& weight : weights.back()) {
+            weight = reader.readFloat();
+        }
+        biases.emplace_back(loadedSizes[index + 1]);
+        for (float& bias : biases.back()) {
+            bias = reader.readFloat();
+        }
+    }
+    if (reader.hasFailed()) {
+        return false;
+    }
+
+    if (count == 0) {
+        sizes.clear();
+        layers.clear();
+    }
+    else if (!setLayers(loadedSizes, weights, biases, error)) {
+        return false;
+    }
+    quantized = loadedQuantized;
+    return true;
+}
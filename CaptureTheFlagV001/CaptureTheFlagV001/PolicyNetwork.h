@@ -0,0 +1,119 @@
+#ifndef POLICYNETWORK_H
+#define POLICYNETWORK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Brain.h"
+
+class BinaryWriter;
+class BinaryReader;
+
+// Activations of one row block on its way through the layers, one per
+// batch of agents evaluated at the same time. Layers read one half of
+// activations and write the other.
+struct PolicyScratch {
+    std::vector<float> activations;
+    std::vector<int16_t> quantized;
+    std::vector<float> rowScales;
+};
+
+// A small multilayer perceptron choosing every agent's BrainDecision. Each
+// hidden layer is a fully connected layer followed by ReLU; the last layer
+// gives one logit per action and the agent takes the highest among those it
+// can take, ties going to the action listed first in BrainDecision. Which
+// actions an agent can take is the same as for UtilityBrain, so a policy
+// never sends a tagged agent anywhere but home.
+//
+// Agents are evaluated as rows of one feature matrix, so each layer is one
+// matrix product for the whole batch. Rows go through all the layers
+// rowBlock at a time, keeping their activations in cache, and each layer's
+// weights are packed into panels of panelWidth outputs that the kernels
+// stream once per four rows: eight outputs a load with AVX2, four with
+// SSE2, AVX2 being what the Release configuration builds for. Every output
+// of every row is summed in the same order, so a decision never depends on
+// where its agent falls in a batch.
+//
+// Quantized networks keep the weights rounded to int8 range per output,
+// round each row's activations the same way before every layer and sum in
+// whole numbers. The packed weights take half the memory of the float ones,
+// how much that buys depends on the machine, so the brain benchmark times
+// both; their decisions can differ from the float ones where two logits
+// nearly tie.
+class PolicyNetwork {
+public:
+    PolicyNetwork();
+
+    // One row of the feature matrix: the decision inputs as 1 or 0, the
+    // team, and the distances in hundreds of cells, capped at maxDistance
+    static const int featureCount = 8;
+    static const int actionCount = 6;
+    static const int maxLayers = 8;
+    static const int maxWidth = 1024;
+    static constexpr float maxDistance = 10.0f;
+    static void getFeatures(const DecisionInputs& inputs, int team, float proximityThreshold, float* features);
+    // A bit per BrainDecision the agent can take
+    static uint8_t getActionMask(const DecisionInputs& inputs, float proximityThreshold);
+
+    // Sizes run from featureCount to actionCount; each layer's weights are
+    // row major, one row of inputs per output. False, leaving the network
+    // as it was, when anything does not fit.
+    bool setLayers(const std::vector<int>& sizes, const std::vector<std::vector<float>>& weights, const std::vector<std::vector<float>>& biases, std::string& error);
+    bool isReady() const { return !layers.empty(); }
+    const std::vector<int>& getSizes() const { return sizes; }
+
+    // Weight files start with a "sizes" line listing the layer sizes, then
+    // hold each layer's weights, a row per output, followed by its biases,
+    // all separated by whitespace; "#" starts a comment. All or nothing,
+    // like GameParams::parse.
+    static bool parse(const std::string& text, PolicyNetwork& network, std::string& error);
+    static bool loadFile(const std::string& path, PolicyNetwork& network, std::string& error);
+    // The whole network in a form parse reads back
+    std::string format() const;
+
+    // The same choices as Brain::makeDecision, through one hidden layer
+    static PolicyNetwork makeRulesNetwork();
+
+    void setQuantized(bool enabled) { quantized = enabled; }
+    bool isQuantized() const { return quantized; }
+
+    // Decides rows agents from their features, featureCount a row, and masks
+    void evaluate(const float* features, const uint8_t* masks, size_t rows, PolicyScratch& scratch, uint8_t* decisions) const;
+
+    void saveState(BinaryWriter& writer) const;
+    // False, leaving the network as it was, when the saved one does not fit
+    bool loadState(BinaryReader& reader);
+
+    static const int rowBlock = 64;
+    static const int panelWidth = 8;
+
+private:
+    struct Layer {
+        int inputs;
+        int outputs;
+        // Inputs and outputs rounded up to whole panels, zero past the real ones
+        int paddedInputs;
+        int paddedOutputs;
+        // As given, for format and saveState
+        std::vector<float> weights;
+        std::vector<float> biases;
+        // Per panel, paddedInputs rows of panelWidth weights
+        std::vector<float> packed;
+        std::vector<float> paddedBiases;
+        // Per panel, pairs of inputs interleaved for each output, rounded to
+        // int8 range, and the scale taking each output back to floats
+        std::vector<int16_t> packedQuantized;
+        std::vector<float> outputScales;
+    };
+
+    void pack(Layer& layer) const;
+    void multiply(const Layer& layer, const float* input, int inputStride, size_t rows, bool relu, float* output) const;
+    void multiplyQuantized(const Layer& layer, const float* input, int inputStride, size_t rows, bool relu, PolicyScratch& scratch, float* output) const;
+
+    std::vector<int> sizes;
+    std::vector<Layer> layers;
+    bool quantized;
+};
+
+#endif
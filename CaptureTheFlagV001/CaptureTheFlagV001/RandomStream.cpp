@@ -0,0 +1,69 @@
+#include "RandomStream.h"
+
+namespace {
+    const uint32_t philoxMultiplier0 = 0xD2511F53u;
+    const uint32_t philoxMultiplier1 = 0xCD9E8D57u;
+    const uint32_t philoxWeyl0 = 0x9E3779B9u;
+    const uint32_t philoxWeyl1 = 0xBB67AE85u;
+    const int philoxRounds = 10;
+}
+
+RandomStream::RandomStream(uint64_t seed, uint32_t stream)
+    : seed(seed), stream(stream), position(0), cachedBlockIndex(0), hasCachedBlock(false) {}
+
+uint32_t RandomStream::nextUInt32() {
+    uint64_t blockIndex = position / 4;
+    if (!hasCachedBlock || blockIndex != cachedBlockIndex) {
+        generateBlock(blockIndex);
+    }
+    return cachedBlock[position++ % 4];
+}
+
+int RandomStream::bounded(int lowest, int highest) {
+    if (highest <= lowest) {
+        return lowest;
+    }
+
+    // Multiply-shift maps 32 random bits onto the range without a division
+    uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(highest) - lowest);
+    return lowest + static_cast<int>((static_cast<uint64_t>(nextUInt32()) * range) >> 32);
+}
+
+float RandomStream::nextFloat() {
+    // 24 bits fill the float mantissa exactly
+    return (nextUInt32() >> 8) * (1.0f / 16777216.0f);
+}
+
+void RandomStream::setPosition(uint64_t newPosition) {
+    position = newPosition;
+}
+
+void RandomStream::generateBlock(uint64_t blockIndex) {
+    uint32_t counter[4] = { static_cast<uint32_t>(blockIndex), static_cast<uint32_t>(blockIndex >> 32), stream, 0 };
+    uint32_t key0 = static_cast<uint32_t>(seed);
+    uint32_t key1 = static_cast<uint32_t>(seed >> 32);
+
+    for (int round = 0; round < philoxRounds; ++round) {
+        uint64_t product0 = static_cast<uint64_t>(philoxMultiplier0) * counter[0];
+        uint64_t product1 = static_cast<uint64_t>(philoxMultiplier1) * counter[2];
+
+        uint32_t next0 = static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ key0;
+        uint32_t next1 = static_cast<uint32_t>(product1);
+        uint32_t next2 = static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ key1;
+        uint32_t next3 = static_cast<uint32_t>(product0);
+
+        counter[0] = next0;
+        counter[1] = next1;
+        counter[2] = next2;
+        counter[3] = next3;
+
+        key0 += philoxWeyl0;
+        key1 += philoxWeyl1;
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        cachedBlock[i] = counter[i];
+    }
+    cachedBlockIndex = blockIndex;
+    hasCachedBlock = true;
+}
@@ -0,0 +1,38 @@
+#ifndef RANDOMSTREAM_H
+#define RANDOMSTREAM_H
+
+#include <cstdint>
+
+// Counter-based random numbers (Philox4x32-10). A stream is fully described
+// by the match seed, its stream id and how many numbers it has handed out,
+// so streams never share state and can be replayed or restored exactly.
+class RandomStream {
+public:
+    // Stream ids below this are agent ids; the setup stream places agents
+    static const uint32_t setupStream = 0xFFFFFFFFu;
+
+    RandomStream(uint64_t seed = 0, uint32_t stream = 0);
+
+    uint32_t nextUInt32();
+    // Uniform integer in [lowest, highest), like QRandomGenerator::bounded
+    int bounded(int lowest, int highest);
+    // Uniform float in [0, 1)
+    float nextFloat();
+
+    uint64_t getSeed() const { return seed; }
+    uint32_t getStream() const { return stream; }
+    uint64_t getPosition() const { return position; }
+    void setPosition(uint64_t newPosition);
+
+private:
+    void generateBlock(uint64_t blockIndex);
+
+    uint64_t seed;
+    uint32_t stream;
+    uint64_t position;
+    uint64_t cachedBlockIndex;
+    uint32_t cachedBlock[4];
+    bool hasCachedBlock;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef REPLAYFORMAT_H
+#define REPLAYFORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Replay file layout, all little-endian:
+//   header   magic "CTFR", version, field size, seed, tick length, match
+//            length, team sizes, keyframe interval, flag and zone positions
+//   frames   one per recorded tick; a keyframe opens every keyframe slot
+//   index    one entry per slot: tick and file offset of the keyframe to
+//            start from, so seeking never scans frames
+//   trailer  index offset, slot count, frame count, first and last tick, magic "CTFI"
+//
+// A keyframe holds every agent as varint x, y and a flag byte. A delta frame
+// holds one nibble per agent: 0-8 is a one cell step (dx + 1) * 3 + dy + 1
+// with unchanged flags, 15 is an escape whose flipped flag bits and zig-zag
+// varint dx, dy follow the nibbles. Ticks jumped over by event skipping are
+// simply absent; a frame covers every tick up to the next one.
+namespace ReplayFormat {
+    const uint32_t fileMagic = 0x52465443;  // "CTFR"
+    const uint32_t indexMagic = 0x49465443; // "CTFI"
+    const uint32_t version = 1;
+    const size_t trailerSize = 40;
+
+    const uint8_t keyframeBit = 1;
+    const uint8_t scoresBit = 2;
+
+    const uint8_t carryingFlag = 1;
+    const uint8_t taggedFlag = 2;
+    const uint8_t enabledFlag = 4;
+
+    const uint8_t escapeCode = 15;
+    const int defaultKeyframeInterval = 64;
+}
+
+struct ReplayAgentState {
+    int x;
+    int y;
+    uint8_t flags;
+};
+
+struct ReplayFrame {
+    long long tick;
+    int blueScore;
+    int redScore;
+    // Blue agents first, then red, in simulation order
+    std::vector<ReplayAgentState> agents;
+    // File offset of the frame after this one
+    size_t nextOffset;
+};
+
+struct ReplayHeader {
+    int gameFieldWidth;
+    int gameFieldHeight;
+    uint64_t matchSeed;
+    int tickMillis;
+    int gameDuration;
+    int blueCount;
+    int redCount;
+    int keyframeInterval;
+    std::pair<int, int> blueFlagPosition;
+    std::pair<int, int> redFlagPosition;
+    std::pair<int, int> blueTeamZonePosition;
+    std::pair<int, int> redTeamZonePosition;
+};
+
+#endif
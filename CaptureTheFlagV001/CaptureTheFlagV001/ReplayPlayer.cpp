@@ -0,0 +1,109 @@
+#include "ReplayPlayer.h"
+
+ReplayPlayer::ReplayPlayer()
+    : mappedData(nullptr), frame(), pendingSeekTick(-1), seekInProgress(false), seekReady(false), stopping(false), seekFrame() {
+}
+
+ReplayPlayer::~ReplayPlayer() {
+    {
+        std::lock_guard<std::mutex> lock(seekMutex);
+        stopping = true;
+    }
+    seekRequested.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+bool ReplayPlayer::open(const QString& path, std::string& error) {
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = "Could not open " + path.toStdString();
+        return false;
+    }
+    mappedData = file.map(0, file.size());
+    if (!mappedData) {
+        error = "Could not map " + path.toStdString();
+        return false;
+    }
+    if (!reader.open(mappedData, static_cast<size_t>(file.size()), error)) {
+        return false;
+    }
+    if (!reader.seek(reader.getFirstTick(), frame)) {
+        error = "Replay has no readable first frame";
+        return false;
+    }
+
+    worker = std::thread(&ReplayPlayer::runWorker, this);
+    return true;
+}
+
+void ReplayPlayer::advanceTo(long long tick) {
+    if (isSeeking()) {
+        return;
+    }
+
+    // Anything the deltas of this slot cannot reach goes to the worker
+    if (tick < frame.tick || tick - frame.tick > getHeader().keyframeInterval) {
+        seek(tick);
+        return;
+    }
+
+    while (true) {
+        long long nextTick = reader.peekNextTick(frame);
+        if (nextTick < 0 || nextTick > tick || !reader.readNextFrame(frame)) {
+            return;
+        }
+    }
+}
+
+void ReplayPlayer::seek(long long tick) {
+    {
+        std::lock_guard<std::mutex> lock(seekMutex);
+        pendingSeekTick = std::max(tick, reader.getFirstTick());
+        seekReady = false;
+    }
+    seekRequested.notify_one();
+}
+
+bool ReplayPlayer::isSeeking() const {
+    std::lock_guard<std::mutex> lock(seekMutex);
+    return pendingSeekTick >= 0 || seekInProgress || seekReady;
+}
+
+bool ReplayPlayer::collectSeek() {
+    std::lock_guard<std::mutex> lock(seekMutex);
+    if (!seekReady) {
+        return false;
+    }
+    std::swap(frame, seekFrame);
+    seekReady = false;
+    return true;
+}
+
+void ReplayPlayer::runWorker() {
+    ReplayFrame decoded;
+    std::unique_lock<std::mutex> lock(seekMutex);
+    while (true) {
+        seekRequested.wait(lock, [this]() { return stopping || pendingSeekTick >= 0; });
+        if (stopping) {
+            return;
+        }
+
+        long long tick = pendingSeekTick;
+        pendingSeekTick = -1;
+        seekInProgress = true;
+
+        // The mapped data never changes, so decoding needs no lock
+        lock.unlock();
+        bool ok = reader.seek(tick, decoded);
+        lock.lock();
+
+        seekInProgress = false;
+        // A newer request supersedes this result
+        if (ok && pendingSeekTick < 0) {
+            std::swap(seekFrame, decoded);
+            seekReady = true;
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef REPLAYPLAYER_H
+#define REPLAYPLAYER_H
+
+#include <QFile>
+#include <QString>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "ReplayReader.h"
+
+// Plays a replay file for GameField. The file is memory-mapped, so opening
+// a long match reads nothing up front. Playing forward decodes the next few
+// deltas on the calling thread; seeks backwards or past the next keyframe
+// decode on a worker thread, and the frame loop picks the result up with
+// collectSeek(). Only the newest pending seek is decoded, so dragging the
+// scrub bar never queues up work.
+class ReplayPlayer {
+public:
+    ReplayPlayer();
+    ~ReplayPlayer();
+
+    bool open(const QString& path, std::string& error);
+
+    const ReplayHeader& getHeader() const { return reader.getHeader(); }
+    long long getFirstTick() const { return reader.getFirstTick(); }
+    long long getLastTick() const { return reader.getLastTick(); }
+    const ReplayFrame& getFrame() const { return frame; }
+
+    // Moves the current frame to the last one at or before tick
+    void advanceTo(long long tick);
+    void seek(long long tick);
+    bool isSeeking() const;
+    // True when a finished seek replaced the current frame
+    bool collectSeek();
+
+private:
+    void runWorker();
+
+    QFile file;
+    uchar* mappedData;
+    ReplayReader reader;
+    ReplayFrame frame;
+
+    // Seek worker; pendingSeekTick is -1 when there is nothing to decode
+    std::thread worker;
+    mutable std::mutex seekMutex;
+    std::condition_variable seekRequested;
+    long long pendingSeekTick;
+    bool seekInProgress;
+    bool seekReady;
+    bool stopping;
+    ReplayFrame seekFrame;
+};
+
+#endif
@@ -0,0 +1,203 @@
+#include "ReplayReader.h"
+#include "BinaryStream.h"
+#include <algorithm>
+#include <limits>
+
+ReplayReader::ReplayReader()
+    : data(nullptr), size(0), framesEnd(0), header(), frameCount(0), firstTick(0), lastTick(0), slotCount(0) {
+}
+
+bool ReplayReader::open(const uint8_t* replayData, size_t replaySize, std::string& error) {
+    data = nullptr;
+    if (replayData == nullptr || replaySize < ReplayFormat::trailerSize) {
+        error = "Replay file is too short";
+        return false;
+    }
+
+    BinaryReader reader(replayData, replaySize);
+    if (reader.readUInt32() != ReplayFormat::fileMagic) {
+        error = "Not a replay file";
+        return false;
+    }
+    uint32_t version = reader.readUInt32();
+    if (version != ReplayFormat::version) {
+        error = "Replay version " + std::to_string(version) + " is not supported";
+        return false;
+    }
+
+    header.gameFieldWidth = reader.readInt32();
+    header.gameFieldHeight = reader.readInt32();
+    header.matchSeed = reader.readUInt64();
+    header.tickMillis = reader.readInt32();
+    header.gameDuration = reader.readInt32();
+    header.blueCount = reader.readInt32();
+    header.redCount = reader.readInt32();
+    header.keyframeInterval = reader.readInt32();
+    for (auto* position : { &header.blueFlagPosition, &header.redFlagPosition, &header.blueTeamZonePosition, &header.redTeamZonePosition }) {
+        position->first = reader.readInt32();
+        position->second = reader.readInt32();
+    }
+    if (reader.hasFailed() || header.blueCount < 0 || header.redCount < 0 || header.keyframeInterval < 1) {
+        error = "Replay header is damaged";
+        return false;
+    }
+
+    // The trailer sits at a fixed distance from the end, so no frame is read to find the index
+    BinaryReader trailer(replayData + replaySize - ReplayFormat::trailerSize, ReplayFormat::trailerSize);
+    uint64_t indexOffset = trailer.readUInt64();
+    slotCount = trailer.readUInt32();
+    frameCount = trailer.readInt64();
+    firstTick = trailer.readInt64();
+    lastTick = trailer.readInt64();
+    if (trailer.readUInt32() != ReplayFormat::indexMagic) {
+        error = "Replay has no index, the recording was not closed";
+        return false;
+    }
+    if (slotCount == 0 || indexOffset < reader.getOffset() || indexOffset + static_cast<uint64_t>(slotCount) * 16 + ReplayFormat::trailerSize != replaySize) {
+        error = "Replay index is damaged";
+        return false;
+    }
+
+    // A keyframe takes at least three bytes per agent, so team sizes no
+    // keyframe between the header and the index could hold are rejected
+    // before any frame is sized by them
+    long long agentCount = static_cast<long long>(header.blueCount) + header.redCount;
+    if (agentCount > std::numeric_limits<int>::max() || static_cast<uint64_t>(agentCount) * 3 > indexOffset - reader.getOffset()) {
+        error = "Replay team sizes do not fit in the file";
+        return false;
+    }
+
+    // Seeking trusts the index, so every slot must point at a keyframe of
+    // the tick it names, between the header and the index
+    size_t framesStart = reader.getOffset();
+    BinaryReader index(replayData + indexOffset, replaySize - static_cast<size_t>(indexOffset));
+    for (uint32_t slot = 0; slot < slotCount; ++slot) {
+        long long keyframeTick = index.readInt64();
+        uint64_t keyframeOffset = index.readUInt64();
+        if (index.hasFailed() || keyframeOffset < framesStart || keyframeOffset >= indexOffset) {
+            error = "Replay index is damaged";
+            return false;
+        }
+        BinaryReader keyframe(replayData + keyframeOffset, static_cast<size_t>(indexOffset - keyframeOffset));
+        uint8_t frameType = keyframe.readUInt8();
+        uint64_t tickValue = keyframe.readVarUInt();
+        if (keyframe.hasFailed() || !(frameType & ReplayFormat::keyframeBit) || static_cast<long long>(tickValue) != keyframeTick) {
+            error = "Replay index is damaged";
+            return false;
+        }
+    }
+
+    data = replayData;
+    size = replaySize;
+    framesEnd = static_cast<size_t>(indexOffset);
+    return true;
+}
+
+bool ReplayReader::seek(long long tick, ReplayFrame& frame) const {
+    if (data == nullptr || tick < firstTick) {
+        return false;
+    }
+
+    // One lookup into the slot table; a slot's keyframe can sit past the
+    // requested tick, in which case the previous slot's covers it
+    long long slot = std::min<long long>(tick / header.keyframeInterval, slotCount - 1);
+    BinaryReader index(data + framesEnd, size - framesEnd);
+    index.setOffset(static_cast<size_t>(slot) * 16);
+    long long keyframeTick = index.readInt64();
+    if (keyframeTick > tick && slot > 0) {
+        index.setOffset(static_cast<size_t>(slot - 1) * 16);
+        index.readInt64();
+    }
+    uint64_t keyframeOffset = index.readUInt64();
+    if (index.hasFailed() || !decodeFrame(static_cast<size_t>(keyframeOffset), frame)) {
+        return false;
+    }
+
+    while (true) {
+        long long nextTick = peekNextTick(frame);
+        if (nextTick < 0 || nextTick > tick) {
+            return true;
+        }
+        if (!readNextFrame(frame)) {
+            return false;
+        }
+    }
+}
+
+bool ReplayReader::readNextFrame(ReplayFrame& frame) const {
+    if (data == nullptr || frame.nextOffset >= framesEnd) {
+        return false;
+    }
+    return decodeFrame(frame.nextOffset, frame);
+}
+
+long long ReplayReader::peekNextTick(const ReplayFrame& frame) const {
+    if (data == nullptr || frame.nextOffset >= framesEnd) {
+        return -1;
+    }
+    BinaryReader reader(data + frame.nextOffset, framesEnd - frame.nextOffset);
+    uint8_t frameType = reader.readUInt8();
+    uint64_t tickValue = reader.readVarUInt();
+    if (reader.hasFailed()) {
+        return -1;
+    }
+    return (frameType & ReplayFormat::keyframeBit) ? static_cast<long long>(tickValue) : frame.tick + static_cast<long long>(tickValue);
+}
+
+bool ReplayReader::decodeFrame(size_t offset, ReplayFrame& frame) const {
+    BinaryReader reader(data + offset, framesEnd - offset);
+    size_t agentCount = static_cast<size_t>(getAgentCount());
+    uint8_t frameType = reader.readUInt8();
+
+    if (frameType & ReplayFormat::keyframeBit) {
+        frame.tick = static_cast<long long>(reader.readVarUInt());
+        frame.blueScore = static_cast<int>(reader.readVarUInt());
+        frame.redScore = static_cast<int>(reader.readVarUInt());
+        frame.agents.resize(agentCount);
+        for (auto& state : frame.agents) {
+            state.x = static_cast<int>(reader.readVarUInt());
+            state.y = static_cast<int>(reader.readVarUInt());
+            state.flags = reader.readUInt8();
+        }
+    }
+    else {
+        // Deltas apply on top of the frame before, which must be the one passed in
+        if (frame.agents.size() != agentCount) {
+            return false;
+        }
+        frame.tick += static_cast<long long>(reader.readVarUInt());
+        if (frameType & ReplayFormat::scoresBit) {
+            frame.blueScore = static_cast<int>(reader.readVarUInt());
+            frame.redScore = static_cast<int>(reader.readVarUInt());
+        }
+
+        size_t nibbleStart = reader.getOffset();
+        size_t nibbleBytes = (agentCount + 1) / 2;
+        if (nibbleBytes > reader.getRemaining()) {
+            return false;
+        }
+        reader.setOffset(nibbleStart + nibbleBytes);
+
+        const uint8_t* nibbles = data + offset + nibbleStart;
+        for (size_t i = 0; i < agentCount; ++i) {
+            uint8_t code = nibbles[i / 2] >> (4 * (i % 2)) & 0x0F;
+            ReplayAgentState& state = frame.agents[i];
+            if (code == ReplayFormat::escapeCode) {
+                state.flags ^= reader.readUInt8();
+                state.x += static_cast<int>(reader.readVarInt());
+                state.y += static_cast<int>(reader.readVarInt());
+            }
+            else if (code > 8) {
+                // Only steps of one cell and the escape are ever written
+                return false;
+            }
+            else {
+                state.x += code / 3 - 1;
+                state.y += code % 3 - 1;
+            }
+        }
+    }
+
+    frame.nextOffset = offset + reader.getOffset();
+    return !reader.hasFailed();
+}
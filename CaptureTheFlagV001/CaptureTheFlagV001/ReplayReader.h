@@ -0,0 +1,45 @@
+#ifndef REPLAYREADER_H
+#define REPLAYREADER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ReplayFormat.h"
+
+// Decodes a replay held in memory, typically a mapped file. The reader
+// never copies the data, so it must outlive the reader. Seeking looks up
+// the keyframe slot directly and decodes at most one slot of deltas.
+class ReplayReader {
+public:
+    ReplayReader();
+
+    bool open(const uint8_t* data, size_t size, std::string& error);
+    bool isOpen() const { return data != nullptr; }
+
+    const ReplayHeader& getHeader() const { return header; }
+    long long getFrameCount() const { return frameCount; }
+    long long getFirstTick() const { return firstTick; }
+    long long getLastTick() const { return lastTick; }
+    int getAgentCount() const { return header.blueCount + header.redCount; }
+
+    // Fills frame with the last recorded frame at or before tick
+    bool seek(long long tick, ReplayFrame& frame) const;
+    // Moves frame on to the frame recorded after it; false at the end
+    bool readNextFrame(ReplayFrame& frame) const;
+    // Tick of the frame after this one, or -1 at the end
+    long long peekNextTick(const ReplayFrame& frame) const;
+
+private:
+    bool decodeFrame(size_t offset, ReplayFrame& frame) const;
+
+    const uint8_t* data;
+    size_t size;
+    size_t framesEnd;
+    ReplayHeader header;
+    long long frameCount;
+    long long firstTick;
+    long long lastTick;
+    uint32_t slotCount;
+};
+
+#endif
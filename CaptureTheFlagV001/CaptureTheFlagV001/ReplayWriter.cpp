@@ -0,0 +1,205 @@
+#include "ReplayWriter.h"
+#include "BinaryStream.h"
+#include "Simulation.h"
+#include <algorithm>
+#include <cstdlib>
+
+ReplayWriter::ReplayWriter(int keyframeInterval)
+    : keyframeInterval(std::max(1, keyframeInterval)), bytesFlushed(0), frameCount(0), firstTick(0), lastTick(0),
+    blueScore(0), redScore(0), eventCursor(0) {
+}
+
+ReplayWriter::~ReplayWriter() {
+    std::string error;
+    close(error);
+}
+
+bool ReplayWriter::open(const std::string& path, const Simulation& simulation, std::string& error) {
+    if (file.is_open()) {
+        error = "A replay is already being written";
+        return false;
+    }
+    file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file) {
+        error = "Could not open " + path + " for writing";
+        return false;
+    }
+
+    buffer.clear();
+    bytesFlushed = 0;
+    frameCount = 0;
+    slotTicks.clear();
+    slotOffsets.clear();
+
+    const GameManager& gameManager = *simulation.getGameManager();
+    BinaryWriter writer(buffer);
+    writer.writeUInt32(ReplayFormat::fileMagic);
+    writer.writeUInt32(ReplayFormat::version);
+    writer.writeInt32(simulation.getGameFieldWidth());
+    writer.writeInt32(simulation.getGameFieldHeight());
+    writer.writeUInt64(gameManager.getMatchSeed());
+    writer.writeInt32(simulation.getTickMillis());
+    writer.writeInt32(simulation.getGameDuration());
+    writer.writeInt32(static_cast<int32_t>(simulation.getBlueAgents().size()));
+    writer.writeInt32(static_cast<int32_t>(simulation.getRedAgents().size()));
+    writer.writeInt32(keyframeInterval);
+    for (const auto& position : { gameManager.getFlagPosition("blue"), gameManager.getFlagPosition("red"),
+        gameManager.getTeamZonePosition("blue"), gameManager.getTeamZonePosition("red") }) {
+        writer.writeInt32(position.first);
+        writer.writeInt32(position.second);
+    }
+
+    captureStates(simulation);
+    blueScore = simulation.getBlueScore();
+    redScore = simulation.getRedScore();
+    eventCursor = simulation.getGameManager()->getEvents().getWritten();
+    firstTick = simulation.getTick();
+    writeKeyframe(firstTick);
+    return true;
+}
+
+void ReplayWriter::recordFrame(const Simulation& simulation) {
+    long long tick = simulation.getTick();
+    if (!file.is_open() || tick <= lastTick) {
+        return;
+    }
+
+    previousStates.swap(currentStates);
+    captureStates(simulation);
+
+    bool scoresChanged = false;
+    uint64_t missedEvents = simulation.getGameManager()->getEvents().drain(eventCursor, [&scoresChanged](const GameEvent& event) {
+        scoresChanged |= event.type == GameEventType::FlagCaptured;
+    });
+    scoresChanged |= missedEvents > 0;
+    blueScore = simulation.getBlueScore();
+    redScore = simulation.getRedScore();
+
+    // The first frame in a new slot is a keyframe
+    if (tick / keyframeInterval > lastTick / keyframeInterval) {
+        writeKeyframe(tick);
+    }
+    else {
+        BinaryWriter writer(buffer);
+        writer.writeUInt8(scoresChanged ? ReplayFormat::scoresBit : 0);
+        writer.writeVarUInt(static_cast<uint64_t>(tick - lastTick));
+        if (scoresChanged) {
+            writer.writeVarUInt(static_cast<uint64_t>(blueScore));
+            writer.writeVarUInt(static_cast<uint64_t>(redScore));
+        }
+        writeDelta(tick);
+    }
+
+    if (buffer.size() >= flushThreshold) {
+        flush();
+    }
+}
+
+void ReplayWriter::captureStates(const Simulation& simulation) {
+    currentStates.clear();
+    for (const auto* team : { &simulation.getBlueAgents(), &simulation.getRedAgents() }) {
+        for (const auto& agent : *team) {
+            uint8_t flags = (agent->isCarryingFlag() ? ReplayFormat::carryingFlag : 0) |
+                (agent->isTagged() ? ReplayFormat::taggedFlag : 0) |
+                (agent->isEnabled() ? ReplayFormat::enabledFlag : 0);
+            currentStates.push_back({ agent->getX(), agent->getY(), flags });
+        }
+    }
+}
+
+void ReplayWriter::writeKeyframe(long long tick) {
+    uint64_t offset = getBytesWritten();
+
+    // Slots with no frame of their own start from the keyframe before them
+    long long slot = tick / keyframeInterval;
+    while (!slotOffsets.empty() && static_cast<long long>(slotOffsets.size()) < slot) {
+        slotTicks.push_back(slotTicks.back());
+        slotOffsets.push_back(slotOffsets.back());
+    }
+    if (slotOffsets.empty()) {
+        // Seeks before the first keyframe's slot land on the first keyframe
+        slotTicks.assign(static_cast<size_t>(slot), tick);
+        slotOffsets.assign(static_cast<size_t>(slot), offset);
+    }
+    slotTicks.push_back(tick);
+    slotOffsets.push_back(offset);
+
+    BinaryWriter writer(buffer);
+    writer.writeUInt8(ReplayFormat::keyframeBit);
+    writer.writeVarUInt(static_cast<uint64_t>(tick));
+    writer.writeVarUInt(static_cast<uint64_t>(blueScore));
+    writer.writeVarUInt(static_cast<uint64_t>(redScore));
+    for (const auto& state : currentStates) {
+        writer.writeVarUInt(static_cast<uint64_t>(state.x));
+        writer.writeVarUInt(static_cast<uint64_t>(state.y));
+        writer.writeUInt8(state.flags);
+    }
+
+    lastTick = tick;
+    frameCount++;
+}
+
+void ReplayWriter::writeDelta(long long tick) {
+    // Nibbles first, two agents per byte, then the escapes in agent order
+    size_t nibbleStart = buffer.size();
+    buffer.resize(nibbleStart + (currentStates.size() + 1) / 2, 0);
+
+    for (size_t i = 0; i < currentStates.size(); ++i) {
+        const ReplayAgentState& current = currentStates[i];
+        const ReplayAgentState& previous = previousStates[i];
+        int dx = current.x - previous.x;
+        int dy = current.y - previous.y;
+
+        uint8_t code = ReplayFormat::escapeCode;
+        if (current.flags == previous.flags && std::abs(dx) <= 1 && std::abs(dy) <= 1) {
+            code = static_cast<uint8_t>((dx + 1) * 3 + dy + 1);
+        }
+        buffer[nibbleStart + i / 2] |= static_cast<uint8_t>(code << (4 * (i % 2)));
+    }
+
+    BinaryWriter writer(buffer);
+    for (size_t i = 0; i < currentStates.size(); ++i) {
+        if ((buffer[nibbleStart + i / 2] >> (4 * (i % 2)) & 0x0F) != ReplayFormat::escapeCode) {
+            continue;
+        }
+        writer.writeUInt8(currentStates[i].flags ^ previousStates[i].flags);
+        writer.writeVarInt(currentStates[i].x - previousStates[i].x);
+        writer.writeVarInt(currentStates[i].y - previousStates[i].y);
+    }
+
+    lastTick = tick;
+    frameCount++;
+}
+
+void ReplayWriter::flush() {
+    file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+    bytesFlushed += buffer.size();
+    buffer.clear();
+}
+
+bool ReplayWriter::close(std::string& error) {
+    if (!file.is_open()) {
+        return true;
+    }
+
+    BinaryWriter writer(buffer);
+    uint64_t indexOffset = getBytesWritten();
+    for (size_t i = 0; i < slotOffsets.size(); ++i) {
+        writer.writeInt64(slotTicks[i]);
+        writer.writeUInt64(slotOffsets[i]);
+    }
+    writer.writeUInt64(indexOffset);
+    writer.writeUInt32(static_cast<uint32_t>(slotOffsets.size()));
+    writer.writeInt64(frameCount);
+    writer.writeInt64(firstTick);
+    writer.writeInt64(lastTick);
+    writer.writeUInt32(ReplayFormat::indexMagic);
+    flush();
+
+    bool ok = static_cast<bool>(file);
+    file.close();
+    if (!ok) {
+        error = "Could not write the replay file";
+    }
+    return ok;
+}
@@ -0,0 +1,56 @@
+#ifndef REPLAYWRITER_H
+#define REPLAYWRITER_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "ReplayFormat.h"
+
+class Simulation;
+
+// Records a match as it is simulated, see ReplayFormat.h for the layout.
+// Call recordFrame after every step or advance; frames are buffered and
+// written in blocks, and close() appends the keyframe index.
+class ReplayWriter {
+public:
+    explicit ReplayWriter(int keyframeInterval = ReplayFormat::defaultKeyframeInterval);
+    ~ReplayWriter();
+
+    // Writes the header and the current state as the first keyframe
+    bool open(const std::string& path, const Simulation& simulation, std::string& error);
+    void recordFrame(const Simulation& simulation);
+    bool close(std::string& error);
+
+    bool isOpen() const { return file.is_open(); }
+    long long getFrameCount() const { return frameCount; }
+    uint64_t getBytesWritten() const { return bytesFlushed + buffer.size(); }
+
+private:
+    void captureStates(const Simulation& simulation);
+    void writeKeyframe(long long tick);
+    void writeDelta(long long tick);
+    void flush();
+
+    int keyframeInterval;
+    std::ofstream file;
+    std::vector<uint8_t> buffer;
+    uint64_t bytesFlushed;
+    long long frameCount;
+    long long firstTick;
+    long long lastTick;
+    int blueScore;
+    int redScore;
+    // Captures since the last frame tell when the scores need writing
+    uint64_t eventCursor;
+    std::vector<ReplayAgentState> previousStates;
+    std::vector<ReplayAgentState> currentStates;
+
+    // Keyframe index, one tick and offset per slot
+    std::vector<long long> slotTicks;
+    std::vector<uint64_t> slotOffsets;
+
+    static const size_t flushThreshold = 1 << 16;
+};
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef RULEINTENT_H
+#define RULEINTENT_H
+
+// What one agent brings to the rules phase: where it ended the tick, its
+// flag and tag state, and what its decision asks the rules for. Agents fill
+// these in parallel and the rules only read them, so no agent sees another
+// agent's outcome halfway through a pass.
+struct RuleIntent {
+    int x, y;
+    bool blueTeam;
+    bool enabled;
+    // Decided this tick under the flag and tag rules, false while tagged
+    bool appliesRules;
+    // TagEnemy decision with the cooldown run out
+    bool wantsTag;
+    bool tagged;
+    bool carrying;
+    bool inTeamZone;
+    bool onEnemySide;
+    float enemyFlagDistance;
+};
+
+#endif
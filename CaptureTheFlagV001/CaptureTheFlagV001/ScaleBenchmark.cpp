@@ -0,0 +1,184 @@
+#include "ScaleBenchmark.h"
+#include "Simulation.h"
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+ScaleBenchmark::ScaleBenchmark(const ScaleBenchmarkConfig& config)
+    : config(config) {}
+
+int ScaleBenchmark::run() {
+    std::ofstream output(config.outputPath, std::ios::out | std::ios::trunc);
+    if (!output) {
+        std::cerr << "Could not open " << config.outputPath << " for writing" << std::endl;
+        return 1;
+    }
+    output << "agents,width,height,workers,decision_interval,ticks,setup_ms,ticks_per_s,mean_tick_ms,bytes_per_agent,mean_decisions,peak_decisions,decisions_stddev,influence_ms,influence_moves\n";
+
+    std::cerr << std::setw(8) << "agents" << std::setw(14) << "field" << std::setw(12) << "ticks/s"
+        << std::setw(12) << "tick ms" << std::setw(12) << "setup ms" << std::setw(14) << "bytes/agent"
+        << std::setw(12) << "decisions" << std::setw(10) << "peak" << std::setw(14) << "influence ms" << std::endl;
+
+    for (const auto& fieldSize : config.fieldSizes) {
+        for (int agentCount : config.agentCounts) {
+            ScaleResult result = measure(agentCount, fieldSize.first, fieldSize.second);
+
+            output << result.agentCount << ',' << result.gameFieldWidth << ',' << result.gameFieldHeight << ','
+                << result.workerCount << ',' << config.decisionInterval << ',' << result.ticks << ',' << result.setupMillis << ','
+                << result.ticksPerSecond << ',' << result.meanTickMillis << ',' << result.bytesPerAgent << ','
+                << result.meanDecisionsPerTick << ',' << result.peakDecisionsPerTick << ',' << result.decisionStdDev << ','
+                << result.influenceMillis << ',' << result.influenceMovesPerTick << '\n';
+            output.flush();
+
+            std::cerr << std::setw(8) << result.agentCount
+                << std::setw(14) << (std::to_string(result.gameFieldWidth) + "x" + std::to_string(result.gameFieldHeight))
+                << std::setw(12) << result.ticksPerSecond << std::setw(12) << result.meanTickMillis
+                << std::setw(12) << result.setupMillis << std::setw(14) << result.bytesPerAgent
+                << std::setw(12) << result.meanDecisionsPerTick << std::setw(10) << result.peakDecisionsPerTick
+                << std::setw(14) << result.influenceMillis << std::endl;
+        }
+    }
+    return 0;
+}
+
+ScaleResult ScaleBenchmark::measure(int agentCount, int gameFieldWidth, int gameFieldHeight) const {
+    long long bytesBefore = residentBytes();
+    auto setupStart = std::chrono::steady_clock::now();
+
+    Simulation simulation(gameFieldWidth, gameFieldHeight, config.seed, config.workerCount);
+    simulation.setDecisionInterval(config.decisionInterval);
+    simulation.setGameDuration(config.ticks * simulation.getTickMillis() / 1000 + 1);
+    simulation.setupAgents(agentCount / 2, agentCount - agentCount / 2);
+
+    // One tick outside the timing so per-tick buffers are already at full size
+    simulation.step();
+    double setupMillis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - setupStart).count();
+    long long bytesAfter = residentBytes();
+
+    auto tickStart = std::chrono::steady_clock::now();
+    int ticks = 0;
+    while (ticks < config.ticks && !simulation.isFinished()) {
+        simulation.step();
+        ticks++;
+    }
+    double tickSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tickStart).count();
+
+    ScaleResult result;
+    result.agentCount = agentCount;
+    result.gameFieldWidth = gameFieldWidth;
+    result.gameFieldHeight = gameFieldHeight;
+    result.workerCount = simulation.getTickGraph().getWorkerCount();
+    result.ticks = ticks;
+    result.setupMillis = setupMillis;
+    result.ticksPerSecond = ticks / std::max(tickSeconds, 1e-9);
+    result.meanTickMillis = ticks > 0 ? tickSeconds * 1000.0 / ticks : 0.0;
+    result.meanDecisionsPerTick = simulation.getDecisionLoad().getMean();
+    result.peakDecisionsPerTick = simulation.getDecisionLoad().peak;
+    result.decisionStdDev = simulation.getDecisionLoad().getStdDev();
+    result.influenceMillis = simulation.getInfluenceMap().getLoad().getMeanMillis();
+    result.influenceMovesPerTick = simulation.getInfluenceMap().getLoad().getMovesPerUpdate();
+    result.bytesPerAgent = agentCount > 0 && bytesBefore > 0 ? static_cast<double>(bytesAfter - bytesBefore) / agentCount : 0.0;
+    return result;
+}
+
+long long ScaleBenchmark::residentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return static_cast<long long>(counters.WorkingSetSize);
+    }
+    return 0;
+#else
+    // Second field of statm is the resident page count
+    std::ifstream statm("/proc/self/statm");
+    long long totalPages = 0;
+    long long residentPages = 0;
+    if (statm >> totalPages >> residentPages) {
+        return residentPages * static_cast<long long>(sysconf(_SC_PAGESIZE));
+    }
+    return 0;
+#endif
+}
+
+bool ScaleBenchmark::parseArguments(const QStringList& arguments, ScaleBenchmarkConfig& config, std::string& error) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures tick rate and memory against agent count and field size");
+    QCommandLineOption benchOption("scale-bench", "Run the scaling benchmark and exit.");
+    QCommandLineOption agentsOption("agents", "Comma separated agent counts.", "counts", "1000,10000,100000");
+    QCommandLineOption fieldsOption("fields", "Comma separated field sizes as WIDTHxHEIGHT.", "sizes", "800x600,2000x2000,8000x8000");
+    QCommandLineOption ticksOption("ticks", "Timed ticks per point.", "count", "50");
+    QCommandLineOption threadsOption("threads", "Tick graph workers, 0 uses every core.", "count", "0");
+    QCommandLineOption decisionIntervalOption("decision-interval", "Ticks between decisions for agents far from contact.", "ticks", "1");
+    QCommandLineOption seedOption("seed", "Match seed.", "seed", QString::number(GameManager::defaultMatchSeed));
+    QCommandLineOption outputOption("output", "CSV result file.", "path", "scale_results.csv");
+    parser.addOptions({ benchOption, agentsOption, fieldsOption, ticksOption, threadsOption, decisionIntervalOption, seedOption, outputOption });
+
+    if (!parser.parse(arguments)) {
+        error = parser.errorText().toStdString();
+        return false;
+    }
+
+    bool ok = true;
+    config.agentCounts.clear();
+    for (const QString& count : parser.value(agentsOption).split(',', Qt::SkipEmptyParts)) {
+        int agentCount = count.trimmed().toInt(&ok);
+        if (!ok || agentCount < 0) {
+            error = "Agent counts must be whole numbers, got " + count.toStdString();
+            return false;
+        }
+        config.agentCounts.push_back(agentCount);
+    }
+
+    config.fieldSizes.clear();
+    for (const QString& size : parser.value(fieldsOption).split(',', Qt::SkipEmptyParts)) {
+        QStringList dimensions = size.trimmed().split('x');
+        bool widthOk = false;
+        bool heightOk = false;
+        int width = dimensions.value(0).toInt(&widthOk);
+        int height = dimensions.value(1).toInt(&heightOk);
+        if (dimensions.size() != 2 || !widthOk || !heightOk || width < 200 || height < 100) {
+            error = "Field sizes look like 800x600 and are at least 200x100, got " + size.toStdString();
+            return false;
+        }
+        config.fieldSizes.emplace_back(width, height);
+    }
+
+    bool allOk = true;
+    config.ticks = parser.value(ticksOption).toInt(&ok); allOk &= ok;
+    config.workerCount = parser.value(threadsOption).toInt(&ok); allOk &= ok;
+    config.decisionInterval = parser.value(decisionIntervalOption).toInt(&ok); allOk &= ok;
+    config.seed = parser.value(seedOption).toULongLong(&ok); allOk &= ok;
+    config.outputPath = parser.value(outputOption).toStdString();
+
+    if (!allOk || config.ticks < 1 || config.workerCount < 0 || config.decisionInterval < 1) {
+        error = "Ticks and the decision interval must be at least 1 and threads must not be negative";
+        return false;
+    }
+    return true;
+}
+
+int ScaleBenchmark::runFromArguments(const QStringList& arguments) {
+    ScaleBenchmarkConfig config;
+    std::string error;
+    if (!parseArguments(arguments, config, error)) {
+        std::cerr << error << std::endl;
+        return 2;
+    }
+
+    // Logging from a hundred thousand agents would be all the benchmark measures
+    QLoggingCategory::setFilterRules("*.debug=false");
+
+    ScaleBenchmark benchmark(config);
+    return benchmark.run();
+}
@@ -0,0 +1,60 @@
+#ifndef SCALEBENCHMARK_H
+#define SCALEBENCHMARK_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include <QStringList>
+
+// One sweep: every agent count on every field size, half blue and half red
+struct ScaleBenchmarkConfig {
+    std::vector<int> agentCounts;
+    std::vector<std::pair<int, int>> fieldSizes;
+    int ticks;
+    int workerCount;
+    int decisionInterval;
+    uint64_t seed;
+    std::string outputPath;
+};
+
+struct ScaleResult {
+    int agentCount;
+    int gameFieldWidth;
+    int gameFieldHeight;
+    int workerCount;
+    int ticks;
+    double setupMillis;
+    double ticksPerSecond;
+    double meanTickMillis;
+    double bytesPerAgent;
+    double meanDecisionsPerTick;
+    int peakDecisionsPerTick;
+    double decisionStdDev;
+    double influenceMillis;
+    double influenceMovesPerTick;
+};
+
+// Measures how tick rate and memory grow with agent count and field size.
+// Each point builds a fresh headless Simulation, steps it a fixed number of
+// ticks and reports resident memory growth per agent next to the timings.
+class ScaleBenchmark {
+public:
+    explicit ScaleBenchmark(const ScaleBenchmarkConfig& config);
+
+    // Returns a process exit code
+    int run();
+
+    static bool parseArguments(const QStringList& arguments, ScaleBenchmarkConfig& config, std::string& error);
+    static int runFromArguments(const QStringList& arguments);
+
+    // Resident set size of this process in bytes, 0 where unsupported
+    static long long residentBytes();
+
+private:
+    ScaleResult measure(int agentCount, int gameFieldWidth, int gameFieldHeight) const;
+
+    ScaleBenchmarkConfig config;
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef SIMCLOCK_H
+#define SIMCLOCK_H
+
+// Fixed-timestep simulation clock. Game time only moves when a tick is
+// stepped, so it never depends on how long a tick took to compute.
+class SimClock {
+public:
+    explicit SimClock(int tickMillis = 1000) : tick(0), tickMillis(tickMillis) {}
+
+    void advance() { ++tick; }
+    void advance(long long ticks) { tick += ticks; }
+    void reset() { tick = 0; }
+
+    long long getTick() const { return tick; }
+    void setTick(long long value) { tick = value; }
+    int getTickMillis() const { return tickMillis; }
+    void setTickMillis(int millis) { tickMillis = millis; }
+
+    long long getElapsedMillis() const { return tick * tickMillis; }
+    double ticksToSeconds(long long ticks) const { return static_cast<double>(ticks) * tickMillis / 1000.0; }
+    long long secondsToTicks(double seconds) const { return static_cast<long long>(seconds * 1000.0 / tickMillis); }
+
+private:
+    long long tick;
+    int tickMillis;
+};
+
+#endif
@@ -0,0 +1,1164 @@
+#include "Simulation.h"
+#include "RandomStream.h"
+#include "BinaryStream.h"
+#include "Logging.h"
+#include <QDebug>
+#include <QString>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+
+Simulation::Simulation(int gameFieldWidth, int gameFieldHeight, uint64_t matchSeed, int workerCount)
+    : gameFieldWidth(gameFieldWidth), gameFieldHeight(gameFieldHeight), taggingDistance(10.0f), movementSpeed(Agent::defaultMovementSpeed),
+    blueScore(0), redScore(0), stats(), gameDuration(600), finished(false), tickGraph(workerCount), graphBlueCount(-1), graphRedCount(-1), ticksSinceTimingLog(0),
+    blueGrid(gameFieldWidth, gameFieldHeight, gridCellSize), redGrid(gameFieldWidth, gameFieldHeight, gridCellSize), perception(gameFieldWidth, gameFieldHeight),
+    avoidance(gameFieldWidth, gameFieldHeight), collisionAvoidance(true), influenceMap(gameFieldWidth, gameFieldHeight), ruleEventCursor(0), logEventCursor(0), decisionInterval(1), decisionsThisTick(0), decisionLoad(), blueBrainBackend(BrainBackend::Rules), redBrainBackend(BrainBackend::Rules), blueBehaviourTree(BehaviourTree::makeRulesTree()), redBehaviourTree(BehaviourTree::makeRulesTree()), bluePolicy(PolicyNetwork::makeRulesNetwork()), redPolicy(PolicyNetwork::makeRulesNetwork()), paramsReloadCount(0), eventSkipping(true), skippedTicks(0), skipCheckBackoff(1), ticksUntilSkipCheck(0) {
+    gameManager = std::make_shared<GameManager>(gameFieldWidth, gameFieldHeight, matchSeed);
+    pathfinder = std::make_shared<Pathfinder>(gameFieldWidth, gameFieldHeight);
+    blueBlackboard = std::make_shared<TeamBlackboard>();
+    redBlackboard = std::make_shared<TeamBlackboard>();
+    applyMemoryRetention();
+    applyUtilityWeights();
+
+    placeFlagsAndZones();
+}
+
+void Simulation::placeFlagsAndZones() {
+    // Flags and team zones sit on the midline of each side, matching the scene layout
+    gameManager->setFlagPosition("blue", 70, gameFieldHeight / 2 - 10);
+    gameManager->setFlagPosition("red", gameFieldWidth - 90, gameFieldHeight / 2 - 10);
+    gameManager->setTeamZonePosition("blue", 90, gameFieldHeight / 2);
+    gameManager->setTeamZonePosition("red", gameFieldWidth - 70, gameFieldHeight / 2);
+    applyInfluenceRoutes();
+}
+
+void Simulation::applyInfluenceRoutes() {
+    influenceMap.setRoutes(gameManager->getFlagPosition("blue"), gameManager->getTeamZonePosition("blue"),
+        gameManager->getFlagPosition("red"), gameManager->getTeamZonePosition("red"));
+}
+
+void Simulation::clearAgents() {
+    // The agents go back to the pool, nothing is freed
+    blueAgents.clear();
+    redAgents.clear();
+    blueBlackboard->resize(0);
+    redBlackboard->resize(0);
+    buildTickGraph();
+}
+
+void Simulation::setupAgents(int blueCount, int redCount) {
+    // Spawn positions come from the match seed so every run of a seed starts the same
+    RandomStream spawnRandom(gameManager->getMatchSeed(), RandomStream::setupStream);
+    int nextAgentId = 0;
+    blueAgents.clear();
+    redAgents.clear();
+
+    // Initialize blue agents
+    for (int i = 0; i < blueCount; i++) {
+        int x = spawnRandom.bounded(0, gameFieldWidth / 2);
+        int y = spawnRandom.bounded(0, gameFieldHeight);
+
+        // Take the blue agent from the pool and add to the list
+        blueAgents.push_back(acquireAgent(nextAgentId++, x, y, "blue"));
+    }
+
+    // Initialize red agents
+    for (int i = 0; i < redCount; i++) {
+        int x = spawnRandom.bounded(gameFieldWidth / 2, gameFieldWidth);
+        int y = spawnRandom.bounded(0, gameFieldHeight);
+
+        // Take the red agent from the pool and add to the list
+        redAgents.push_back(acquireAgent(nextAgentId++, x, y, "red"));
+    }
+
+    // A new match starts with nothing remembered
+    blueBlackboard->clear();
+    redBlackboard->clear();
+    blueBlackboard->resize(blueAgents.size());
+    redBlackboard->resize(redAgents.size());
+    behaviourBlackboards.assign(blueAgents.size() + redAgents.size(), BehaviourBlackboard());
+
+    blueScore = 0;
+    redScore = 0;
+    stats = MatchStats();
+    finished = false;
+    decisionLoad = DecisionLoad();
+    influenceMap.resetLoad();
+    skippedTicks = 0;
+    skipCheckBackoff = 1;
+    ticksUntilSkipCheck = 0;
+
+    // Pool slots map to ids, so the same team sizes mean the same agents in the same order
+    if (blueCount != graphBlueCount || redCount != graphRedCount) {
+        buildTickGraph();
+    }
+    else {
+        std::fill(decidesThisTick.begin(), decidesThisTick.end(), 1);
+    }
+}
+
+void Simulation::resetMatch(uint64_t matchSeed) {
+    gameManager->setMatchSeed(matchSeed);
+    gameManager->getClock().reset();
+    placeFlagsAndZones();
+
+    // Events from the last match stay in the buffer but are never read again
+    ruleEventCursor = gameManager->getEvents().getWritten();
+    logEventCursor = ruleEventCursor;
+
+    finished = false;
+    tickGraph.resetPhaseTimings();
+    ticksSinceTimingLog = 0;
+}
+
+std::shared_ptr<Agent> Simulation::acquireAgent(int id, int x, int y, const std::string& side) {
+    // Ids are handed out from 0, so an agent's id is its pool slot. Its
+    // blackboard slot is the place it is about to take in its team.
+    bool blue = side == "blue";
+    const std::shared_ptr<TeamBlackboard>& blackboard = blue ? blueBlackboard : redBlackboard;
+    int blackboardSlot = static_cast<int>(blue ? blueAgents.size() : redAgents.size());
+
+    std::shared_ptr<Agent> agent;
+    if (id < static_cast<int>(agentPool.size())) {
+        agent = agentPool[id];
+        agent->reset(id, x, y, side, blackboard, blackboardSlot);
+    }
+    else {
+        auto brain = std::make_shared<Brain>();
+        agent = std::make_shared<Agent>(id, x, y, side, gameFieldWidth, gameFieldHeight, pathfinder, taggingDistance, brain, blackboard, blackboardSlot, gameManager, blueAgents, redAgents);
+        agentPool.push_back(agent);
+    }
+    agent->setCarryingFlag(false);
+    agent->setIsTagged(false);
+    agent->setMovementSpeed(movementSpeed);
+    return agent;
+}
+
+void Simulation::setTickMillis(int millis) {
+    gameManager->getClock().setTickMillis(std::max(1, millis));
+    applyMemoryRetention();
+}
+
+void Simulation::applyMemoryRetention() {
+    // Retention is game time, so it is kept in ticks of the current length
+    long long retentionTicks = gameManager->getClock().secondsToTicks(getParams().memoryRetentionSeconds);
+    blueBlackboard->setRetention(retentionTicks);
+    redBlackboard->setRetention(retentionTicks);
+}
+
+void Simulation::setObstacles(const std::vector<std::pair<int, int>>& obstacles) {
+    pathfinder->setDynamicObstacles(obstacles);
+    perception.setObstacles(obstacles);
+}
+
+void Simulation::setMovementSpeed(float cellsPerSecond) {
+    movementSpeed = cellsPerSecond;
+    for (Agent* agent : allAgents) {
+        agent->setMovementSpeed(cellsPerSecond);
+    }
+}
+
+void Simulation::setBrainBackend(const std::string& side, BrainBackend backend) {
+    (side == "blue" ? blueBrainBackend : redBrainBackend) = backend;
+}
+
+void Simulation::setUtilityWeights(const std::string& side, const UtilityWeights& weights) {
+    GameParams params = getParams();
+    (side == "blue" ? params.blueUtility : params.redUtility) = weights;
+    setParams(params);
+}
+
+void Simulation::applyUtilityWeights() {
+    utilityBrain.setWeights(0, getParams().blueUtility);
+    utilityBrain.setWeights(1, getParams().redUtility);
+}
+
+void Simulation::setParams(const GameParams& params) {
+    gameManager->setParams(params);
+    for (const std::shared_ptr<Agent>& agent : agentPool) {
+        agent->setViewCone(params.viewRange, params.viewAngle);
+        agent->getBrain()->setProximityThreshold(params.proximityThreshold);
+    }
+    applyUtilityWeights();
+    applyMemoryRetention();
+}
+
+bool Simulation::loadParamsFile(const std::string& path, std::string& error) {
+    GameParams params;
+    if (!GameParams::loadFile(path, params, error)) {
+        return false;
+    }
+    setParams(params);
+    return true;
+}
+
+bool Simulation::watchParamsFile(const std::string& path, std::string& error) {
+    paramsWatcher.reset();
+    if (!loadParamsFile(path, error)) {
+        return false;
+    }
+    paramsWatcher = std::make_unique<ParamsWatcher>(path);
+    return true;
+}
+
+bool Simulation::setBehaviourTree(const std::string& side, const BehaviourTree& tree, std::string& error) {
+    if (!tree.isFinished()) {
+        error = "Behaviour trees must be finished before a team can use them";
+        return false;
+    }
+    (side == "blue" ? blueBehaviourTree : redBehaviourTree) = tree;
+
+    // Running nodes index the old tree
+    size_t begin = side == "blue" ? 0 : blueAgents.size();
+    size_t end = side == "blue" ? blueAgents.size() : behaviourBlackboards.size();
+    for (size_t i = begin; i < end && i < behaviourBlackboards.size(); ++i) {
+        behaviourBlackboards[i] = BehaviourBlackboard();
+    }
+    return true;
+}
+
+bool Simulation::setPolicyNetwork(const std::string& side, const PolicyNetwork& network, std::string& error) {
+    if (!network.isReady()) {
+        error = "Policy networks need their layers before a team can use them";
+        return false;
+    }
+    (side == "blue" ? bluePolicy : redPolicy) = network;
+    return true;
+}
+
+bool Simulation::loadPolicyFile(const std::string& side, const std::string& path, std::string& error) {
+    PolicyNetwork network;
+    return PolicyNetwork::loadFile(path, network, error) && setPolicyNetwork(side, network, error);
+}
+
+void Simulation::applyRuleEvents() {
+    gameManager->getEvents().drain(ruleEventCursor, [this](const GameEvent& event) {
+        switch (event.type) {
+        case GameEventType::FlagCaptured:
+            handleFlagCapture(event.blueTeam ? "blue" : "red");
+            break;
+        case GameEventType::FlagReset:
+            stats.flagResets++;
+            break;
+        case GameEventType::FlagGrabbed:
+            (event.blueTeam ? stats.blueGrabs : stats.redGrabs)++;
+            break;
+        case GameEventType::AgentTagged:
+            (event.blueTeam ? stats.blueTags : stats.redTags)++;
+            break;
+        }
+    });
+}
+
+void Simulation::logEvents() {
+    gameManager->getEvents().drain(logEventCursor, [](const GameEvent& event) {
+        if (event.type == GameEventType::FlagCaptured) {
+            qCDebug(simulationLog) << (event.blueTeam ? "Blue flag captured!" : "Red flag captured!");
+        }
+        else if (event.type == GameEventType::FlagReset) {
+            qCDebug(simulationLog) << (event.blueTeam ? "Red flag reset!" : "Blue flag reset!");
+        }
+    });
+}
+
+void Simulation::buildTickGraph() {
+    tickGraph.clear();
+    graphBlueCount = static_cast<int>(blueAgents.size());
+    graphRedCount = static_cast<int>(redAgents.size());
+
+    allAgents.clear();
+    for (const auto& agent : blueAgents) {
+        allAgents.push_back(agent.get());
+    }
+    for (const auto& agent : redAgents) {
+        allAgents.push_back(agent.get());
+    }
+
+    int snapshotPhase = tickGraph.addPhase("snapshot");
+    int influencePhase = tickGraph.addPhase("influence");
+    int perceptionPhase = tickGraph.addPhase("perception");
+    int decisionPhase = tickGraph.addPhase("decision");
+    int planningPhase = tickGraph.addPhase("planning");
+    int movementPhase = tickGraph.addPhase("movement");
+    int avoidancePhase = tickGraph.addPhase("avoidance");
+    int rulesPhase = tickGraph.addPhase("rules");
+
+    // Positions are copied once so agents moving in parallel never see each other mid-tick
+    int snapshot = tickGraph.addTask(snapshotPhase, [this]() {
+        copyAgentPositions(blueAgents, blueAgentPositions);
+        copyAgentPositions(redAgents, redAgentPositions);
+        blueGrid.build(blueAgentPositions);
+        redGrid.build(redAgentPositions);
+        decisionsThisTick = 0;
+    });
+
+    // Influence only hears about agents that changed map cell. It runs next
+    // to perception, which moves no one, and is ready before anyone decides.
+    int influence = tickGraph.addTask(influencePhase, [this]() {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < allAgents.size(); ++i) {
+            Agent* agent = allAgents[i];
+            influenceMap.place(i, agent->getX(), agent->getY(), !agent->isTagged());
+        }
+        influenceMap.propagate();
+        influenceMap.addUpdateMillis(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    });
+    influenceMap.resize(blueAgents.size(), redAgents.size());
+
+    // Sightings reach each team's memory once every agent has looked, so
+    // decisions all read the same tracks
+    int publishSightings = tickGraph.addTask(perceptionPhase, [this]() {
+        long long tick = gameManager->getClock().getTick();
+        blueBlackboard->publish(tick);
+        redBlackboard->publish(tick);
+    });
+
+    // Rules see everyone where they ended the tick. Tag targets are all
+    // chosen before any intruder is credited, then the outcomes are applied
+    // in agent order.
+    int rulesGrid = tickGraph.addTask(rulesPhase, [this]() {
+        copyAgentPositions(blueAgents, blueRulePositions);
+        copyAgentPositions(redAgents, redRulePositions);
+        blueGrid.build(blueRulePositions);
+        redGrid.build(redRulePositions);
+        tagManager.setTaggingDistance(taggingDistance);
+    });
+    int targetsChosen = tickGraph.addTask(rulesPhase, []() {});
+    int rules = tickGraph.addTask(rulesPhase, [this]() {
+        applyRules();
+
+        int decisions = decisionsThisTick;
+        decisionLoad.ticks++;
+        decisionLoad.decisions += decisions;
+        decisionLoad.peak = std::max(decisionLoad.peak, decisions);
+        decisionLoad.sumOfSquares += static_cast<double>(decisions) * decisions;
+    });
+    ruleIntents.resize(allAgents.size());
+    tagManager.resize(allAgents.size());
+
+    // Every agent's step is recorded before anyone is moved aside
+    int avoidanceGrid = tickGraph.addTask(avoidancePhase, [this]() {
+        if (collisionAvoidance) {
+            avoidance.buildGrid();
+        }
+    });
+    avoidance.resize(allAgents.size());
+
+    // Neighbor lists keep their capacity from tick to tick
+    agentNeighbors.resize(allAgents.size());
+    decidesThisTick.assign(allAgents.size(), 1);
+    utilityBrain.resize(allAgents.size());
+    utilityPending.assign(allAgents.size(), 0);
+    policyFeatures.assign(allAgents.size() * PolicyNetwork::featureCount, 0.0f);
+    policyMasks.assign(allAgents.size(), 0);
+    policyDecisions.assign(allAgents.size(), 0);
+    policyAgents.assign(allAgents.size(), 0);
+
+    // Enough batches to keep every worker busy, but few enough that task
+    // overhead stays small with a hundred thousand agents
+    size_t batchesPerWorker = 8;
+    size_t agentBatchSize = std::max<size_t>(minAgentBatchSize, allAgents.size() / (batchesPerWorker * tickGraph.getWorkerCount()));
+
+    // Each batch only writes its own agents, so batches run the per-agent phases independently
+    perceptionScratch.resize((allAgents.size() + agentBatchSize - 1) / agentBatchSize);
+    policyScratch.resize(perceptionScratch.size());
+    for (size_t begin = 0; begin < allAgents.size(); begin += agentBatchSize) {
+        size_t end = std::min(allAgents.size(), begin + agentBatchSize);
+        PerceptionScratch* scratch = &perceptionScratch[begin / agentBatchSize];
+
+        // Agents between decisions keep their last decision and path and skip straight to moving
+        int perception = tickGraph.addTask(perceptionPhase, [this, begin, end, scratch]() {
+            long long tick = gameManager->getClock().getTick();
+            int decisions = 0;
+            for (size_t i = begin; i < end; ++i) {
+                decidesThisTick[i] = needsDecision(i, tick);
+                if (decidesThisTick[i]) {
+                    perceive(i, *scratch);
+                    decisions++;
+                }
+            }
+            decisionsThisTick += decisions;
+        });
+        tickGraph.addDependency(perception, publishSightings);
+        PolicyScratch* policy = &policyScratch[begin / agentBatchSize];
+        int decision = tickGraph.addTask(decisionPhase, [this, begin, end, policy]() {
+            // Utility, tree and policy teams hand their inputs over and take
+            // their decisions once the whole batch is scored, ticked or evaluated
+            bool anyUtility = false;
+            bool anyTree = false;
+            size_t policyRows = 0;
+            size_t bluePolicyRows = 0;
+            for (size_t i = begin; i < end; ++i) {
+                utilityPending[i] = 0;
+                behaviourBlackboards[i].pending = 0;
+                if (!decidesThisTick[i]) {
+                    continue;
+                }
+                Agent* agent = allAgents[i];
+                bool blue = agent->getSide() == "blue";
+                BrainBackend backend = blue ? blueBrainBackend : redBrainBackend;
+                if (backend == BrainBackend::Rules) {
+                    agent->decide(agentNeighbors[i]);
+                    continue;
+                }
+                DecisionInputs inputs;
+                if (!agent->beginDecision(agentNeighbors[i], inputs)) {
+                    continue;
+                }
+                float proximityThreshold = agent->getBrain()->getProximityThreshold();
+                if (backend == BrainBackend::Utility) {
+                    utilityBrain.setInputs(i, blue ? 0 : 1, inputs, proximityThreshold);
+                    utilityPending[i] = 1;
+                    anyUtility = true;
+                }
+                else if (backend == BrainBackend::BehaviourTree) {
+                    behaviourBlackboards[i].facts = BehaviourTree::getFacts(inputs, proximityThreshold);
+                    behaviourBlackboards[i].pending = 1;
+                    anyTree = true;
+                }
+                else {
+                    size_t row = begin + policyRows++;
+                    PolicyNetwork::getFeatures(inputs, blue ? 0 : 1, proximityThreshold, &policyFeatures[row * PolicyNetwork::featureCount]);
+                    policyMasks[row] = PolicyNetwork::getActionMask(inputs, proximityThreshold);
+                    policyAgents[row] = static_cast<uint32_t>(i);
+                    bluePolicyRows += blue ? 1 : 0;
+                }
+            }
+            if (anyUtility) {
+                utilityBrain.score(begin, end);
+                for (size_t i = begin; i < end; ++i) {
+                    if (utilityPending[i]) {
+                        allAgents[i]->finishDecision(utilityBrain.getDecision(i));
+                    }
+                }
+            }
+            if (anyTree) {
+                // Blue agents come first, so the batch is at most one run of each team
+                size_t split = std::min(end, std::max(begin, static_cast<size_t>(graphBlueCount)));
+                blueBehaviourTree.tick(behaviourBlackboards.data() + begin, split - begin);
+                redBehaviourTree.tick(behaviourBlackboards.data() + split, end - split);
+                for (size_t i = begin; i < end; ++i) {
+                    if (behaviourBlackboards[i].pending) {
+                        allAgents[i]->finishDecision(static_cast<BrainDecision>(behaviourBlackboards[i].decision));
+                    }
+                }
+            }
+            if (policyRows > 0) {
+                size_t redBegin = begin + bluePolicyRows;
+                bluePolicy.evaluate(&policyFeatures[begin * PolicyNetwork::featureCount], &policyMasks[begin], bluePolicyRows, *policy, &policyDecisions[begin]);
+                redPolicy.evaluate(&policyFeatures[redBegin * PolicyNetwork::featureCount], &policyMasks[redBegin], policyRows - bluePolicyRows, *policy, &policyDecisions[redBegin]);
+                for (size_t row = begin; row < begin + policyRows; ++row) {
+                    allAgents[policyAgents[row]]->finishDecision(static_cast<BrainDecision>(policyDecisions[row]));
+                }
+            }
+        });
+        int planning = tickGraph.addTask(planningPhase, [this, begin, end]() {
+            for (size_t i = begin; i < end; ++i) {
+                if (decidesThisTick[i]) {
+                    allAgents[i]->planPath();
+                }
+            }
+        });
+        int movement = tickGraph.addTask(movementPhase, [this, begin, end]() {
+            for (size_t i = begin; i < end; ++i) {
+                Agent* agent = allAgents[i];
+                float startX = agent->getPositionX();
+                float startY = agent->getPositionY();
+                agent->followPath();
+                avoidance.recordStep(i, startX, startY, agent->getPositionX(), agent->getPositionY(), agent->getCellsPerTick(), agent->isEnabled());
+            }
+        });
+        int avoid = tickGraph.addTask(avoidancePhase, [this, begin, end]() {
+            if (collisionAvoidance) {
+                avoidance.resolve(begin, end);
+                for (size_t i = begin; i < end; ++i) {
+                    if (avoidance.isActive(i)) {
+                        allAgents[i]->setPosition(avoidance.getResultX(i), avoidance.getResultY(i));
+                    }
+                }
+            }
+            for (size_t i = begin; i < end; ++i) {
+                Agent* agent = allAgents[i];
+                agent->updateStuckTimer(std::hypot(agent->getPositionX() - avoidance.getStartX(i), agent->getPositionY() - avoidance.getStartY(i)));
+            }
+        });
+
+        int intents = tickGraph.addTask(rulesPhase, [this, begin, end]() {
+            for (size_t i = begin; i < end; ++i) {
+                ruleIntents[i] = allAgents[i]->submitIntent();
+            }
+        });
+        int targets = tickGraph.addTask(rulesPhase, [this, begin, end]() {
+            tagManager.chooseTargets(ruleIntents, blueGrid, redGrid, blueAgents.size(), begin, end);
+        });
+        int tags = tickGraph.addTask(rulesPhase, [this, begin, end]() {
+            tagManager.resolveTags(ruleIntents, blueGrid, redGrid, blueAgents.size(), begin, end);
+        });
+
+        tickGraph.addDependency(snapshot, perception);
+        tickGraph.addDependency(publishSightings, decision);
+        tickGraph.addDependency(decision, planning);
+        tickGraph.addDependency(planning, movement);
+        tickGraph.addDependency(movement, avoidanceGrid);
+        tickGraph.addDependency(avoidanceGrid, avoid);
+        tickGraph.addDependency(avoid, intents);
+        tickGraph.addDependency(intents, rulesGrid);
+        tickGraph.addDependency(rulesGrid, targets);
+        tickGraph.addDependency(targets, targetsChosen);
+        tickGraph.addDependency(targetsChosen, tags);
+        tickGraph.addDependency(tags, rules);
+    }
+
+    tickGraph.addDependency(snapshot, influence);
+    tickGraph.addDependency(influence, publishSightings);
+
+    // With no agents the rules still follow the snapshot
+    if (allAgents.empty()) {
+        tickGraph.addDependency(snapshot, avoidanceGrid);
+        tickGraph.addDependency(avoidanceGrid, rulesGrid);
+        tickGraph.addDependency(rulesGrid, targetsChosen);
+        tickGraph.addDependency(targetsChosen, rules);
+    }
+
+    ticksSinceTimingLog = 0;
+}
+
+void Simulation::step() {
+    if (finished) {
+        return;
+    }
+
+    // Between ticks, so a whole tick runs on one set of parameters
+    GameParams reloaded;
+    if (paramsWatcher && paramsWatcher->takeUpdate(reloaded)) {
+        setParams(reloaded);
+        paramsReloadCount++;
+    }
+
+    tickGraph.run();
+    gameManager->getClock().advance();
+
+    if (++ticksSinceTimingLog >= phaseTimingLogInterval) {
+        logPhaseTimings();
+        tickGraph.resetPhaseTimings();
+        ticksSinceTimingLog = 0;
+    }
+
+    // Check if the game has ended
+    if (getTimeRemaining() <= 0) {
+        stop();
+    }
+}
+
+long long Simulation::advance(long long maxTicks) {
+    if (finished || maxTicks <= 0) {
+        return 0;
+    }
+
+    // The full tick decides, plans and applies rules; the skip only repeats its walking
+    step();
+    if (!eventSkipping || finished || maxTicks == 1) {
+        return 1;
+    }
+    if (ticksUntilSkipCheck > 0) {
+        ticksUntilSkipCheck--;
+        return 1;
+    }
+
+    // The tick that ends the match always runs normally
+    long long quietTicks = findQuietTicks(std::min(maxTicks - 1, getTicksUntilEnd() - 1));
+    if (quietTicks <= 0) {
+        skipCheckBackoff = std::min(skipCheckBackoff * 2, maxSkipCheckBackoff);
+        ticksUntilSkipCheck = skipCheckBackoff - 1;
+        return 1;
+    }
+    skipCheckBackoff = 1;
+
+    for (Agent* agent : allAgents) {
+        agent->fastForward(quietTicks);
+    }
+    gameManager->getClock().advance(quietTicks);
+    skippedTicks += quietTicks;
+    return 1 + quietTicks;
+}
+
+long long Simulation::findQuietTicks(long long limit) {
+    if (limit <= 0 || blueBrainBackend != BrainBackend::Rules || redBrainBackend != BrainBackend::Rules) {
+        return 0;
+    }
+
+    // Earliest event any agent can cause on its own. The grids still hold
+    // this tick's final positions, since rules never move anyone.
+    auto anyCarrying = [](const std::vector<std::shared_ptr<Agent>>& agents) {
+        return std::any_of(agents.begin(), agents.end(), [](const std::shared_ptr<Agent>& agent) { return agent->isCarryingFlag(); });
+    };
+    bool blueCarrying = anyCarrying(blueAgents);
+    bool redCarrying = anyCarrying(redAgents);
+
+    // Anyone already in view range of an opponent could see it any tick, so
+    // skipping needs every opponent out of range, and then nobody sees anyone
+    static const std::vector<std::pair<int, int>> nobodyInView;
+    long long quietTicks = limit;
+    bool allOnCells = true;
+    movingAgents.clear();
+    for (size_t i = 0; i < allAgents.size(); ++i) {
+        Agent* agent = allAgents[i];
+        bool blue = agent->getSide() == "blue";
+        if (agent->isEnabled()) {
+            bool opponentInRange = false;
+            (blue ? redGrid : blueGrid).forEachInRadius(agent->getX(), agent->getY(), static_cast<int>(std::ceil(getEffectiveViewRange(agent))), [&opponentInRange](int) {
+                opponentInRange = true;
+                return false;
+            });
+            if (opponentInRange) {
+                return 0;
+            }
+        }
+        quietTicks = std::min(quietTicks, agent->getQuietTicks(nobodyInView, blue ? blueCarrying : redCarrying, quietTicks));
+        if (quietTicks == 0) {
+            return 0;
+        }
+        if (agent->isFollowingPath()) {
+            movingAgents.push_back(agent);
+        }
+        allOnCells &= agent->getPositionX() == agent->getX() && agent->getPositionY() == agent->getY();
+    }
+
+    // Avoidance acts on any pair close enough to touch within the tick, so
+    // such a pair keeps the match stepping
+    const double cellsPerTick = movementSpeed * gameManager->getClock().getTickMillis() / 1000.0;
+    const float avoidanceRadius = CollisionAvoidance::getInteractionRadius(static_cast<float>(cellsPerTick));
+    if (collisionAvoidance) {
+        int radius = static_cast<int>(std::ceil(avoidanceRadius));
+        for (Agent* agent : allAgents) {
+            if (!agent->isEnabled()) {
+                continue;
+            }
+            bool touching = false;
+            auto findTouching = [&](const SpatialGrid& grid, const std::vector<std::shared_ptr<Agent>>& agents) {
+                grid.forEachInRadius(agent->getX(), agent->getY(), radius, [&](int index) {
+                    const Agent* other = agents[index].get();
+                    if (other != agent && other->isEnabled()) {
+                        touching = true;
+                    }
+                    return !touching;
+                });
+            };
+            findTouching(blueGrid, blueAgents);
+            findTouching(redGrid, redAgents);
+            if (touching) {
+                return 0;
+            }
+        }
+    }
+
+    // Walkers hold their direction until their next corner, so two agents
+    // close in at the constant speed of their relative motion. No pair may
+    // cross the tagging, decision, close perception, view or avoidance distance.
+    // Fractional positions round to cells, which costs a little distance of margin.
+    const double roundingSlack = cellsPerTick == 1.0 && allOnCells ? 0.0 : 1.5;
+    const double maxClosingSpeed = (movingAgents.size() > 1 ? 2.0 : 1.0) * cellsPerTick;
+    for (Agent* agent : movingAgents) {
+        const double thresholds[] = { taggingDistance, agent->getBrain()->getProximityThreshold(), static_cast<double>(closeRadius),
+            collisionAvoidance ? avoidanceRadius : 0.0, getEffectiveViewRange(agent), static_cast<double>(perceptionRadius) };
+        double farthestThreshold = *std::max_element(std::begin(thresholds), std::end(thresholds));
+        std::pair<int, int> direction = agent->getStepDirection();
+
+        // Anyone beyond this radius cannot reach a threshold within quietTicks
+        double reach = std::ceil(farthestThreshold) + maxClosingSpeed * (quietTicks + 1);
+        int radius = static_cast<int>(std::min<double>(reach, gameFieldWidth + gameFieldHeight));
+
+        auto checkAgainst = [&](const SpatialGrid& grid, const std::vector<std::shared_ptr<Agent>>& agents) {
+            grid.forEachInRadius(agent->getX(), agent->getY(), radius, [&](int index) {
+                const Agent* other = agents[index].get();
+                std::pair<int, int> otherDirection = other->getStepDirection();
+                double closingSpeed = std::hypot(otherDirection.first - direction.first, otherDirection.second - direction.second) * cellsPerTick;
+                if (other == agent || closingSpeed == 0.0) {
+                    return true;
+                }
+
+                // The other agent's own view range counts too
+                double distance = agent->distanceTo(other);
+                auto closeGap = [&](double threshold) {
+                    long long gap = static_cast<long long>(std::floor(std::max(0.0, std::abs(distance - threshold) - roundingSlack) / closingSpeed)) - 1;
+                    quietTicks = std::min(quietTicks, std::max(0LL, gap));
+                };
+                for (double threshold : thresholds) {
+                    closeGap(threshold);
+                }
+                closeGap(getEffectiveViewRange(other));
+                return quietTicks > 0;
+            });
+        };
+        checkAgainst(blueGrid, blueAgents);
+        checkAgainst(redGrid, redAgents);
+        if (quietTicks == 0) {
+            return 0;
+        }
+    }
+
+    return quietTicks;
+}
+
+long long Simulation::getTicksUntilEnd() const {
+    // First tick at which getTimeRemaining() drops to zero
+    long long tickMillis = gameManager->getClock().getTickMillis();
+    long long endTick = (static_cast<long long>(gameDuration) * 1000 + tickMillis - 1) / tickMillis;
+    return std::max(0LL, endTick - gameManager->getClock().getTick());
+}
+
+void Simulation::stop() {
+    finished = true;
+
+    for (const auto& agent : blueAgents) {
+        agent->setEnabled(false);
+    }
+
+    for (const auto& agent : redAgents) {
+        agent->setEnabled(false);
+    }
+}
+
+int Simulation::getTimeRemaining() const {
+    return gameDuration - static_cast<int>(gameManager->getClock().getElapsedMillis() / 1000);
+}
+
+void Simulation::handleFlagCapture(const std::string& side) {
+    // The capturing team scores and every carrier on that team drops the flag
+    if (side == "blue") {
+        blueScore++;
+        stats.blueCaptures++;
+        for (const auto& agent : blueAgents) {
+            agent->setCarryingFlag(false);
+        }
+    }
+    else if (side == "red") {
+        redScore++;
+        stats.redCaptures++;
+        for (const auto& agent : redAgents) {
+            agent->setCarryingFlag(false);
+        }
+    }
+}
+
+void Simulation::applyRules() {
+    GameEventBuffer& events = gameManager->getEvents();
+    long long tick = getTick();
+
+    // Tags first, so a carrier tagged this tick drops the flag in the same pass
+    for (size_t i = 0; i < allAgents.size(); ++i) {
+        int tagger = tagManager.getTagger(i);
+        if (tagger < 0) {
+            continue;
+        }
+        Agent* taggerAgent = allAgents[tagger];
+        allAgents[i]->setIsTagged(true);
+        ruleIntents[i].tagged = true;
+        if (tagManager.isChosenTag(i)) {
+            taggerAgent->setCooldownTimer(static_cast<int>(gameManager->getClock().secondsToTicks(taggerAgent->getCooldownDuration())));
+        }
+        events.push(GameEvent{ tick, taggerAgent->getId(), allAgents[i]->getId(), GameEventType::AgentTagged, ruleIntents[tagger].blueTeam });
+    }
+
+    flagManager.resolve(ruleIntents, blueGrid, redGrid, blueAgents.size(), *gameManager);
+    for (int i : flagManager.getDrops()) {
+        allAgents[i]->setCarryingFlag(false);
+        events.push(GameEvent{ tick, allAgents[i]->getId(), -1, GameEventType::FlagReset, ruleIntents[i].blueTeam });
+    }
+    for (int i : flagManager.getCaptures()) {
+        allAgents[i]->setCarryingFlag(false);
+        events.push(GameEvent{ tick, allAgents[i]->getId(), -1, GameEventType::FlagCaptured, ruleIntents[i].blueTeam });
+        events.push(GameEvent{ tick, allAgents[i]->getId(), -1, GameEventType::FlagReset, ruleIntents[i].blueTeam });
+    }
+    for (int i : flagManager.getGrabs()) {
+        allAgents[i]->setCarryingFlag(true);
+        events.push(GameEvent{ tick, allAgents[i]->getId(), -1, GameEventType::FlagGrabbed, ruleIntents[i].blueTeam });
+    }
+
+    applyRuleEvents();
+    logEvents();
+}
+
+bool Simulation::needsDecision(size_t agentIndex, long long tick) const {
+    Agent* agent = allAgents[agentIndex];
+    if (decisionInterval <= 1 || (tick + agent->getId()) % decisionInterval == 0 || agent->hasStateChangedSinceDecision()) {
+        return true;
+    }
+
+    // Near either flag
+    int x = agent->getX();
+    int y = agent->getY();
+    const GameManager& manager = *gameManager;
+    for (const auto& flagPosition : { manager.getFlagPosition("blue"), manager.getFlagPosition("red") }) {
+        if (std::hypot(flagPosition.first - x, flagPosition.second - y) <= contactRadius) {
+            return true;
+        }
+    }
+
+    // Near any enemy
+    bool enemyNearby = false;
+    const SpatialGrid& enemyGrid = agent->getSide() == "blue" ? redGrid : blueGrid;
+    enemyGrid.forEachInRadius(x, y, contactRadius, [&enemyNearby](int) {
+        enemyNearby = true;
+        return false;
+    });
+    return enemyNearby;
+}
+
+void Simulation::perceive(size_t agentIndex, PerceptionScratch& scratch) {
+    Agent* agent = allAgents[agentIndex];
+    std::vector<std::pair<int, int>>& neighbors = agentNeighbors[agentIndex];
+    neighbors.clear();
+    if (!agent->isEnabled()) {
+        return;
+    }
+
+    bool blue = agent->getSide() == "blue";
+    const SpatialGrid& enemyGrid = blue ? redGrid : blueGrid;
+    const std::vector<std::shared_ptr<Agent>>& enemies = blue ? redAgents : blueAgents;
+    std::pair<int, int> facing = agent->getFacing();
+    Viewer viewer = { agent->getX(), agent->getY(), static_cast<float>(facing.first), static_cast<float>(facing.second),
+        getEffectiveViewRange(agent), agent->getViewHalfAngleCosine(), static_cast<float>(closeRadius) };
+    perception.perceive(viewer, enemyGrid, maxNeighbors, scratch);
+
+    // Everyone in view goes to the team in this agent's slot, and is what it decides on
+    const std::vector<std::pair<int, int>>& positions = enemyGrid.getPositions();
+    for (int index : scratch.visible) {
+        neighbors.push_back(positions[index]);
+        agent->reportSighting(*enemies[index], positions[index].first, positions[index].second);
+    }
+}
+
+namespace {
+    // FNV-1a, enough to catch truncated or damaged snapshot files
+    uint64_t snapshotChecksum(const uint8_t* data, size_t size) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ data[i]) * 1099511628211ULL;
+        }
+        return hash;
+    }
+}
+
+void Simulation::saveSnapshot(std::vector<uint8_t>& buffer) const {
+    buffer.clear();
+    BinaryWriter writer(buffer);
+
+    // Header: magic, version, payload length, payload checksum
+    writer.writeUInt32(snapshotMagic);
+    writer.writeUInt32(snapshotVersion);
+    writer.writeUInt64(0);
+    writer.writeUInt64(0);
+
+    writer.writeInt32(gameFieldWidth);
+    writer.writeInt32(gameFieldHeight);
+    gameManager->saveState(writer);
+
+    writer.writeInt32(gameDuration);
+    writer.writeBool(finished);
+    writer.writeInt32(blueScore);
+    writer.writeInt32(redScore);
+    for (int value : { stats.blueCaptures, stats.redCaptures, stats.blueGrabs, stats.redGrabs, stats.flagResets, stats.blueTags, stats.redTags }) {
+        writer.writeInt32(value);
+    }
+    writer.writeFloat(taggingDistance);
+    writer.writeFloat(movementSpeed);
+    writer.writeBool(collisionAvoidance);
+    writer.writeInt32(static_cast<int>(blueBrainBackend));
+    writer.writeInt32(static_cast<int>(redBrainBackend));
+    blueBehaviourTree.saveState(writer);
+    redBehaviourTree.saveState(writer);
+    bluePolicy.saveState(writer);
+    redPolicy.saveState(writer);
+
+    writer.writeInt32(decisionInterval);
+    writer.writeInt64(decisionLoad.ticks);
+    writer.writeInt64(decisionLoad.decisions);
+    writer.writeInt32(decisionLoad.peak);
+    writer.writeDouble(decisionLoad.sumOfSquares);
+    writer.writeBool(eventSkipping);
+    writer.writeInt64(skippedTicks);
+    writer.writeInt32(skipCheckBackoff);
+    writer.writeInt32(ticksUntilSkipCheck);
+    writer.writeInt32(ticksSinceTimingLog);
+
+    writer.writeUInt32(static_cast<uint32_t>(blueAgents.size()));
+    writer.writeUInt32(static_cast<uint32_t>(redAgents.size()));
+    for (const auto& agent : blueAgents) {
+        agent->saveState(writer);
+    }
+    for (const auto& agent : redAgents) {
+        agent->saveState(writer);
+    }
+    blueBlackboard->saveState(writer);
+    redBlackboard->saveState(writer);
+    // Facts are filled in again before every tick of a tree
+    for (const BehaviourBlackboard& blackboard : behaviourBlackboards) {
+        writer.writeVarUInt(blackboard.startFacts);
+        writer.writeVarInt(blackboard.runningNode);
+        writer.writeVarUInt(blackboard.ticksLeft);
+        writer.writeUInt8(blackboard.decision);
+    }
+
+    uint64_t payloadSize = buffer.size() - snapshotHeaderSize;
+    uint64_t checksum = snapshotChecksum(buffer.data() + snapshotHeaderSize, payloadSize);
+    writer.patchUInt32(8, static_cast<uint32_t>(payloadSize));
+    writer.patchUInt32(12, static_cast<uint32_t>(payloadSize >> 32));
+    writer.patchUInt32(16, static_cast<uint32_t>(checksum));
+    writer.patchUInt32(20, static_cast<uint32_t>(checksum >> 32));
+}
+
+bool Simulation::checkSnapshot(const std::vector<uint8_t>& buffer, int& gameFieldWidth, int& gameFieldHeight, std::string& error) {
+    BinaryReader reader(buffer.data(), buffer.size());
+    uint32_t magic = reader.readUInt32();
+    uint32_t version = reader.readUInt32();
+    uint64_t payloadSize = reader.readUInt64();
+    uint64_t checksum = reader.readUInt64();
+
+    if (reader.hasFailed() || magic != snapshotMagic) {
+        error = "Not a match snapshot";
+        return false;
+    }
+    if (version != snapshotVersion) {
+        error = "Snapshot version " + std::to_string(version) + " is not supported, expected " + std::to_string(snapshotVersion);
+        return false;
+    }
+    if (payloadSize != reader.getRemaining()) {
+        error = "Snapshot is truncated";
+        return false;
+    }
+    if (snapshotChecksum(buffer.data() + snapshotHeaderSize, payloadSize) != checksum) {
+        error = "Snapshot checksum does not match";
+        return false;
+    }
+
+    gameFieldWidth = reader.readInt32();
+    gameFieldHeight = reader.readInt32();
+    return !reader.hasFailed();
+}
+
+bool Simulation::restoreSnapshot(const std::vector<uint8_t>& buffer, std::string& error) {
+    int snapshotWidth = 0;
+    int snapshotHeight = 0;
+    if (!checkSnapshot(buffer, snapshotWidth, snapshotHeight, error)) {
+        return false;
+    }
+    if (snapshotWidth != gameFieldWidth || snapshotHeight != gameFieldHeight) {
+        error = "Snapshot is for a " + std::to_string(snapshotWidth) + " x " + std::to_string(snapshotHeight) + " field";
+        return false;
+    }
+
+    // Everything is read into scratch objects first and the match is only
+    // touched once the whole payload has been accepted
+    BinaryReader reader(buffer.data() + snapshotHeaderSize, buffer.size() - snapshotHeaderSize);
+    reader.readInt32();
+    reader.readInt32();
+    size_t managerOffset = reader.getOffset();
+    auto loadedManager = std::make_shared<GameManager>(gameFieldWidth, gameFieldHeight);
+    loadedManager->loadState(reader);
+
+    int loadedGameDuration = reader.readInt32();
+    bool loadedFinished = reader.readBool();
+    int loadedBlueScore = reader.readInt32();
+    int loadedRedScore = reader.readInt32();
+    MatchStats loadedStats;
+    for (int* value : { &loadedStats.blueCaptures, &loadedStats.redCaptures, &loadedStats.blueGrabs, &loadedStats.redGrabs, &loadedStats.flagResets, &loadedStats.blueTags, &loadedStats.redTags }) {
+        *value = reader.readInt32();
+    }
+    float loadedTaggingDistance = reader.readFloat();
+    float loadedMovementSpeed = reader.readFloat();
+    bool loadedCollisionAvoidance = reader.readBool();
+    int loadedBackends[2] = { reader.readInt32(), reader.readInt32() };
+    for (int backend : loadedBackends) {
+        if (backend < static_cast<int>(BrainBackend::Rules) || backend > static_cast<int>(BrainBackend::Policy)) {
+            error = "Snapshot brain backends are unknown";
+            return false;
+        }
+    }
+    BehaviourTree loadedBlueTree;
+    BehaviourTree loadedRedTree;
+    if (!loadedBlueTree.loadState(reader) || !loadedRedTree.loadState(reader)) {
+        error = "Snapshot behaviour trees are malformed";
+        return false;
+    }
+    PolicyNetwork loadedBluePolicy;
+    PolicyNetwork loadedRedPolicy;
+    if (!loadedBluePolicy.loadState(reader) || !loadedRedPolicy.loadState(reader)) {
+        error = "Snapshot policy networks are malformed";
+        return false;
+    }
+
+    int loadedDecisionInterval = std::max(1, reader.readInt32());
+    DecisionLoad loadedDecisionLoad;
+    loadedDecisionLoad.ticks = reader.readInt64();
+    loadedDecisionLoad.decisions = reader.readInt64();
+    loadedDecisionLoad.peak = reader.readInt32();
+    loadedDecisionLoad.sumOfSquares = reader.readDouble();
+    bool loadedEventSkipping = reader.readBool();
+    long long loadedSkippedTicks = reader.readInt64();
+    int loadedSkipCheckBackoff = reader.readInt32();
+    int loadedTicksUntilSkipCheck = reader.readInt32();
+    int loadedTicksSinceTimingLog = reader.readInt32();
+
+    uint32_t blueCount = reader.readUInt32();
+    uint32_t redCount = reader.readUInt32();
+    if (reader.hasFailed() || blueCount + static_cast<uint64_t>(redCount) > reader.getRemaining()) {
+        error = "Snapshot agent table is damaged";
+        return false;
+    }
+
+    // Agent and memory records only reveal their length as they are read,
+    // so one scratch agent and one scratch blackboard take them in turn
+    size_t agentsOffset = reader.getOffset();
+    std::vector<std::shared_ptr<Agent>> scratchBlueAgents;
+    std::vector<std::shared_ptr<Agent>> scratchRedAgents;
+    auto scratchBlackboard = std::make_shared<TeamBlackboard>();
+    Agent scratchAgent(0, 0, 0, "blue", gameFieldWidth, gameFieldHeight, pathfinder, loadedTaggingDistance, std::make_shared<Brain>(), scratchBlackboard, 0,
+        loadedManager, scratchBlueAgents, scratchRedAgents);
+    for (uint64_t i = 0; i < blueCount + static_cast<uint64_t>(redCount) && !reader.hasFailed(); ++i) {
+        scratchAgent.loadState(reader);
+    }
+    scratchBlackboard->loadState(reader);
+    scratchBlackboard->loadState(reader);
+    std::vector<BehaviourBlackboard> loadedBehaviourBlackboards(blueCount + static_cast<size_t>(redCount));
+    for (BehaviourBlackboard& blackboard : loadedBehaviourBlackboards) {
+        blackboard.startFacts = static_cast<uint16_t>(reader.readVarUInt());
+        blackboard.runningNode = static_cast<int16_t>(reader.readVarInt());
+        blackboard.ticksLeft = static_cast<uint16_t>(reader.readVarUInt());
+        blackboard.decision = reader.readUInt8();
+    }
+    if (reader.hasFailed() || reader.getRemaining() != 0) {
+        error = "Snapshot payload does not match its layout";
+        return false;
+    }
+
+    // Nothing below can fail. The manager, agents and memories read their
+    // records again, straight into the match.
+    BinaryReader state(buffer.data() + snapshotHeaderSize, buffer.size() - snapshotHeaderSize);
+    state.setOffset(managerOffset);
+    gameManager->loadState(state);
+    applyMemoryRetention();
+    applyUtilityWeights();
+    applyInfluenceRoutes();
+
+    gameDuration = loadedGameDuration;
+    finished = loadedFinished;
+    blueScore = loadedBlueScore;
+    redScore = loadedRedScore;
+    stats = loadedStats;
+    taggingDistance = loadedTaggingDistance;
+    movementSpeed = loadedMovementSpeed;
+    collisionAvoidance = loadedCollisionAvoidance;
+    blueBrainBackend = static_cast<BrainBackend>(loadedBackends[0]);
+    redBrainBackend = static_cast<BrainBackend>(loadedBackends[1]);
+    blueBehaviourTree = std::move(loadedBlueTree);
+    redBehaviourTree = std::move(loadedRedTree);
+    bluePolicy = std::move(loadedBluePolicy);
+    redPolicy = std::move(loadedRedPolicy);
+    decisionInterval = loadedDecisionInterval;
+    decisionLoad = loadedDecisionLoad;
+    eventSkipping = loadedEventSkipping;
+    skippedTicks = loadedSkippedTicks;
+    skipCheckBackoff = loadedSkipCheckBackoff;
+    ticksUntilSkipCheck = loadedTicksUntilSkipCheck;
+
+    // Agents are reused when the teams match, which keeps restore allocation free
+    bool rebuildAgents = blueAgents.size() != blueCount || redAgents.size() != redCount;
+    if (rebuildAgents) {
+        blueAgents.clear();
+        redAgents.clear();
+        for (uint32_t i = 0; i < blueCount; ++i) {
+            blueAgents.push_back(acquireAgent(static_cast<int>(i), 0, 0, "blue"));
+        }
+        for (uint32_t i = 0; i < redCount; ++i) {
+            redAgents.push_back(acquireAgent(static_cast<int>(blueCount + i), 0, 0, "red"));
+        }
+        blueBlackboard->resize(blueCount);
+        redBlackboard->resize(redCount);
+    }
+    state.setOffset(agentsOffset);
+    for (const auto& agent : blueAgents) {
+        agent->loadState(state);
+    }
+    for (const auto& agent : redAgents) {
+        agent->loadState(state);
+    }
+    blueBlackboard->loadState(state);
+    redBlackboard->loadState(state);
+    behaviourBlackboards = std::move(loadedBehaviourBlackboards);
+
+    if (rebuildAgents) {
+        buildTickGraph();
+    }
+    ticksSinceTimingLog = loadedTicksSinceTimingLog;
+    return true;
+}
+
+bool Simulation::saveSnapshotFile(const std::string& path, std::string& error) const {
+    std::vector<uint8_t> buffer;
+    saveSnapshot(buffer);
+
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file) {
+        error = "Could not open " + path + " for writing";
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+    if (!file) {
+        error = "Could not write " + path;
+        return false;
+    }
+    return true;
+}
+
+bool Simulation::restoreSnapshotFile(const std::string& path, std::string& error) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file) {
+        error = "Could not open " + path;
+        return false;
+    }
+    std::vector<uint8_t> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return restoreSnapshot(buffer, error);
+}
+
+std::unique_ptr<Simulation> Simulation::fromSnapshot(const std::vector<uint8_t>& buffer, int workerCount, std::string& error) {
+    int snapshotWidth = 0;
+    int snapshotHeight = 0;
+    if (!checkSnapshot(buffer, snapshotWidth, snapshotHeight, error)) {
+        return nullptr;
+    }
+
+    auto simulation = std::make_unique<Simulation>(snapshotWidth, snapshotHeight, GameManager::defaultMatchSeed, workerCount);
+    if (!simulation->restoreSnapshot(buffer, error)) {
+        return nullptr;
+    }
+    return simulation;
+}
+
+void Simulation::copyAgentPositions(const std::vector<std::shared_ptr<Agent>>& agents, std::vector<std::pair<int, int>>& positions) const {
+    // Refilled every tick into the same storage
+    positions.clear();
+    for (const auto& agent : agents) {
+        positions.emplace_back(agent->getX(), agent->getY());
+    }
+}
+
+void Simulation::logPhaseTimings() {
+    qCDebug(simulationLog) << "Tick phase timings over" << ticksSinceTimingLog << "ticks with" << tickGraph.getWorkerCount() << "workers:";
+    qCDebug(simulationLog) << "  decisions per tick mean:" << decisionLoad.getMean() << "peak:" << decisionLoad.peak
+        << "stddev:" << decisionLoad.getStdDev() << "interval:" << decisionInterval;
+    const InfluenceLoad& influenceLoad = influenceMap.getLoad();
+    qCDebug(simulationLog) << "  influence per tick ms:" << influenceLoad.getMeanMillis() << "moves:" << influenceLoad.getMovesPerUpdate()
+        << "blurred cells:" << influenceLoad.getBlurredCellsPerUpdate();
+    for (const PhaseTiming& timing : tickGraph.getPhaseTimings()) {
+        if (timing.runs == 0) {
+            continue;
+        }
+        qCDebug(simulationLog) << "  " << QString::fromStdString(timing.name)
+            << "tasks:" << timing.taskCount
+            << "wall ms:" << timing.totalWallMs / timing.runs
+            << "busy ms:" << timing.totalBusyMs / timing.runs;
+    }
+}
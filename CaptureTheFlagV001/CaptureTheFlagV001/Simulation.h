@@ -0,0 +1,303 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Agent.h"
+#include "BehaviourTree.h"
+#include "CollisionAvoidance.h"
+#include "FlagManager.h"
+#include "TagManager.h"
+#include "GameManager.h"
+#include "GameParams.h"
+#include "InfluenceMap.h"
+#include "ParamsWatcher.h"
+#include "Pathfinder.h"
+#include "Perception.h"
+#include "PolicyNetwork.h"
+#include "SpatialGrid.h"
+#include "TeamBlackboard.h"
+#include "TaskGraph.h"
+#include "UtilityBrain.h"
+
+// Counters for one match, filled from the rule events of every tick
+struct MatchStats {
+    int blueCaptures;
+    int redCaptures;
+    int blueGrabs;
+    int redGrabs;
+    int flagResets;
+    int blueTags;
+    int redTags;
+};
+
+// Decisions made per tick, to show how the decision level of detail spreads the load
+struct DecisionLoad {
+    long long ticks;
+    long long decisions;
+    int peak;
+    double sumOfSquares;
+
+    double getMean() const { return ticks > 0 ? static_cast<double>(decisions) / ticks : 0.0; }
+    double getStdDev() const {
+        double mean = getMean();
+        return ticks > 0 ? std::sqrt(std::max(0.0, sumOfSquares / ticks - mean * mean)) : 0.0;
+    }
+};
+
+// Headless match state and tick loop. Owns the agents and everything they
+// share, and knows nothing about rendering: GameField draws a Simulation
+// at display rate while stepping it at whatever speed it likes.
+class Simulation {
+public:
+    Simulation(int gameFieldWidth, int gameFieldHeight, uint64_t matchSeed = GameManager::defaultMatchSeed, int workerCount = 0);
+
+    // Agents come from a pool that lives as long as the simulation. Clearing
+    // hands them back and setupAgents reinitialises them in place, so a new
+    // match of the same size allocates nothing.
+    void clearAgents();
+    void setupAgents(int blueCount, int redCount);
+
+    // Starts the match over with a new seed: clock, flags, event cursors and
+    // the finished flag. Agents are set up again with setupAgents.
+    void resetMatch(uint64_t matchSeed);
+
+    // Puts the flags and team zones back in their default spots for this field size
+    void placeFlagsAndZones();
+
+    // Advances the match by exactly one fixed tick
+    void step();
+
+    // Steps one tick and then, with event skipping on, jumps over every
+    // following tick in which agents only walk known paths and count down
+    // cooldowns. Lands on the same state as stepping tick by tick. Returns
+    // the ticks advanced, never more than maxTicks.
+    long long advance(long long maxTicks);
+    void setEventSkipping(bool enabled) { eventSkipping = enabled; }
+    bool isEventSkipping() const { return eventSkipping; }
+    long long getSkippedTicks() const { return skippedTicks; }
+
+    // Decision level of detail: agents away from enemies and flags re-decide
+    // every interval ticks, staggered by id so each tick takes an even share.
+    // Agents near contact, or whose own state changed, decide every tick.
+    // An interval of 1 decides every agent every tick.
+    void setDecisionInterval(int ticks) { decisionInterval = std::max(1, ticks); }
+    int getDecisionInterval() const { return decisionInterval; }
+    const DecisionLoad& getDecisionLoad() const { return decisionLoad; }
+
+    // How each team decides, see BrainBackend. Utility teams are scored a
+    // whole batch at a time with their team's weights, tree teams tick
+    // their team's tree and policy teams evaluate their team's network.
+    // Utility and policy choices move with distance and trees count
+    // decisions, so event skipping stays off unless both teams use rules.
+    void setBrainBackend(const std::string& side, BrainBackend backend);
+    BrainBackend getBrainBackend(const std::string& side) const { return side == "blue" ? blueBrainBackend : redBrainBackend; }
+    // Weights are part of the game parameters, blue.utility.* and red.utility.*
+    void setUtilityWeights(const std::string& side, const UtilityWeights& weights);
+    const UtilityWeights& getUtilityWeights(const std::string& side) const { return side == "blue" ? getParams().blueUtility : getParams().redUtility; }
+    // Trees start as BehaviourTree::makeRulesTree. Only finished trees are
+    // taken; each agent's running action starts over with a new tree.
+    bool setBehaviourTree(const std::string& side, const BehaviourTree& tree, std::string& error);
+    const BehaviourTree& getBehaviourTree(const std::string& side) const { return side == "blue" ? blueBehaviourTree : redBehaviourTree; }
+    // Networks start as PolicyNetwork::makeRulesNetwork; only ready ones are taken
+    bool setPolicyNetwork(const std::string& side, const PolicyNetwork& network, std::string& error);
+    bool loadPolicyFile(const std::string& side, const std::string& path, std::string& error);
+    const PolicyNetwork& getPolicyNetwork(const std::string& side) const { return side == "blue" ? bluePolicy : redPolicy; }
+
+    // Rule and brain parameters, see GameParams. New parameters reach every
+    // agent at once, pooled ones included, and take effect from the next tick.
+    void setParams(const GameParams& params);
+    const GameParams& getParams() const { return gameManager->getParams(); }
+    bool loadParamsFile(const std::string& path, std::string& error);
+    // Loads path now, then reloads it whenever it changes. Reloads are read
+    // and parsed off the tick loop, and step picks up the newest one before
+    // its tick without ever waiting for the watcher.
+    bool watchParamsFile(const std::string& path, std::string& error);
+    void stopWatchingParams() { paramsWatcher.reset(); }
+    int getParamsReloadCount() const { return paramsReloadCount; }
+
+    // Coarse threat, control and carrier route danger for either team, up to
+    // date from the start of perception each tick
+    const InfluenceMap& getInfluenceMap() const { return influenceMap; }
+
+    // Agents walk movementSpeed cells per game second whatever the tick
+    // length, so a longer tick covers the same match in fewer ticks
+    void setMovementSpeed(float cellsPerSecond);
+    float getMovementSpeed() const { return movementSpeed; }
+    void setTickMillis(int millis);
+
+    // Agents step around each other after following their paths, see CollisionAvoidance
+    void setCollisionAvoidance(bool enabled) { collisionAvoidance = enabled; }
+
+    // Cells that block both paths and sight
+    void setObstacles(const std::vector<std::pair<int, int>>& obstacles);
+
+    bool isCollisionAvoidance() const { return collisionAvoidance; }
+    void stop();
+    bool isFinished() const { return finished; }
+
+    const std::shared_ptr<GameManager>& getGameManager() const { return gameManager; }
+    const std::shared_ptr<Pathfinder>& getPathfinder() const { return pathfinder; }
+    const std::vector<std::shared_ptr<Agent>>& getBlueAgents() const { return blueAgents; }
+    const std::vector<std::shared_ptr<Agent>>& getRedAgents() const { return redAgents; }
+    const TaskGraph& getTickGraph() const { return tickGraph; }
+    int getGameFieldWidth() const { return gameFieldWidth; }
+    int getGameFieldHeight() const { return gameFieldHeight; }
+    float getTaggingDistance() const { return taggingDistance; }
+    const MatchStats& getStats() const { return stats; }
+    int getBlueScore() const { return blueScore; }
+    int getRedScore() const { return redScore; }
+    int getGameDuration() const { return gameDuration; }
+    void setGameDuration(int seconds) { gameDuration = seconds; }
+    int getTimeRemaining() const;
+    long long getTick() const { return gameManager->getClock().getTick(); }
+    int getTickMillis() const { return gameManager->getClock().getTickMillis(); }
+
+    void handleFlagCapture(const std::string& side);
+
+    // Snapshots hold the whole match: clock, flags, scores, agents with their
+    // paths, timers and RNG positions, and each team's memory. A snapshot only restores onto
+    // a simulation of the same field size; agents are rebuilt if the team
+    // sizes differ. Stepping a restored match gives the same ticks as the
+    // original. Restore reads and checks the whole snapshot before touching
+    // anything, so a rejected one leaves the match as it was.
+    static const uint32_t snapshotVersion = 12;
+    void saveSnapshot(std::vector<uint8_t>& buffer) const;
+    bool restoreSnapshot(const std::vector<uint8_t>& buffer, std::string& error);
+    bool saveSnapshotFile(const std::string& path, std::string& error) const;
+    bool restoreSnapshotFile(const std::string& path, std::string& error);
+    static std::unique_ptr<Simulation> fromSnapshot(const std::vector<uint8_t>& buffer, int workerCount, std::string& error);
+
+private:
+    std::shared_ptr<Agent> acquireAgent(int id, int x, int y, const std::string& side);
+    static bool checkSnapshot(const std::vector<uint8_t>& buffer, int& gameFieldWidth, int& gameFieldHeight, std::string& error);
+    void applyRuleEvents();
+    void logEvents();
+    void buildTickGraph();
+    void applyMemoryRetention();
+    void applyUtilityWeights();
+    void applyInfluenceRoutes();
+    void applyRules();
+    void perceive(size_t agentIndex, PerceptionScratch& scratch);
+    float getEffectiveViewRange(const Agent* agent) const { return std::min(agent->getViewRange(), static_cast<float>(perceptionRadius)); }
+    long long findQuietTicks(long long limit);
+    bool needsDecision(size_t agentIndex, long long tick) const;
+    long long getTicksUntilEnd() const;
+    void logPhaseTimings();
+    void copyAgentPositions(const std::vector<std::shared_ptr<Agent>>& agents, std::vector<std::pair<int, int>>& positions) const;
+
+    int gameFieldWidth;
+    int gameFieldHeight;
+    std::shared_ptr<GameManager> gameManager;
+    std::shared_ptr<Pathfinder> pathfinder;
+    std::vector<std::shared_ptr<Agent>> blueAgents;
+    std::vector<std::shared_ptr<Agent>> redAgents;
+    // Every agent ever created, blue then red in id order, each with its own brain
+    std::vector<std::shared_ptr<Agent>> agentPool;
+    // Each team remembers opponents once, in memory shared by all its agents
+    std::shared_ptr<TeamBlackboard> blueBlackboard;
+    std::shared_ptr<TeamBlackboard> redBlackboard;
+    float taggingDistance;
+    float movementSpeed;
+    int blueScore;
+    int redScore;
+    MatchStats stats;
+    int gameDuration;
+    bool finished;
+
+    // Tick phases and the per-tick snapshot they read from
+    TaskGraph tickGraph;
+    std::vector<Agent*> allAgents;
+    // Team sizes the graph was built for, -1 before the first build; a new
+    // match with the same teams keeps its graph
+    int graphBlueCount;
+    int graphRedCount;
+    std::vector<std::pair<int, int>> blueAgentPositions;
+    std::vector<std::pair<int, int>> redAgentPositions;
+    std::vector<std::pair<int, int>> blueRulePositions;
+    std::vector<std::pair<int, int>> redRulePositions;
+    int ticksSinceTimingLog;
+    static const int minAgentBatchSize = 16;
+    static const int phaseTimingLogInterval = 10;
+
+    // Agents see opponents in their view cone and in line of sight, see
+    // Perception, and notice anyone within closeRadius whatever their facing.
+    // Sight reaches at most perceptionRadius, no further than contactRadius,
+    // so an agent skipped by the decision level of detail has nobody in view.
+    // Each agent keeps the nearest maxNeighbors it sees.
+    SpatialGrid blueGrid;
+    SpatialGrid redGrid;
+    Perception perception;
+    std::vector<PerceptionScratch> perceptionScratch;
+    std::vector<std::vector<std::pair<int, int>>> agentNeighbors;
+    static const int gridCellSize = 32;
+    static const int closeRadius = 16;
+    static const int perceptionRadius = 64;
+    static const int maxNeighbors = 32;
+
+    CollisionAvoidance avoidance;
+    bool collisionAvoidance;
+
+    // Kept up to date from the cells agents move between, see InfluenceMap
+    InfluenceMap influenceMap;
+
+    // One intent per agent, resolved by the tag and flag managers each tick
+    std::vector<RuleIntent> ruleIntents;
+    TagManager tagManager;
+    FlagManager flagManager;
+
+    // Where the rules pass and the log have read the event buffer up to
+    uint64_t ruleEventCursor;
+    uint64_t logEventCursor;
+
+    // Decision level of detail
+    int decisionInterval;
+    std::vector<char> decidesThisTick;
+    std::atomic<int> decisionsThisTick;
+    DecisionLoad decisionLoad;
+    static const int contactRadius = 64;
+
+    // Brain backends, the batch scorer with a slot per agent for utility
+    // teams, and each team's behaviour tree
+    BrainBackend blueBrainBackend;
+    BrainBackend redBrainBackend;
+    UtilityBrain utilityBrain;
+    std::vector<char> utilityPending;
+    BehaviourTree blueBehaviourTree;
+    BehaviourTree redBehaviourTree;
+    // Indexed like allAgents, kept for the whole match
+    std::vector<BehaviourBlackboard> behaviourBlackboards;
+    // Each team's network and the tick's feature matrix. A batch packs the
+    // rows of its deciding policy agents at the front of its own range,
+    // blue before red, so every batch multiplies one block of rows.
+    PolicyNetwork bluePolicy;
+    PolicyNetwork redPolicy;
+    std::vector<float> policyFeatures;
+    std::vector<uint8_t> policyMasks;
+    std::vector<uint8_t> policyDecisions;
+    std::vector<uint32_t> policyAgents;
+    std::vector<PolicyScratch> policyScratch;
+
+    // Reloads of the parameter file taken by step
+    std::unique_ptr<ParamsWatcher> paramsWatcher;
+    int paramsReloadCount;
+
+    // Event skipping state
+    bool eventSkipping;
+    long long skippedTicks;
+    std::vector<Agent*> movingAgents;
+
+    // Busy matches rarely go quiet, so failed checks back off exponentially
+    int skipCheckBackoff;
+    int ticksUntilSkipCheck;
+    static const int maxSkipCheckBackoff = 32;
+
+    static const uint32_t snapshotMagic = 0x53465443; // "CTFS"
+    static const size_t snapshotHeaderSize = 24;
+};
+
+#endif
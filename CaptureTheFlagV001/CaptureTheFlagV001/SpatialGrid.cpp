@@ -0,0 +1,32 @@
+#include "SpatialGrid.h"
+
+SpatialGrid::SpatialGrid(int gameFieldWidth, int gameFieldHeight, int cellSize)
+    : cellSize(std::max(1, cellSize)) {
+    columns = std::max(1, (gameFieldWidth + this->cellSize - 1) / this->cellSize);
+    rows = std::max(1, (gameFieldHeight + this->cellSize - 1) / this->cellSize);
+    cellStart.assign(static_cast<size_t>(columns) * rows + 1, 0);
+}
+
+void SpatialGrid::build(const std::vector<std::pair<int, int>>& newPositions) {
+    positions = newPositions;
+    entries.resize(positions.size());
+    entryPositions.resize(positions.size());
+    std::fill(cellStart.begin(), cellStart.end(), 0);
+
+    // Count per cell, shifted by one so the prefix sum lands on each cell's start
+    for (const auto& position : positions) {
+        cellStart[cellY(position.second) * columns + cellX(position.first) + 1]++;
+    }
+    for (size_t cell = 1; cell < cellStart.size(); ++cell) {
+        cellStart[cell] += cellStart[cell - 1];
+    }
+
+    // Scatter in index order so every cell keeps its entries sorted
+    cellCursor.assign(cellStart.begin(), cellStart.end() - 1);
+    for (int index = 0; index < static_cast<int>(positions.size()); ++index) {
+        int cell = cellY(positions[index].second) * columns + cellX(positions[index].first);
+        int entry = cellCursor[cell]++;
+        entries[entry] = index;
+        entryPositions[entry] = positions[index];
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+// Uniform bucket grid over agent positions, rebuilt from scratch each tick.
+// A counting sort packs every cell's entries next to each other, so a radius
+// query reads one short run per row instead of the whole team. Entries are
+// indices into the positions passed to build(), in their original order.
+class SpatialGrid {
+public:
+    SpatialGrid(int gameFieldWidth, int gameFieldHeight, int cellSize);
+
+    void build(const std::vector<std::pair<int, int>>& positions);
+
+    // Calls visit(index) for every position within radius of (x, y), cell by
+    // cell in row order, until visit returns false
+    template <typename Visitor>
+    void forEachInRadius(int x, int y, int radius, Visitor visit) const {
+        int minCellX = cellX(x - radius);
+        int maxCellX = cellX(x + radius);
+        int minCellY = cellY(y - radius);
+        int maxCellY = cellY(y + radius);
+        long long radiusSquared = static_cast<long long>(radius) * radius;
+
+        // Neighbouring cells of a row are neighbours in the entry array too,
+        // so each row of the query is one contiguous run
+        for (int cy = minCellY; cy <= maxCellY; ++cy) {
+            int rowBegin = cellStart[cy * columns + minCellX];
+            int rowEnd = cellStart[cy * columns + maxCellX + 1];
+            for (int entry = rowBegin; entry < rowEnd; ++entry) {
+                long long dx = entryPositions[entry].first - x;
+                long long dy = entryPositions[entry].second - y;
+                if (dx * dx + dy * dy <= radiusSquared) {
+                    if (!visit(entries[entry])) {
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+    // Appends every entry in the cells a radius query would read, without the
+    // distance test, for callers that filter many candidates at once
+    void gatherCandidates(int x, int y, int radius, std::vector<int>& candidates) const {
+        int minCellX = cellX(x - radius);
+        int maxCellX = cellX(x + radius);
+        for (int cy = cellY(y - radius); cy <= cellY(y + radius); ++cy) {
+            candidates.insert(candidates.end(), entries.begin() + cellStart[cy * columns + minCellX], entries.begin() + cellStart[cy * columns + maxCellX + 1]);
+        }
+    }
+
+    const std::vector<std::pair<int, int>>& getPositions() const { return positions; }
+    int getCellSize() const { return cellSize; }
+
+private:
+    int cellX(int x) const { return std::max(0, std::min(columns - 1, x / cellSize)); }
+    int cellY(int y) const { return std::max(0, std::min(rows - 1, y / cellSize)); }
+
+    int cellSize;
+    int columns;
+    int rows;
+    std::vector<std::pair<int, int>> positions;
+    std::vector<int> cellStart;
+    std::vector<int> entries;
+    std::vector<std::pair<int, int>> entryPositions;
+    std::vector<int> cellCursor;
+};
+
+#endif
@@ -1,32 +1,88 @@
 #include "TagManager.h"
-#include "Agent.h"
-#include "Pathfinder.h"
-#include <limits>
-#include <algorithm>
-
-void TagManager::tagEnemy(Agent* agent, std::vector<Agent*>& otherAgents) {
-    if (agent->isTagged() || agent->getCooldownTimer() > 0) {
-        return;
-    }
+#include "SpatialGrid.h"
+#include <cmath>
+
+TagManager::TagManager()
+    : taggingDistance(0.0f) {
+}
+
+void TagManager::resize(size_t agentCount) {
+    targets.assign(agentCount, -1);
+    taggers.assign(agentCount, -1);
 }
 
-void TagManager::handleTaggedAgent(Agent* agent, Pathfinder* pathfinder, GameManager* gameManager) {
-    if (agent->isTagged()) {
-        // Use GameManager to get the team zone position
-        std::pair<int, int> teamZonePosition = gameManager->getTeamZonePosition(agent->getSide());
+template <typename Visitor>
+void TagManager::forEachEnemyInReach(const std::vector<RuleIntent>& intents, const SpatialGrid& blueGrid, const SpatialGrid& redGrid, size_t blueCount, size_t index, Visitor visit) const {
+    // Calls visit(enemy, distance) for every enemy within tagging distance
+    const RuleIntent& intent = intents[index];
+    const SpatialGrid& enemyGrid = intent.blueTeam ? redGrid : blueGrid;
+    size_t enemyOffset = intent.blueTeam ? blueCount : 0;
+    int radius = static_cast<int>(std::ceil(taggingDistance));
 
-        // Check if agent is in its team zone
-        if (agent->checkInTeamZone()) {
-            agent->setIsTagged(false);
+    enemyGrid.forEachInRadius(intent.x, intent.y, radius, [&](int enemyIndex) {
+        size_t enemy = enemyOffset + static_cast<size_t>(enemyIndex);
+        float distance = std::hypot(static_cast<float>(intents[enemy].x - intent.x), static_cast<float>(intents[enemy].y - intent.y));
+        if (distance <= taggingDistance) {
+            visit(enemy, distance);
         }
-        else {
-            // Move towards team zone using pathfinding
-            std::vector<std::pair<int, int>> path = pathfinder->findPath(agent->getX(), agent->getY(), teamZonePosition.first, teamZonePosition.second);
-            if (!path.empty()) {
-                std::pair<int, int> nextPosition = path[0];
-                agent->setX(nextPosition.first);
-                agent->setY(nextPosition.second);
+        return true;
+    });
+}
+
+void TagManager::chooseTargets(const std::vector<RuleIntent>& intents, const SpatialGrid& blueGrid, const SpatialGrid& redGrid, size_t blueCount, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        targets[i] = -1;
+        const RuleIntent& tagger = intents[i];
+        if (!tagger.wantsTag || !tagger.enabled || tagger.tagged) {
+            continue;
+        }
+
+        float nearest = 0.0f;
+        forEachEnemyInReach(intents, blueGrid, redGrid, blueCount, i, [&](size_t enemy, float distance) {
+            const RuleIntent& target = intents[enemy];
+            if (!target.onEnemySide || target.tagged) {
+                return;
             }
+            if (targets[i] < 0 || distance < nearest || (distance == nearest && static_cast<int>(enemy) < targets[i])) {
+                targets[i] = static_cast<int>(enemy);
+                nearest = distance;
+            }
+        });
+    }
+}
+
+void TagManager::resolveTags(const std::vector<RuleIntent>& intents, const SpatialGrid& blueGrid, const SpatialGrid& redGrid, size_t blueCount, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        taggers[i] = -1;
+        const RuleIntent& target = intents[i];
+        if (!target.onEnemySide || target.tagged) {
+            continue;
         }
+
+        // Closest wins within each kind, and a chosen tag beats a zone guard
+        int chooser = -1;
+        int guard = -1;
+        float chooserDistance = 0.0f;
+        float guardDistance = 0.0f;
+        auto closer = [](int current, float currentDistance, size_t candidate, float distance) {
+            return current < 0 || distance < currentDistance || (distance == currentDistance && static_cast<int>(candidate) < current);
+        };
+        forEachEnemyInReach(intents, blueGrid, redGrid, blueCount, i, [&](size_t enemy, float distance) {
+            const RuleIntent& tagger = intents[enemy];
+            if (!tagger.enabled || tagger.tagged) {
+                return;
+            }
+            if (targets[enemy] == static_cast<int>(i)) {
+                if (closer(chooser, chooserDistance, enemy, distance)) {
+                    chooser = static_cast<int>(enemy);
+                    chooserDistance = distance;
+                }
+            }
+            else if (tagger.inTeamZone && closer(guard, guardDistance, enemy, distance)) {
+                guard = static_cast<int>(enemy);
+                guardDistance = distance;
+            }
+        });
+        taggers[i] = chooser >= 0 ? chooser : guard;
     }
 }
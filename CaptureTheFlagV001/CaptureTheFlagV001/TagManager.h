@@ -1,22 +1,44 @@
 #ifndef TAGMANAGER_H
 #define TAGMANAGER_H
 
+#include <cstddef>
 #include <vector>
+#include "RuleIntent.h"
 
-class Agent;
-class Pathfinder;
-class GameManager;
+class SpatialGrid;
 
+// Tag resolution for the rules phase. An intruder, an untagged agent on the
+// enemy half, is tagged by an untagged enemy within tagging distance that
+// either chose it as its TagEnemy target or stands in its own team zone.
+// Each tagger chooses at most one target, the nearest intruder it reaches,
+// and each intruder is credited to one tagger: the nearest that chose it,
+// otherwise the nearest zone guard, lower index on ties.
+//
+// Intents are indexed blue first, then red; each team's grid indexes that
+// team from zero. Both steps read only the intents and write only the
+// entries of their own agents, so batches run in parallel and the outcome
+// does not depend on agent order.
 class TagManager {
-private:
-    GameManager* gameManager;
-
 public:
-    TagManager(GameManager* gm) : gameManager(gm) { }
+    TagManager();
+
+    void resize(size_t agentCount);
+    void setTaggingDistance(float distance) { taggingDistance = distance; }
+    void chooseTargets(const std::vector<RuleIntent>& intents, const SpatialGrid& blueGrid, const SpatialGrid& redGrid, size_t blueCount, size_t begin, size_t end);
+    void resolveTags(const std::vector<RuleIntent>& intents, const SpatialGrid& blueGrid, const SpatialGrid& redGrid, size_t blueCount, size_t begin, size_t end);
 
-    static void tagEnemy(Agent* agent, std::vector<Agent*>& otherAgents);
-    static void handleTaggedAgent(Agent* agent, Pathfinder* pathfinder, GameManager* gameManager);
+    // Agent credited with tagging target this tick, -1 if it stays free
+    int getTagger(size_t target) const { return taggers[target]; }
+    // Whether that tagger went for the target rather than guarding its zone
+    bool isChosenTag(size_t target) const { return taggers[target] >= 0 && targets[taggers[target]] == static_cast<int>(target); }
+
+private:
+    template <typename Visitor>
+    void forEachEnemyInReach(const std::vector<RuleIntent>& intents, const SpatialGrid& blueGrid, const SpatialGrid& redGrid, size_t blueCount, size_t index, Visitor visit) const;
 
+    float taggingDistance;
+    std::vector<int> targets;
+    std::vector<int> taggers;
 };
 
-#endif
\ No newline at end of file
+#endif
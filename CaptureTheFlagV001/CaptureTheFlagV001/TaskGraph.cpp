@@ -0,0 +1,263 @@
+#include "TaskGraph.h"
+#include <algorithm>
+#include <limits>
+
+TaskGraph::TaskGraph(int workerCount)
+    : preparedTaskCount(0), preparedPhaseCount(0), remainingTasks(0), queuedTasks(0), queuedCallerTasks(0), sleepingWorkers(0),
+      generation(0), stopping(false) {
+    if (workerCount <= 0) {
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (int i = 0; i < workerCount; ++i) {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+
+    // Worker 0 is the thread that calls run()
+    for (int i = 1; i < workerCount; ++i) {
+        workers.emplace_back(&TaskGraph::workerLoop, this, i);
+    }
+}
+
+TaskGraph::~TaskGraph() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+int TaskGraph::addPhase(const std::string& name) {
+    phaseTimings.push_back({ name, 0, 0.0, 0.0, 0.0, 0.0, 0 });
+    return static_cast<int>(phaseTimings.size()) - 1;
+}
+
+int TaskGraph::addTask(int phase, std::function<void()> work, bool runOnCaller) {
+    tasks.push_back({ std::move(work), phase, runOnCaller, 0, {} });
+    phaseTimings[phase].taskCount++;
+    return static_cast<int>(tasks.size()) - 1;
+}
+
+void TaskGraph::addDependency(int before, int after) {
+    tasks[before].successors.push_back(after);
+    tasks[after].dependencyCount++;
+}
+
+void TaskGraph::clear() {
+    tasks.clear();
+    phaseTimings.clear();
+}
+
+void TaskGraph::resetPhaseTimings() {
+    for (auto& timing : phaseTimings) {
+        timing.wallMs = 0.0;
+        timing.busyMs = 0.0;
+        timing.totalWallMs = 0.0;
+        timing.totalBusyMs = 0.0;
+        timing.runs = 0;
+    }
+}
+
+void TaskGraph::run() {
+    const int taskCount = static_cast<int>(tasks.size());
+    const int phaseCount = static_cast<int>(phaseTimings.size());
+    if (taskCount == 0) {
+        return;
+    }
+
+    // Grow the per-run counters only when the graph grew
+    if (taskCount > preparedTaskCount) {
+        pendingDependencies.reset(new std::atomic<int>[taskCount]);
+        preparedTaskCount = taskCount;
+    }
+    if (phaseCount > preparedPhaseCount) {
+        phaseFirstStart.reset(new std::atomic<long long>[phaseCount]);
+        phaseLastEnd.reset(new std::atomic<long long>[phaseCount]);
+        phaseBusy.reset(new std::atomic<long long>[phaseCount]);
+        preparedPhaseCount = phaseCount;
+    }
+
+    for (int i = 0; i < taskCount; ++i) {
+        pendingDependencies[i].store(tasks[i].dependencyCount, std::memory_order_relaxed);
+    }
+    for (int i = 0; i < phaseCount; ++i) {
+        phaseFirstStart[i].store(std::numeric_limits<long long>::max(), std::memory_order_relaxed);
+        phaseLastEnd[i].store(0, std::memory_order_relaxed);
+        phaseBusy[i].store(0, std::memory_order_relaxed);
+    }
+
+    remainingTasks.store(taskCount);
+    runStart = std::chrono::steady_clock::now();
+
+    // Spread the root tasks over the workers so they start without stealing
+    int nextQueue = 0;
+    for (int i = 0; i < taskCount; ++i) {
+        if (tasks[i].dependencyCount == 0) {
+            pushReady(nextQueue, i);
+            nextQueue = (nextQueue + 1) % static_cast<int>(queues.size());
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        generation++;
+    }
+    wakeCondition.notify_all();
+
+    runTasks(0);
+
+    for (int i = 0; i < phaseCount; ++i) {
+        PhaseTiming& timing = phaseTimings[i];
+        long long first = phaseFirstStart[i].load();
+        long long last = phaseLastEnd[i].load();
+
+        timing.wallMs = last > first ? (last - first) / 1.0e6 : 0.0;
+        timing.busyMs = phaseBusy[i].load() / 1.0e6;
+        timing.totalWallMs += timing.wallMs;
+        timing.totalBusyMs += timing.busyMs;
+        timing.runs++;
+    }
+}
+
+void TaskGraph::workerLoop(int index) {
+    unsigned long long seenGeneration = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCondition.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+        }
+
+        runTasks(index);
+    }
+}
+
+void TaskGraph::runTasks(int index) {
+    int idleSpins = 0;
+
+    while (remainingTasks.load() > 0) {
+        int task;
+        bool found = false;
+
+        if (index == 0) {
+            found = popLocal(callerQueue, task);
+        }
+        if (!found) {
+            found = popLocal(*queues[index], task) || steal(index, task);
+        }
+
+        if (found) {
+            execute(index, task);
+            idleSpins = 0;
+        }
+        else if (++idleSpins < idleSpinLimit) {
+            std::this_thread::yield();
+        }
+        else {
+            waitForWork(index);
+            idleSpins = 0;
+        }
+    }
+}
+
+void TaskGraph::waitForWork(int index) {
+    std::unique_lock<std::mutex> lock(readyMutex);
+    // Counted before the queues are checked, so whoever queues a task or
+    // finishes the run after that sees a sleeper to wake
+    sleepingWorkers.fetch_add(1);
+    readyCondition.wait(lock, [&]() {
+        return remainingTasks.load() == 0 || queuedTasks.load() > 0 || (index == 0 && queuedCallerTasks.load() > 0);
+    });
+    sleepingWorkers.fetch_sub(1);
+}
+
+void TaskGraph::wakeSleepers() {
+    if (sleepingWorkers.load() > 0) {
+        std::lock_guard<std::mutex> lock(readyMutex);
+        readyCondition.notify_all();
+    }
+}
+
+bool TaskGraph::popLocal(WorkQueue& queue, int& task) {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+    (&queue == &callerQueue ? queuedCallerTasks : queuedTasks).fetch_sub(1);
+    return true;
+}
+
+bool TaskGraph::steal(int index, int& task) {
+    const int queueCount = static_cast<int>(queues.size());
+
+    for (int offset = 1; offset < queueCount; ++offset) {
+        WorkQueue& victim = *queues[(index + offset) % queueCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            queuedTasks.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskGraph::execute(int index, int task) {
+    Task& current = tasks[task];
+    long long start = nanosecondsSinceRunStart();
+
+    current.work();
+
+    long long end = nanosecondsSinceRunStart();
+
+    // Record the phase span with lock-free min/max updates
+    std::atomic<long long>& first = phaseFirstStart[current.phase];
+    long long seen = first.load();
+    while (start < seen && !first.compare_exchange_weak(seen, start)) {
+    }
+
+    std::atomic<long long>& last = phaseLastEnd[current.phase];
+    seen = last.load();
+    while (end > seen && !last.compare_exchange_weak(seen, end)) {
+    }
+
+    phaseBusy[current.phase].fetch_add(end - start);
+
+    for (int successor : current.successors) {
+        if (pendingDependencies[successor].fetch_sub(1) == 1) {
+            pushReady(index, successor);
+        }
+    }
+
+    // Must be the last access to the tasks: run() may return right after.
+    // The wake-up only touches members the destructor waits for.
+    if (remainingTasks.fetch_sub(1) == 1) {
+        wakeSleepers();
+    }
+}
+
+void TaskGraph::pushReady(int index, int task) {
+    bool runOnCaller = tasks[task].runOnCaller;
+    WorkQueue& queue = runOnCaller ? callerQueue : *queues[index];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(task);
+        (runOnCaller ? queuedCallerTasks : queuedTasks).fetch_add(1);
+    }
+    wakeSleepers();
+}
+
+long long TaskGraph::nanosecondsSinceRunStart() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - runStart).count();
+}
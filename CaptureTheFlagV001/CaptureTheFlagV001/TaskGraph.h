@@ -0,0 +1,105 @@
+#ifndef TASKGRAPH_H
+#define TASKGRAPH_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct PhaseTiming {
+    std::string name;
+    int taskCount;
+    double wallMs;      // first task start to last task end in the last run
+    double busyMs;      // summed task execution time in the last run
+    double totalWallMs; // accumulated over all runs since the last reset
+    double totalBusyMs;
+    int runs;
+};
+
+// Dependency graph of tasks executed by a fixed pool of workers with
+// work-stealing deques. Each worker pops its own deque from the back and
+// steals from the front of the others. The thread calling run() works as
+// worker 0 and is the only one allowed to run tasks marked runOnCaller.
+class TaskGraph {
+public:
+    explicit TaskGraph(int workerCount = 0);
+    ~TaskGraph();
+
+    int addPhase(const std::string& name);
+    int addTask(int phase, std::function<void()> work, bool runOnCaller = false);
+    void addDependency(int before, int after);
+    void clear();
+
+    // Runs every task once, respecting dependencies, and blocks until done
+    void run();
+
+    int getWorkerCount() const { return static_cast<int>(queues.size()); }
+    int getTaskCount() const { return static_cast<int>(tasks.size()); }
+    const std::vector<PhaseTiming>& getPhaseTimings() const { return phaseTimings; }
+    void resetPhaseTimings();
+
+private:
+    struct Task {
+        std::function<void()> work;
+        int phase;
+        bool runOnCaller;
+        int dependencyCount;
+        std::vector<int> successors;
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<int> tasks;
+    };
+
+    void workerLoop(int index);
+    void runTasks(int index);
+    bool popLocal(WorkQueue& queue, int& task);
+    bool steal(int index, int& task);
+    void execute(int index, int task);
+    void pushReady(int index, int task);
+    void waitForWork(int index);
+    void wakeSleepers();
+    long long nanosecondsSinceRunStart() const;
+
+    std::vector<Task> tasks;
+    std::vector<PhaseTiming> phaseTimings;
+
+    // Per-run bookkeeping, sized on demand in run()
+    int preparedTaskCount;
+    int preparedPhaseCount;
+    std::unique_ptr<std::atomic<int>[]> pendingDependencies;
+    std::unique_ptr<std::atomic<long long>[]> phaseFirstStart;
+    std::unique_ptr<std::atomic<long long>[]> phaseLastEnd;
+    std::unique_ptr<std::atomic<long long>[]> phaseBusy;
+    std::atomic<int> remainingTasks;
+    std::chrono::steady_clock::time_point runStart;
+
+    // Workers out of work yield idleSpinLimit times, then sleep on
+    // readyCondition until a task any of them can take is queued or the
+    // run ends. Tasks waiting in the worker queues and the caller's queue
+    // are counted apart, since only worker 0 takes the caller's.
+    static const int idleSpinLimit = 64;
+    std::atomic<int> queuedTasks;
+    std::atomic<int> queuedCallerTasks;
+    std::atomic<int> sleepingWorkers;
+    std::mutex readyMutex;
+    std::condition_variable readyCondition;
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    WorkQueue callerQueue;
+    std::vector<std::thread> workers;
+
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    unsigned long long generation;
+    bool stopping;
+};
+
+#endif
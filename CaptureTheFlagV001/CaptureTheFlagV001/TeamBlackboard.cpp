@@ -0,0 +1,64 @@
+#include "TeamBlackboard.h"
+#include "BinaryStream.h"
+
+TeamBlackboard::TeamBlackboard(int capacity) : buffers{ Memory(capacity), Memory(capacity) }, epoch(0) {}
+
+void TeamBlackboard::resize(size_t slotCount) {
+    // Slots that stay keep their capacity
+    pending.resize(slotCount);
+    for (auto& slot : pending) {
+        slot.clear();
+    }
+}
+
+void TeamBlackboard::publish(long long tick) {
+    bool posted = false;
+    for (const auto& slot : pending) {
+        if (!slot.empty()) {
+            posted = true;
+            break;
+        }
+    }
+    if (!posted && read().getTrackCount() == 0) {
+        return;
+    }
+
+    // The back copy is a publish behind, so bring it up to date before
+    // adding this tick; only the tracks are copied, never the wheel
+    uint64_t current = epoch.load(std::memory_order_relaxed);
+    Memory& back = buffers[(current + 1) & 1];
+    back.copyTracksFrom(buffers[current & 1]);
+    back.predictTracks(tick);
+    for (auto& slot : pending) {
+        for (const Sighting& sighting : slot) {
+            back.observeOpponent(sighting.opponentId, sighting.x, sighting.y, sighting.hasFlag, tick);
+        }
+        slot.clear();
+    }
+    back.expire(tick);
+    epoch.store(current + 1, std::memory_order_release);
+}
+
+void TeamBlackboard::setRetention(long long ticks) {
+    buffers[0].setRetention(ticks);
+    buffers[1].setRetention(ticks);
+}
+
+void TeamBlackboard::clear() {
+    buffers[0].clear();
+    buffers[1].clear();
+    for (auto& slot : pending) {
+        slot.clear();
+    }
+}
+
+void TeamBlackboard::saveState(BinaryWriter& writer) const {
+    read().saveState(writer);
+}
+
+void TeamBlackboard::loadState(BinaryReader& reader) {
+    for (auto& slot : pending) {
+        slot.clear();
+    }
+    buffers[epoch.load(std::memory_order_relaxed) & 1].loadState(reader);
+}
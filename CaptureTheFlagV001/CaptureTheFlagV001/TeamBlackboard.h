@@ -0,0 +1,62 @@
+#ifndef TEAMBLACKBOARD_H
+#define TEAMBLACKBOARD_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Memory.h"
+
+class BinaryWriter;
+class BinaryReader;
+
+// One opponent seen by one teammate this tick
+struct Sighting {
+    int opponentId;
+    int x;
+    int y;
+    bool hasFlag;
+};
+
+// Opponent memory shared by a whole team. Teammates post sightings into
+// their own slot while perception runs in parallel, then publish() folds
+// every slot into the tracks in slot order and flips to the new copy.
+// Reads take the published copy with one atomic load and never lock; that
+// copy is only written again two publishes later, and the tick graph keeps
+// a full phase between publishes. Posting and publishing share no slot, so
+// posting is lock free too.
+class TeamBlackboard {
+public:
+    explicit TeamBlackboard(int capacity = Memory::defaultCapacity);
+
+    const Memory& read() const { return buffers[epoch.load(std::memory_order_acquire) & 1]; }
+    // Publishes so far; a reader can tell whether anything changed since it last looked
+    uint64_t getEpoch() const { return epoch.load(std::memory_order_acquire); }
+
+    // One slot per teammate, by their index in the team
+    void resize(size_t slotCount);
+    void post(size_t slot, const Sighting& sighting) { pending[slot].push_back(sighting); }
+
+    // Runs alone between phases, every tick: besides taking in the
+    // sightings it predicts every track to the tick and lets tracks
+    // expire. Does nothing while the team remembers no one and no one
+    // posted.
+    void publish(long long tick);
+
+    // Ticks a track survives unseen, see Memory::setRetention
+    void setRetention(long long ticks);
+
+    // Forgets every opponent but keeps the storage for the next match
+    void clear();
+
+    // The published tracks; slots are empty whenever a snapshot is taken
+    void saveState(BinaryWriter& writer) const;
+    void loadState(BinaryReader& reader);
+
+private:
+    Memory buffers[2];
+    std::atomic<uint64_t> epoch;
+    std::vector<std::vector<Sighting>> pending;
+};
+
+#endif
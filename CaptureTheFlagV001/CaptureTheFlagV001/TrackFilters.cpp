@@ -0,0 +1,189 @@
+#include "TrackFilters.h"
+#include "BinaryStream.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRACKFILTERS_SSE2
+#include <emmintrin.h>
+#endif
+
+void TrackFilters::add() {
+    x.push_back(0.0f);
+    y.push_back(0.0f);
+    velocityX.push_back(0.0f);
+    velocityY.push_back(0.0f);
+    positionVariance.push_back(measurementVariance);
+    covariance.push_back(0.0f);
+    velocityVariance.push_back(initialVelocityVariance);
+}
+
+void TrackFilters::start(size_t track, float positionX, float positionY) {
+    x[track] = positionX;
+    y[track] = positionY;
+    velocityX[track] = 0.0f;
+    velocityY[track] = 0.0f;
+    positionVariance[track] = measurementVariance;
+    covariance[track] = 0.0f;
+    velocityVariance[track] = initialVelocityVariance;
+}
+
+void TrackFilters::moveTrack(size_t from, size_t to) {
+    x[to] = x[from];
+    y[to] = y[from];
+    velocityX[to] = velocityX[from];
+    velocityY[to] = velocityY[from];
+    positionVariance[to] = positionVariance[from];
+    covariance[to] = covariance[from];
+    velocityVariance[to] = velocityVariance[from];
+}
+
+void TrackFilters::removeLast() {
+    x.pop_back();
+    y.pop_back();
+    velocityX.pop_back();
+    velocityY.pop_back();
+    positionVariance.pop_back();
+    covariance.pop_back();
+    velocityVariance.pop_back();
+}
+
+void TrackFilters::clear() {
+    x.clear();
+    y.clear();
+    velocityX.clear();
+    velocityY.clear();
+    positionVariance.clear();
+    covariance.clear();
+    velocityVariance.clear();
+}
+
+void TrackFilters::predict(long long ticks) {
+    if (ticks <= 0) {
+        return;
+    }
+
+    // The state moves by F = [1 k; 0 1] for k ticks at once, and the
+    // covariance by F P F' plus the white acceleration noise built up over
+    // those k ticks. The SSE2 and scalar paths do the same operations track
+    // by track.
+    const float k = static_cast<float>(ticks);
+    const float noisePosition = accelerationVariance * k * k * k / 3.0f;
+    const float noiseCovariance = accelerationVariance * k * k / 2.0f;
+    const float noiseVelocity = accelerationVariance * k;
+    size_t track = 0;
+    size_t count = size();
+
+#ifdef TRACKFILTERS_SSE2
+    const __m128 kLanes = _mm_set1_ps(k);
+    const __m128 twoKLanes = _mm_set1_ps(2.0f * k);
+    const __m128 kSquaredLanes = _mm_set1_ps(k * k);
+    const __m128 noisePositionLanes = _mm_set1_ps(noisePosition);
+    const __m128 noiseCovarianceLanes = _mm_set1_ps(noiseCovariance);
+    const __m128 noiseVelocityLanes = _mm_set1_ps(noiseVelocity);
+    for (; track + 4 <= count; track += 4) {
+        __m128 vx = _mm_loadu_ps(&velocityX[track]);
+        __m128 vy = _mm_loadu_ps(&velocityY[track]);
+        _mm_storeu_ps(&x[track], _mm_add_ps(_mm_loadu_ps(&x[track]), _mm_mul_ps(kLanes, vx)));
+        _mm_storeu_ps(&y[track], _mm_add_ps(_mm_loadu_ps(&y[track]), _mm_mul_ps(kLanes, vy)));
+
+        __m128 pp = _mm_loadu_ps(&positionVariance[track]);
+        __m128 pv = _mm_loadu_ps(&covariance[track]);
+        __m128 vv = _mm_loadu_ps(&velocityVariance[track]);
+        pp = _mm_add_ps(_mm_add_ps(_mm_add_ps(pp, _mm_mul_ps(twoKLanes, pv)), _mm_mul_ps(kSquaredLanes, vv)), noisePositionLanes);
+        pv = _mm_add_ps(_mm_add_ps(pv, _mm_mul_ps(kLanes, vv)), noiseCovarianceLanes);
+        vv = _mm_add_ps(vv, noiseVelocityLanes);
+        _mm_storeu_ps(&positionVariance[track], pp);
+        _mm_storeu_ps(&covariance[track], pv);
+        _mm_storeu_ps(&velocityVariance[track], vv);
+    }
+#endif
+
+    for (; track < count; ++track) {
+        x[track] = x[track] + k * velocityX[track];
+        y[track] = y[track] + k * velocityY[track];
+
+        float pp = positionVariance[track];
+        float pv = covariance[track];
+        float vv = velocityVariance[track];
+        positionVariance[track] = ((pp + 2.0f * k * pv) + (k * k) * vv) + noisePosition;
+        covariance[track] = (pv + k * vv) + noiseCovariance;
+        velocityVariance[track] = vv + noiseVelocity;
+    }
+}
+
+void TrackFilters::update(size_t track, float measuredX, float measuredY) {
+    // Gains for position and velocity from the shared covariance
+    float innovationVariance = positionVariance[track] + measurementVariance;
+    float positionGain = positionVariance[track] / innovationVariance;
+    float velocityGain = covariance[track] / innovationVariance;
+
+    float residualX = measuredX - x[track];
+    float residualY = measuredY - y[track];
+    x[track] += positionGain * residualX;
+    y[track] += positionGain * residualY;
+    velocityX[track] += velocityGain * residualX;
+    velocityY[track] += velocityGain * residualY;
+
+    velocityVariance[track] -= velocityGain * covariance[track];
+    covariance[track] *= 1.0f - positionGain;
+    positionVariance[track] *= 1.0f - positionGain;
+}
+
+float TrackFilters::solveIntercept(size_t track, float fromX, float fromY, float cellsPerTick, float maxTicks) const {
+    // |d + v t| = s t with d the offset from the pursuer, a quadratic in t
+    float offsetX = x[track] - fromX;
+    float offsetY = y[track] - fromY;
+    float a = velocityX[track] * velocityX[track] + velocityY[track] * velocityY[track] - cellsPerTick * cellsPerTick;
+    float b = 2.0f * (offsetX * velocityX[track] + offsetY * velocityY[track]);
+    float c = offsetX * offsetX + offsetY * offsetY;
+    if (c <= 0.0f) {
+        return 0.0f;
+    }
+
+    float ticks = maxTicks;
+    if (std::abs(a) < 1e-6f) {
+        // Equal speeds: only a target coming closer can be met
+        if (b < 0.0f) {
+            ticks = -c / b;
+        }
+    }
+    else {
+        float discriminant = b * b - 4.0f * a * c;
+        if (discriminant >= 0.0f) {
+            float root = std::sqrt(discriminant);
+            float first = (-b - root) / (2.0f * a);
+            float second = (-b + root) / (2.0f * a);
+            if (first > second) {
+                std::swap(first, second);
+            }
+            if (first >= 0.0f) {
+                ticks = first;
+            }
+            else if (second >= 0.0f) {
+                ticks = second;
+            }
+        }
+    }
+    return std::min(ticks, maxTicks);
+}
+
+void TrackFilters::saveTrack(BinaryWriter& writer, size_t track) const {
+    writer.writeFloat(x[track]);
+    writer.writeFloat(y[track]);
+    writer.writeFloat(velocityX[track]);
+    writer.writeFloat(velocityY[track]);
+    writer.writeFloat(positionVariance[track]);
+    writer.writeFloat(covariance[track]);
+    writer.writeFloat(velocityVariance[track]);
+}
+
+void TrackFilters::loadTrack(BinaryReader& reader, size_t track) {
+    x[track] = reader.readFloat();
+    y[track] = reader.readFloat();
+    velocityX[track] = reader.readFloat();
+    velocityY[track] = reader.readFloat();
+    positionVariance[track] = reader.readFloat();
+    covariance[track] = reader.readFloat();
+    velocityVariance[track] = reader.readFloat();
+}
@@ -0,0 +1,64 @@
+#ifndef TRACKFILTERS_H
+#define TRACKFILTERS_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+class BinaryWriter;
+class BinaryReader;
+
+// Constant velocity Kalman filters, one per tracked opponent, kept as
+// structure of arrays so a whole table predicts in one pass, four tracks at
+// a time with SSE2. Both axes share dynamics and are measured together, so
+// they share one covariance: position variance, position-velocity
+// covariance and velocity variance. Units are cells and ticks.
+class TrackFilters {
+public:
+    // Sighting noise, about the rounding of a position to its cell
+    static constexpr float measurementVariance = 0.5f;
+    // White acceleration noise, how freely opponents change course
+    static constexpr float accelerationVariance = 0.01f;
+    // A new track knows its position but not where it is heading
+    static constexpr float initialVelocityVariance = 1.0f;
+
+    size_t size() const { return x.size(); }
+    void add();
+    // Restarts a filter at a first sighting, standing still
+    void start(size_t track, float positionX, float positionY);
+    void moveTrack(size_t from, size_t to);
+    void removeLast();
+    void clear();
+
+    // Moves every filter ticks ahead in one batch
+    void predict(long long ticks);
+    // Folds a sighting into one filter already predicted to the sighting's tick
+    void update(size_t track, float measuredX, float measuredY);
+
+    float getX(size_t track) const { return x[track]; }
+    float getY(size_t track) const { return y[track]; }
+    float getVelocityX(size_t track) const { return velocityX[track]; }
+    float getVelocityY(size_t track) const { return velocityY[track]; }
+    float getPositionVariance(size_t track) const { return positionVariance[track]; }
+    std::pair<float, float> predictPosition(size_t track, float ticksAhead) const {
+        return std::make_pair(x[track] + velocityX[track] * ticksAhead, y[track] + velocityY[track] * ticksAhead);
+    }
+
+    // Earliest tick, up to maxTicks, at which a pursuer at (fromX, fromY)
+    // moving cellsPerTick can meet the predicted track; maxTicks if it cannot
+    float solveIntercept(size_t track, float fromX, float fromY, float cellsPerTick, float maxTicks) const;
+
+    void saveTrack(BinaryWriter& writer, size_t track) const;
+    void loadTrack(BinaryReader& reader, size_t track);
+
+private:
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> velocityX;
+    std::vector<float> velocityY;
+    std::vector<float> positionVariance;
+    std::vector<float> covariance;
+    std::vector<float> velocityVariance;
+};
+
+#endif
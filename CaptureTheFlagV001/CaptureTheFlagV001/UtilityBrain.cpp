@@ -0,0 +1,223 @@
+#include "UtilityBrain.h"
+#include <algorithm>
+#include <limits>
+
+#if defined(__AVX2__)
+#define UTILITYBRAIN_AVX2
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UTILITYBRAIN_SSE2
+#include <emmintrin.h>
+#endif
+
+UtilityBrain::UtilityBrain() {
+    setWeights(0, getDefaultWeights());
+    setWeights(1, getDefaultWeights());
+}
+
+UtilityWeights UtilityBrain::getDefaultWeights() {
+    // Tagging a carrier in reach beats chasing it
+    UtilityWeights weights;
+    weights.captureFlag = 1.0f;
+    weights.tagEnemy = 1.5f;
+    weights.recoverFlag = 1.0f;
+    weights.returnToHomeZone = 1.0f;
+    weights.grabFlag = 1.0f;
+    weights.explore = 1.0f;
+    return weights;
+}
+
+void UtilityBrain::resize(size_t agentCount) {
+    hasFlag.assign(agentCount, 0.0f);
+    opponentHasFlag.assign(agentCount, 0.0f);
+    isTagged.assign(agentCount, 0.0f);
+    inHomeZone.assign(agentCount, 0.0f);
+    enemyInReach.assign(agentCount, 0.0f);
+    team.assign(agentCount, 0.0f);
+    distanceToFlag.assign(agentCount, 0.0f);
+    distanceToNearestEnemy.assign(agentCount, 0.0f);
+    decisions.assign(agentCount, static_cast<uint8_t>(BrainDecision::Explore));
+}
+
+void UtilityBrain::setWeights(int team, const UtilityWeights& weights) {
+    teamWeights[team] = weights;
+    float* lanes = weightLanes[team];
+    lanes[static_cast<int>(BrainDecision::CaptureFlag)] = weights.captureFlag;
+    lanes[static_cast<int>(BrainDecision::TagEnemy)] = weights.tagEnemy;
+    lanes[static_cast<int>(BrainDecision::RecoverFlag)] = weights.recoverFlag;
+    lanes[static_cast<int>(BrainDecision::ReturnToHomeZone)] = weights.returnToHomeZone;
+    lanes[static_cast<int>(BrainDecision::GrabFlag)] = weights.grabFlag;
+    lanes[static_cast<int>(BrainDecision::Explore)] = weights.explore;
+}
+
+void UtilityBrain::setInputs(size_t index, int team, const DecisionInputs& inputs, float proximityThreshold) {
+    hasFlag[index] = inputs.hasFlag ? 1.0f : 0.0f;
+    opponentHasFlag[index] = inputs.opponentHasFlag ? 1.0f : 0.0f;
+    isTagged[index] = inputs.isTagged ? 1.0f : 0.0f;
+    inHomeZone[index] = inputs.inHomeZone ? 1.0f : 0.0f;
+    enemyInReach[index] = inputs.distanceToNearestEnemy <= proximityThreshold ? 1.0f : 0.0f;
+    this->team[index] = static_cast<float>(team);
+    // Nobody in view comes in as the largest float; capped so weighting
+    // its utility stays finite
+    distanceToFlag[index] = std::min(inputs.distanceToFlag, maxDistance);
+    distanceToNearestEnemy[index] = std::min(inputs.distanceToNearestEnemy, maxDistance);
+}
+
+void UtilityBrain::scoreOne(size_t index) {
+    bool carrying = hasFlag[index] != 0.0f;
+    bool opponentCarrying = opponentHasFlag[index] != 0.0f;
+    bool tagged = isTagged[index] != 0.0f;
+    bool home = inHomeZone[index] != 0.0f;
+    bool free = !tagged && !carrying;
+    const float* weights = weightLanes[team[index] != 0.0f ? 1 : 0];
+
+    float capture = Brain::evaluateFlagCapture(carrying, distanceToFlag[index]);
+    float recovery = Brain::evaluateFlagRecovery(opponentCarrying, distanceToNearestEnemy[index]);
+    float explore = Brain::evaluateExplore(carrying, opponentCarrying, home);
+
+    // Utilities can go negative far from the flag, so an action the agent
+    // cannot take scores below anything it can
+    const float ruledOut = std::numeric_limits<float>::lowest();
+    float scores[actionCount];
+    scores[static_cast<int>(BrainDecision::CaptureFlag)] = carrying && home && !tagged ? weights[0] * capture : ruledOut;
+    scores[static_cast<int>(BrainDecision::TagEnemy)] = free && opponentCarrying && enemyInReach[index] != 0.0f ? weights[1] * recovery : ruledOut;
+    scores[static_cast<int>(BrainDecision::RecoverFlag)] = free ? weights[2] * recovery : ruledOut;
+    scores[static_cast<int>(BrainDecision::ReturnToHomeZone)] = tagged || (carrying && !home) ? weights[3] : ruledOut;
+    scores[static_cast<int>(BrainDecision::GrabFlag)] = free ? weights[4] * capture : ruledOut;
+    scores[static_cast<int>(BrainDecision::Explore)] = !tagged ? weights[5] * explore : ruledOut;
+
+    int best = 0;
+    for (int action = 1; action < actionCount; ++action) {
+        if (scores[action] > scores[best]) {
+            best = action;
+        }
+    }
+    decisions[index] = static_cast<uint8_t>(best);
+}
+
+void UtilityBrain::score(size_t begin, size_t end) {
+    size_t i = begin;
+
+    // The vector paths follow scoreOne step for step: the evaluate functions
+    // become selects between their two outcomes, and so does ruling an action out
+
+#ifdef UTILITYBRAIN_AVX2
+    {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 hundred = _mm256_set1_ps(100.0f);
+        const __m256 half = _mm256_set1_ps(0.5f);
+        const __m256 ruledOut = _mm256_set1_ps(std::numeric_limits<float>::lowest());
+        __m256 blueWeights[actionCount];
+        __m256 redWeights[actionCount];
+        for (int action = 0; action < actionCount; ++action) {
+            blueWeights[action] = _mm256_set1_ps(weightLanes[0][action]);
+            redWeights[action] = _mm256_set1_ps(weightLanes[1][action]);
+        }
+
+        for (; i + 8 <= end; i += 8) {
+            __m256 carrying = _mm256_cmp_ps(_mm256_loadu_ps(&hasFlag[i]), zero, _CMP_GT_OQ);
+            __m256 opponentCarrying = _mm256_cmp_ps(_mm256_loadu_ps(&opponentHasFlag[i]), zero, _CMP_GT_OQ);
+            __m256 tagged = _mm256_cmp_ps(_mm256_loadu_ps(&isTagged[i]), zero, _CMP_GT_OQ);
+            __m256 home = _mm256_cmp_ps(_mm256_loadu_ps(&inHomeZone[i]), zero, _CMP_GT_OQ);
+            __m256 reach = _mm256_cmp_ps(_mm256_loadu_ps(&enemyInReach[i]), zero, _CMP_GT_OQ);
+            __m256 red = _mm256_cmp_ps(_mm256_loadu_ps(&team[i]), zero, _CMP_GT_OQ);
+            __m256 untagged = _mm256_cmp_ps(_mm256_loadu_ps(&isTagged[i]), zero, _CMP_EQ_OQ);
+            __m256 free = _mm256_andnot_ps(carrying, untagged);
+
+            __m256 capture = _mm256_blendv_ps(_mm256_sub_ps(one, _mm256_div_ps(_mm256_loadu_ps(&distanceToFlag[i]), hundred)), one, carrying);
+            __m256 recovery = _mm256_and_ps(opponentCarrying, _mm256_sub_ps(one, _mm256_div_ps(_mm256_loadu_ps(&distanceToNearestEnemy[i]), hundred)));
+            __m256 explore = _mm256_andnot_ps(_mm256_or_ps(_mm256_or_ps(carrying, opponentCarrying), home), half);
+
+            __m256 weights[actionCount];
+            for (int action = 0; action < actionCount; ++action) {
+                weights[action] = _mm256_blendv_ps(blueWeights[action], redWeights[action], red);
+            }
+            __m256 scores[actionCount];
+            scores[0] = _mm256_blendv_ps(ruledOut, _mm256_mul_ps(weights[0], capture), _mm256_and_ps(_mm256_and_ps(carrying, home), untagged));
+            scores[1] = _mm256_blendv_ps(ruledOut, _mm256_mul_ps(weights[1], recovery), _mm256_and_ps(free, _mm256_and_ps(opponentCarrying, reach)));
+            scores[2] = _mm256_blendv_ps(ruledOut, _mm256_mul_ps(weights[2], recovery), free);
+            scores[3] = _mm256_blendv_ps(ruledOut, weights[3], _mm256_or_ps(tagged, _mm256_andnot_ps(home, carrying)));
+            scores[4] = _mm256_blendv_ps(ruledOut, _mm256_mul_ps(weights[4], capture), free);
+            scores[5] = _mm256_blendv_ps(ruledOut, _mm256_mul_ps(weights[5], explore), untagged);
+
+            __m256 best = scores[0];
+            __m256 bestAction = zero;
+            for (int action = 1; action < actionCount; ++action) {
+                __m256 better = _mm256_cmp_ps(scores[action], best, _CMP_GT_OQ);
+                best = _mm256_blendv_ps(best, scores[action], better);
+                bestAction = _mm256_blendv_ps(bestAction, _mm256_set1_ps(static_cast<float>(action)), better);
+            }
+            alignas(32) int chosen[8];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(chosen), _mm256_cvttps_epi32(bestAction));
+            for (int lane = 0; lane < 8; ++lane) {
+                decisions[i + lane] = static_cast<uint8_t>(chosen[lane]);
+            }
+        }
+    }
+#endif
+
+#ifdef UTILITYBRAIN_SSE2
+    {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 hundred = _mm_set1_ps(100.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 ruledOut = _mm_set1_ps(std::numeric_limits<float>::lowest());
+        auto select = [](__m128 ifFalse, __m128 ifTrue, __m128 mask) {
+            return _mm_or_ps(_mm_and_ps(mask, ifTrue), _mm_andnot_ps(mask, ifFalse));
+        };
+        __m128 blueWeights[actionCount];
+        __m128 redWeights[actionCount];
+        for (int action = 0; action < actionCount; ++action) {
+            blueWeights[action] = _mm_set1_ps(weightLanes[0][action]);
+            redWeights[action] = _mm_set1_ps(weightLanes[1][action]);
+        }
+
+        for (; i + 4 <= end; i += 4) {
+            __m128 carrying = _mm_cmpgt_ps(_mm_loadu_ps(&hasFlag[i]), zero);
+            __m128 opponentCarrying = _mm_cmpgt_ps(_mm_loadu_ps(&opponentHasFlag[i]), zero);
+            __m128 tagged = _mm_cmpgt_ps(_mm_loadu_ps(&isTagged[i]), zero);
+            __m128 home = _mm_cmpgt_ps(_mm_loadu_ps(&inHomeZone[i]), zero);
+            __m128 reach = _mm_cmpgt_ps(_mm_loadu_ps(&enemyInReach[i]), zero);
+            __m128 red = _mm_cmpgt_ps(_mm_loadu_ps(&team[i]), zero);
+            __m128 untagged = _mm_cmpeq_ps(_mm_loadu_ps(&isTagged[i]), zero);
+            __m128 free = _mm_andnot_ps(carrying, untagged);
+
+            __m128 capture = select(_mm_sub_ps(one, _mm_div_ps(_mm_loadu_ps(&distanceToFlag[i]), hundred)), one, carrying);
+            __m128 recovery = _mm_and_ps(opponentCarrying, _mm_sub_ps(one, _mm_div_ps(_mm_loadu_ps(&distanceToNearestEnemy[i]), hundred)));
+            __m128 explore = _mm_andnot_ps(_mm_or_ps(_mm_or_ps(carrying, opponentCarrying), home), half);
+
+            __m128 weights[actionCount];
+            for (int action = 0; action < actionCount; ++action) {
+                weights[action] = select(blueWeights[action], redWeights[action], red);
+            }
+            __m128 scores[actionCount];
+            scores[0] = select(ruledOut, _mm_mul_ps(weights[0], capture), _mm_and_ps(_mm_and_ps(carrying, home), untagged));
+            scores[1] = select(ruledOut, _mm_mul_ps(weights[1], recovery), _mm_and_ps(free, _mm_and_ps(opponentCarrying, reach)));
+            scores[2] = select(ruledOut, _mm_mul_ps(weights[2], recovery), free);
+            scores[3] = select(ruledOut, weights[3], _mm_or_ps(tagged, _mm_andnot_ps(home, carrying)));
+            scores[4] = select(ruledOut, _mm_mul_ps(weights[4], capture), free);
+            scores[5] = select(ruledOut, _mm_mul_ps(weights[5], explore), untagged);
+
+            __m128 best = scores[0];
+            __m128 bestAction = zero;
+            for (int action = 1; action < actionCount; ++action) {
+                __m128 better = _mm_cmpgt_ps(scores[action], best);
+                best = select(best, scores[action], better);
+                bestAction = select(bestAction, _mm_set1_ps(static_cast<float>(action)), better);
+            }
+            alignas(16) int chosen[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(chosen), _mm_cvttps_epi32(bestAction));
+            for (int lane = 0; lane < 4; ++lane) {
+                decisions[i + lane] = static_cast<uint8_t>(chosen[lane]);
+            }
+        }
+    }
+#endif
+
+    for (; i < end; ++i) {
+        scoreOne(i);
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef UTILITYBRAIN_H
+#define UTILITYBRAIN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Brain.h"
+
+// How strongly a team is drawn to each action, scaling its utility
+struct UtilityWeights {
+    float captureFlag;
+    float tagEnemy;
+    float recoverFlag;
+    float returnToHomeZone;
+    float grabFlag;
+    float explore;
+};
+
+// Utility scoring for a whole batch of agents at once. Inputs are kept as
+// structure of arrays; score() computes every action's utility for every
+// agent from Brain's evaluate functions, weights it by the agent's team and
+// keeps the highest of those the agent can take, ties going to the action
+// listed first in BrainDecision.
+// Eight agents a lane set with AVX2, four with SSE2, the rest one by one,
+// all doing the same float operations so the choice never depends on the path.
+// The Release configuration builds with /arch:AVX2; Debug keeps to SSE2.
+//
+// Agents are indexed like the tick graph's agents. Batches of agents may
+// score in parallel, each only touching its own range.
+class UtilityBrain {
+public:
+    UtilityBrain();
+
+    static const int actionCount = 6;
+    static constexpr float maxDistance = 1.0e6f;
+    static UtilityWeights getDefaultWeights();
+
+    void resize(size_t agentCount);
+    // Team 0 is blue and 1 is red
+    void setWeights(int team, const UtilityWeights& weights);
+    const UtilityWeights& getWeights(int team) const { return teamWeights[team]; }
+
+    // Tagging counts as in reach within the brain's proximity threshold
+    void setInputs(size_t index, int team, const DecisionInputs& inputs, float proximityThreshold);
+    void score(size_t begin, size_t end);
+    BrainDecision getDecision(size_t index) const { return static_cast<BrainDecision>(decisions[index]); }
+
+private:
+    void scoreOne(size_t index);
+
+    UtilityWeights teamWeights[2];
+    // Per team, indexed like BrainDecision
+    float weightLanes[2][actionCount];
+
+    // 1 or 0 for the flags, so they can be masks in the vector paths
+    std::vector<float> hasFlag;
+    std::vector<float> opponentHasFlag;
+    std::vector<float> isTagged;
+    std::vector<float> inHomeZone;
+    std::vector<float> enemyInReach;
+    std::vector<float> team;
+    std::vector<float> distanceToFlag;
+    std::vector<float> distanceToNearestEnemy;
+    std::vector<uint8_t> decisions;
+};
+
+#endif
@@ -1,7 +1,58 @@
 #include "Driver.h"
+#include "BatchRunner.h"
+#include "BrainBenchmark.h"
+#include "ScaleBenchmark.h"
 #include <QApplication>
+#include <QCoreApplication>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace {
+    // The executable is built for the Windows subsystem, so it starts with
+    // no console even from a terminal. The headless modes report on the
+    // standard streams, which are pointed at the terminal they ran from.
+    void attachParentConsole() {
+#ifdef _WIN32
+        if (!AttachConsole(ATTACH_PARENT_PROCESS)) {
+            return;
+        }
+        FILE* stream = nullptr;
+        freopen_s(&stream, "CONOUT$", "w", stdout);
+        freopen_s(&stream, "CONOUT$", "w", stderr);
+        freopen_s(&stream, "CONIN$", "r", stdin);
+        std::cout.clear();
+        std::cerr.clear();
+        std::cin.clear();
+#endif
+    }
+}
 
 int main(int argc, char* argv[]) {
+    // "--batch", "--scale-bench" and "--brain-bench" run headless without ever creating a window
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--batch") == 0) {
+            attachParentConsole();
+            QCoreApplication app(argc, argv);
+            return BatchRunner::runFromArguments(app.arguments());
+        }
+        if (std::strcmp(argv[i], "--scale-bench") == 0) {
+            attachParentConsole();
+            QCoreApplication app(argc, argv);
+            return ScaleBenchmark::runFromArguments(app.arguments());
+        }
+        if (std::strcmp(argv[i], "--brain-bench") == 0) {
+            attachParentConsole();
+            QCoreApplication app(argc, argv);
+            return BrainBenchmark::runFromArguments(app.arguments());
+        }
+    }
+
     QApplication a(argc, argv);
     Driver w;
     w.show();